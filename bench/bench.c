@@ -0,0 +1,378 @@
+//===--- bench.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+//
+// Microbenchmarks for the solver kernels: propagation, conflict analysis and
+// DIMACS parsing. Each kernel is measured in isolation, without the noise of
+// the search (decisions, learning and backjumps are fixed beforehand), and
+// the results are summarized over a number of repetitions.
+//
+//===------------------------------------------------------------------------===
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/parse.h"
+#include "utils/vec/vec.h"
+
+struct bench_opts {
+	uint32_t n_reps;
+	uint32_t n_seqs;
+	uint32_t n_analyze;
+	uint64_t seed;
+	char kernels[4];
+};
+
+struct bench_stats {
+	double mean;
+	double stddev;
+	double min;
+	double median;
+	double max;
+};
+
+//===------------------------------------------------------------------------===
+// Statistics
+//===------------------------------------------------------------------------===
+static int
+bench_double_comp(const void *p1, const void *p2)
+{
+	const double d1 = *(const double *)p1;
+	const double d2 = *(const double *)p2;
+	return (d1 > d2) - (d1 < d2);
+}
+
+static void
+bench_summarize(double *samples, uint32_t n, struct bench_stats *stats)
+{
+	double sum = 0.0;
+	double sq_sum = 0.0;
+
+	assert(n > 0);
+	for (uint32_t i = 0; i < n; i++)
+		sum += samples[i];
+	stats->mean = sum / n;
+	for (uint32_t i = 0; i < n; i++)
+		sq_sum += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+	stats->stddev = n > 1 ? sqrt(sq_sum / (n - 1)) : 0.0;
+	qsort(samples, n, sizeof(double), bench_double_comp);
+	stats->min = samples[0];
+	stats->max = samples[n - 1];
+	stats->median = (n & 1) ? samples[n / 2]
+	                        : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+}
+
+static void
+bench_report(const char *name, const char *unit, double *samples, uint32_t n)
+{
+	struct bench_stats stats;
+
+	bench_summarize(samples, n, &stats);
+	fprintf(stdout, "%-10s: %12.2f %s  (+- %.2f%%, min %.2f, median %.2f, "
+	        "max %.2f, n = %u)\n", name, stats.mean, unit,
+	        stats.mean > 0 ? 100.0 * stats.stddev / stats.mean : 0.0,
+	        stats.min, stats.median, stats.max, n);
+}
+
+//===------------------------------------------------------------------------===
+// Decision sequences
+//===------------------------------------------------------------------------===
+static inline uint64_t
+bench_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return x;
+}
+
+/**
+ *  Records 'n_seqs' decision sequences. Each sequence starts at decision level
+ *  zero and picks random unassigned variables, with random polarities, until
+ *  propagation runs into a conflict or all variables are assigned. Sequences
+ *  are stored back to back, each one terminated by UNDEF. When a sequence ends
+ *  in a conflict, its index is recorded in 'confls' so that analyze can be
+ *  measured on it later.
+ */
+static void
+bench_record(solver_t *s, struct bench_opts *opts, vec_ui32_t *seqs, vec_ui32_t *confls)
+{
+	uint64_t rng = opts->seed ? opts->seed : 0x9E3779B97F4A7C15ULL;
+	uint32_t n_vars = s->n_vars;
+	vec_ui32_t *free_vars = vec_ui32_alloc(n_vars);
+
+	for (uint32_t seq = 0; seq < opts->n_seqs; seq++) {
+		cref_t confl = CREF_UNDEF;
+
+		vec_clear(free_vars);
+		for (uint32_t var = 0; var < n_vars; var++)
+			if (var_value(s, var) == VAR_UNASSING)
+				vec_push_back(free_vars, var);
+		while (confl == CREF_UNDEF && vec_size(free_vars)) {
+			uint32_t idx = bench_rand(&rng) % vec_size(free_vars);
+			uint32_t var = vec_at(free_vars, idx);
+			uint32_t lit;
+
+			vec_assign(free_vars, idx, vec_at(free_vars, vec_size(free_vars) - 1));
+			vec_shrink(free_vars, vec_size(free_vars) - 1);
+			if (var_value(s, var) != VAR_UNASSING)
+				continue;
+			lit = var2lit(var, bench_rand(&rng) & 1);
+			vec_push_back(seqs, lit);
+			solver_new_decision(s, lit);
+			confl = solver_propagate(s);
+		}
+		vec_push_back(seqs, UNDEF);
+		if (confl != CREF_UNDEF)
+			vec_push_back(confls, seq);
+		solver_backjump(s, 0);
+	}
+	vec_free(free_vars);
+}
+
+/**
+ *  Replays the sequence starting at 'start' and returns the conflict it ends
+ *  with (or CREF_UNDEF). The index of the next sequence is returned in 'next'.
+ */
+static inline cref_t
+bench_replay(solver_t *s, vec_ui32_t *seqs, uint32_t start, uint32_t *next)
+{
+	uint32_t *lits = vec_data(seqs);
+	cref_t confl = CREF_UNDEF;
+	uint32_t i;
+
+	for (i = start; lits[i] != UNDEF; i++) {
+		if (confl != CREF_UNDEF || var_value(s, lit2var(lits[i])) != VAR_UNASSING)
+			continue;
+		solver_new_decision(s, lits[i]);
+		confl = solver_propagate(s);
+	}
+	*next = i + 1;
+	return confl;
+}
+
+//===------------------------------------------------------------------------===
+// Kernels
+//===------------------------------------------------------------------------===
+static void
+bench_propagate(solver_t *s, struct bench_opts *opts, vec_ui32_t *seqs)
+{
+	double *samples = STM_CALLOC(double, opts->n_reps);
+
+	for (uint32_t rep = 0; rep < opts->n_reps; rep++) {
+		uint64_t n_props = s->stats.n_propagations;
+		double elapsed = 0.0;
+		uint32_t i = 0;
+
+		/* Backjumps are not part of the measurement */
+		while (i < vec_size(seqs)) {
+			double start = stm_clock();
+			bench_replay(s, seqs, i, &i);
+			elapsed += stm_clock() - start;
+			solver_backjump(s, 0);
+		}
+		samples[rep] = (s->stats.n_propagations - n_props) / elapsed / 1e6;
+	}
+	bench_report("propagate", "Mprops/s", samples, opts->n_reps);
+	STM_FREE(samples);
+}
+
+static void
+bench_analyze(solver_t *s, struct bench_opts *opts, vec_ui32_t *seqs, vec_ui32_t *confls)
+{
+	double *samples = STM_CALLOC(double, opts->n_reps);
+	vec_ui32_t *learnt = vec_ui32_alloc(0);
+	vec_ui32_t *starts = vec_ui32_alloc(0);
+	uint32_t i = 0;
+
+	if (vec_size(confls) == 0) {
+		fprintf(stdout, "%-10s: no conflicts captured\n", "analyze");
+		goto cleanup;
+	}
+	while (i < vec_size(seqs)) {
+		vec_push_back(starts, i);
+		for (; vec_at(seqs, i) != UNDEF; i++);
+		i++;
+	}
+	for (uint32_t rep = 0; rep < opts->n_reps; rep++) {
+		double elapsed = 0.0;
+		uint64_t n_analyzed = 0;
+		uint32_t seq, j;
+
+		vec_ui32_foreach(confls, seq, j) {
+			uint32_t bt_level, next;
+			cref_t confl = bench_replay(s, seqs, vec_at(starts, seq), &next);
+			double start;
+
+			assert(confl != CREF_UNDEF);
+			start = stm_clock();
+			for (uint32_t k = 0; k < opts->n_analyze; k++) {
+				vec_clear(learnt);
+				solver_analyze(s, confl, learnt, &bt_level);
+			}
+			elapsed += stm_clock() - start;
+			n_analyzed += opts->n_analyze;
+			solver_backjump(s, 0);
+		}
+		samples[rep] = n_analyzed / elapsed / 1e3;
+	}
+	bench_report("analyze", "Kconfl/s", samples, opts->n_reps);
+cleanup:
+	vec_free(starts);
+	vec_free(learnt);
+	STM_FREE(samples);
+}
+
+static void
+bench_parse(char *fname, struct bench_opts *opts)
+{
+	double *scan_samples;
+	double *load_samples;
+	size_t size = 0;
+	char *buffer = file_open(fname, &size);
+
+	if (buffer == NULL) {
+		fprintf(stdout, "%-10s: the file can't be read\n", "parse");
+		return;
+	}
+	scan_samples = STM_CALLOC(double, opts->n_reps);
+	load_samples = STM_CALLOC(double, opts->n_reps);
+	for (uint32_t rep = 0; rep < opts->n_reps; rep++) {
+		char *token = buffer;
+		int64_t checksum = 0;
+		int error = 0;
+		double start = stm_clock();
+
+		/* Tokenizer only: the same scanning the reader does on clauses */
+		while (1) {
+			skip_spaces(&token);
+			if (*token == 0)
+				break;
+			if (*token == 'c' || *token == 'p') {
+				skip_line(&token);
+				continue;
+			}
+			checksum += read_int(&token, &error);
+			if (error)
+				break;
+		}
+		scan_samples[rep] = size / (stm_clock() - start) / 1e6;
+		/* Keep the compiler from dropping the loop */
+		if (checksum == INT64_MIN)
+			fprintf(stdout, "%lld\n", (long long) checksum);
+	}
+	bench_report("read_int", "MB/s", scan_samples, opts->n_reps);
+
+	for (uint32_t rep = 0; rep < opts->n_reps; rep++) {
+		satomi_t *p = NULL;
+		double start = stm_clock();
+
+		satomi_parse_dimacs(fname, NULL, &p);
+		load_samples[rep] = size / (stm_clock() - start) / 1e6;
+		if (p)
+			satomi_destroy(p);
+	}
+	bench_report("parse", "MB/s", load_samples, opts->n_reps);
+	STM_FREE(buffer);
+	STM_FREE(scan_samples);
+	STM_FREE(load_samples);
+}
+
+//===------------------------------------------------------------------------===
+// Main
+//===------------------------------------------------------------------------===
+static void bench_usage(int status) __attribute__((noreturn));
+
+static void
+bench_usage(int status)
+{
+	if (status == EXIT_FAILURE)
+		fprintf(stdout, "Try 'satomi_bench -h' for more information\n");
+	else
+		fprintf(stdout, "Usage: satomi_bench [options] <input_file>\n\n" \
+		        "Options:\n"                                         \
+		        "\t-k <kernels>" "\t : kernels to run, any of 'p' (propagate), " \
+		        "'a' (analyze) and 'P' (parse). Default: 'paP'.\n"      \
+		        "\t-r <n>"  "\t\t : number of repetitions (10).\n"    \
+		        "\t-s <n>"  "\t\t : number of decision sequences (1000).\n" \
+		        "\t-a <n>"  "\t\t : analyze calls per conflict (100).\n" \
+		        "\t-S <n>"  "\t\t : random seed.\n"                   \
+		        "\t-h"      "\t\t : display available options.\n\n");
+	exit(status);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_opts opts = { 10, 1000, 100, 0, "paP" };
+	vec_ui32_t *seqs;
+	vec_ui32_t *confls;
+	satomi_t *s = NULL;
+	char *fname;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "k:r:s:a:S:h")) != -1) {
+		switch (opt) {
+		case 'k':
+			strncpy(opts.kernels, optarg, sizeof(opts.kernels) - 1);
+			break;
+		case 'r':
+			opts.n_reps = (uint32_t) atoi(optarg);
+			break;
+		case 's':
+			opts.n_seqs = (uint32_t) atoi(optarg);
+			break;
+		case 'a':
+			opts.n_analyze = (uint32_t) atoi(optarg);
+			break;
+		case 'S':
+			opts.seed = strtoull(optarg, NULL, 10);
+			break;
+		case 'h':
+			bench_usage(EXIT_SUCCESS);
+		default:
+			bench_usage(EXIT_FAILURE);
+		}
+	}
+	if (optind == argc || opts.n_reps == 0)
+		bench_usage(EXIT_FAILURE);
+	fname = argv[optind];
+
+	if (satomi_parse_dimacs(fname, NULL, &s) != SATOMI_OK || s == NULL) {
+		fprintf(stdout, "[bench] Instance is trivially UNSAT or invalid.\n");
+		return 1;
+	}
+	fprintf(stdout, "[bench] %s: %u variables, %u clauses\n", fname,
+	        s->n_vars, vec_size(s->clauses));
+
+	seqs = vec_ui32_alloc(0);
+	confls = vec_ui32_alloc(0);
+	bench_record(s, &opts, seqs, confls);
+	fprintf(stdout, "[bench] recorded %u sequences (%u decisions, %u conflicts)\n",
+	        opts.n_seqs, vec_size(seqs) - opts.n_seqs, vec_size(confls));
+
+	if (strchr(opts.kernels, 'p'))
+		bench_propagate(s, &opts, seqs);
+	if (strchr(opts.kernels, 'a'))
+		bench_analyze(s, &opts, seqs, confls);
+	if (strchr(opts.kernels, 'P'))
+		bench_parse(fname, &opts);
+
+	vec_free(seqs);
+	vec_free(confls);
+	satomi_destroy(s);
+	return 0;
+}
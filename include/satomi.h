@@ -11,6 +11,13 @@
 
 #include <stdint.h>
 
+/* The library only exports its API, everything else has hidden visibility */
+#if defined(_WIN32)
+#define SATOMI_API
+#else
+#define SATOMI_API __attribute__((visibility("default")))
+#endif
+
 /** Return valeus */
 enum {
 	SATOMI_ERR = 0,
@@ -27,8 +34,91 @@ struct solver_t_;
 typedef struct solver_t_ satomi_t;
 
 typedef struct satomi_opts satomi_opts_t;
+/** Decision heuristics */
+enum {
+	SATOMI_BRANCH_MODES  = 0, /* VMTF and frequent restarts, alternating with
+	                           * EVSIDS and rare restarts */
+	SATOMI_BRANCH_STATIC = 1, /* Variables in order, no restarts */
+	SATOMI_BRANCH_LRB    = 2, /* Learning rate branching */
+	SATOMI_BRANCH_CHB    = 3  /* Conflict history based branching */
+};
+
+/** Answer checking modes */
+enum {
+	SATOMI_CHECK_NONE   = 0,
+	SATOMI_CHECK_SYNC   = 1, /* Check learnt clauses once the search is over */
+	SATOMI_CHECK_THREAD = 2  /* Check learnt clauses on a second thread */
+};
+
+/**
+ *  Hooks called on search events, the unset ones cost a test of their pointer
+ *  (and nothing at all when built with HOOKS=0). Literals are given as the
+ *  solver encodes them: 2 * var + 1 for a negative literal.
+ */
+struct satomi_hooks {
+	void *data; /* passed to every hook */
+	void (*decision)(void *, uint32_t lit, uint32_t level);
+	void (*conflict)(void *, uint64_t n_conflicts, uint32_t level);
+	void (*learnt)(void *, const uint32_t *lits, uint32_t size, uint32_t lbd);
+	void (*backjump)(void *, uint32_t from_level, uint32_t to_level);
+	void (*restart)(void *, uint64_t n_conflicts);
+	void (*reduce)(void *, uint64_t n_kept, uint64_t n_removed);
+};
+
+/**
+ *  Clause sharing with other solvers of the same formula. Learnt clauses with
+ *  at most 'max_size' literals and an LBD of at most 'max_lbd' are exported as
+ *  they are learnt. Every 'import_interval' conflicts, and at level zero,
+ *  'import_clauses' is called to queue clauses (satomi_import_clause), which
+ *  are then added to the search.
+ */
+struct satomi_sharing {
+	void *data; /* passed to both callbacks */
+	void (*export_clause)(void *, const uint32_t *lits, uint32_t size, uint32_t lbd);
+	void (*import_clauses)(void *, satomi_t *);
+	uint32_t max_size;
+	uint32_t max_lbd;
+	uint32_t import_interval; /* in conflicts */
+};
+
+/**
+ *  Bounded model checking of a circuit, up to 'max_depth' frames, starting no
+ *  new depth once 'budget' seconds are spent (0 for no limit). 'depth' is
+ *  called after each depth, 'witness' with each line of a counterexample.
+ */
+struct satomi_bmc {
+	uint32_t max_depth;
+	double budget;
+	void *data; /* passed to both callbacks */
+	void (*depth)(void *, uint32_t depth, int status, double seconds);
+	void (*witness)(void *, const char *line);
+};
+
 struct satomi_opts {
 	char verbose;
+	char check;
+	char branching;
+	uint64_t mode_ticks; /* length of the first mode, see SATOMI_BRANCH_MODES */
+	/* The search gives up, undecided, once stats.n_ticks reaches it (0 for
+	 * no limit) */
+	uint64_t tick_limit;
+	/* Tag the original clauses with selectors, for cores and MUSes */
+	char core;
+	/* Record the resolution proof, for interpolants of an A/B partition */
+	char interpolate;
+	/* Periodic checkpoints: the path must outlive the solver */
+	const char *checkpoint;
+	uint64_t checkpoint_interval; /* in conflicts */
+	/* Conflict traces: the implication graphs of the conflicts numbered
+	 * trace_first + k * trace_every, up to trace_last, appended to 'trace' */
+	const char *trace;
+	uint64_t trace_every;
+	uint64_t trace_first;
+	uint64_t trace_last;
+	struct satomi_hooks hooks;
+	/* Binary log of the search events, replaces the hooks */
+	const char *event_log;
+	struct satomi_sharing sharing;
 };
 
 struct satomi_stats {
@@ -36,22 +126,82 @@ struct satomi_stats {
 	uint64_t n_propagations;
 	uint64_t n_inspects;
 	uint64_t n_conflicts;
+	uint64_t n_restarts;
+	uint64_t n_ticks;  /* cache lines touched by the search, see tick_limit */
 
 	uint64_t n_lits;
+	uint64_t n_simplify;
+	uint64_t n_removed_clauses;
+	uint64_t n_removed_lits;
+	uint64_t n_exported;
+	uint64_t n_imported;
+	uint64_t n_models;
+	uint64_t n_solves;
 	double init_time;
 };
 
 //===------------------------------------------------------------------------===
-extern satomi_t *satomi_create(char *);
-extern void satomi_destroy(satomi_t *);
-extern void satomi_default_opts(satomi_opts_t *);
-extern void satomi_configure(satomi_t *, satomi_opts_t *);
-extern int  satomi_parse_dimacs(char *, satomi_t **);
-extern void satomi_add_variable(satomi_t *);
-extern int  satomi_add_clause(satomi_t *, uint32_t *, uint32_t);
-extern int  satomi_solve(satomi_t *);
-
-extern void satomi_print_stats(satomi_t *);
-extern void satomi_print_clauses(satomi_t *);
+/**
+ *  Solver instances share no state: different instances can be used
+ *  concurrently, each one from a single thread at a time.
+ */
+extern SATOMI_API satomi_t *satomi_create(const char *);
+extern SATOMI_API void satomi_destroy(satomi_t *);
+extern SATOMI_API void satomi_default_opts(satomi_opts_t *);
+extern SATOMI_API void satomi_configure(satomi_t *, satomi_opts_t *);
+extern SATOMI_API int  satomi_parse_dimacs(char *, satomi_opts_t *, satomi_t **);
+extern SATOMI_API int  satomi_parse_bcnf(char *, satomi_opts_t *, satomi_t **);
+extern SATOMI_API int  satomi_parse_wcnf(char *, satomi_opts_t *, satomi_t **);
+extern SATOMI_API int  satomi_parse_partition(char *, char *, satomi_opts_t *,
+                                             satomi_t **);
+extern SATOMI_API int  satomi_parse_aiger(char *, satomi_opts_t *, const uint32_t *,
+                                         uint32_t, satomi_t **);
+extern SATOMI_API int  satomi_write_bcnf(satomi_t *, const char *, int);
+extern SATOMI_API void satomi_add_variable(satomi_t *);
+extern SATOMI_API int  satomi_add_clause(satomi_t *, uint32_t *, uint32_t);
+extern SATOMI_API int  satomi_add_clauses(satomi_t *, const uint32_t *,
+                                         const uint32_t *, uint32_t);
+extern SATOMI_API int  satomi_solve(satomi_t *);
+extern SATOMI_API int  satomi_solve_assumptions(satomi_t *, const uint32_t *, uint32_t);
+extern SATOMI_API uint32_t satomi_failed_assumptions(satomi_t *, const uint32_t **);
+extern SATOMI_API int  satomi_value(satomi_t *, uint32_t);
+extern SATOMI_API int  satomi_enumerate(satomi_t *, const uint32_t *, uint32_t,
+                                       int (*)(void *, const uint32_t *, uint32_t),
+                                       void *);
+extern SATOMI_API int  satomi_backbone(satomi_t *, const uint32_t *, uint32_t,
+                                      void (*)(void *, const uint32_t *, uint32_t),
+                                      void *);
+extern SATOMI_API int  satomi_core(satomi_t *,
+                                  void (*)(void *, const uint32_t *, uint32_t),
+                                  void *);
+extern SATOMI_API int  satomi_mus(satomi_t *,
+                                 void (*)(void *, const uint32_t *, uint32_t),
+                                 void *);
+extern SATOMI_API uint32_t satomi_core_clause(satomi_t *, uint32_t, const uint32_t **);
+extern SATOMI_API int  satomi_bmc(char *, satomi_opts_t *, const struct satomi_bmc *,
+                                  satomi_t **);
+extern SATOMI_API int  satomi_add_soft(satomi_t *, const uint32_t *, uint32_t, uint64_t);
+extern SATOMI_API int  satomi_maxsat(satomi_t *,
+                                    void (*)(void *, uint64_t, const uint32_t *, uint32_t),
+                                    void *);
+extern SATOMI_API int  satomi_set_partition(satomi_t *, int);
+extern SATOMI_API int  satomi_write_interpolant(satomi_t *, const char *);
+extern SATOMI_API int  satomi_check(satomi_t *, int);
+extern SATOMI_API int  satomi_checkpoint(satomi_t *, const char *);
+extern SATOMI_API satomi_t *satomi_restore(const char *);
+extern SATOMI_API int  satomi_replay(const char *, const struct satomi_hooks *);
+extern SATOMI_API int  satomi_import_clause(satomi_t *, const uint32_t *, uint32_t);
+
+/**
+ *  Clause sharing between local processes through a shared memory segment
+ *  named 'name', each process using its own 'peer' slot.
+ */
+typedef struct satomi_share satomi_share_t;
+extern SATOMI_API satomi_share_t *satomi_share_open(const char *name, uint32_t peer);
+extern SATOMI_API void satomi_share_attach(satomi_share_t *, satomi_opts_t *);
+extern SATOMI_API void satomi_share_close(satomi_share_t *);
+
+extern SATOMI_API void satomi_print_stats(satomi_t *);
+extern SATOMI_API void satomi_print_clauses(satomi_t *);
 
 #endif /* SATOMI__SATOMI_H */
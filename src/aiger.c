@@ -0,0 +1,798 @@
+//===--- aiger.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "aiger.h"
+#include "core.h"
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/parse.h"
+#include "utils/vec/vec.h"
+
+/* How a node is encoded */
+enum {
+	AIG_CNF_AND,
+	AIG_CNF_ITE,
+	AIG_CNF_XOR
+};
+
+//===------------------------------------------------------------------------===
+// AIG internal functions
+//===------------------------------------------------------------------------===
+static inline uint32_t
+aig_hash(uint32_t fanin0, uint32_t fanin1)
+{
+	return fanin0 * 0x9E3779B1u ^ fanin1 * 0x85EBCA77u;
+}
+
+static void
+aig_rehash(struct aig *aig)
+{
+	uint32_t size = 2 * (aig->table_mask + 1);
+
+	STM_FREE(aig->table);
+	aig->table = STM_CALLOC(uint32_t, size);
+	aig->table_mask = size - 1;
+	for (uint32_t var = 1; var < aig->n_nodes; var++) {
+		uint32_t i;
+
+		if (!aig_is_and(aig, var))
+			continue;
+		i = aig_hash(aig_fanin0(aig, var), aig_fanin1(aig, var)) & aig->table_mask;
+		while (aig->table[i])
+			i = (i + 1) & aig->table_mask;
+		aig->table[i] = var;
+	}
+}
+
+static uint32_t
+aig_new_node(struct aig *aig, uint32_t fanin0, uint32_t fanin1)
+{
+	if (aig->n_nodes == aig->cap_nodes) {
+		aig->cap_nodes = aig->cap_nodes ? 2 * aig->cap_nodes : 64;
+		aig->fanins = STM_REALLOC(uint32_t, aig->fanins, 2 * aig->cap_nodes);
+		aig->n_refs = STM_REALLOC(uint32_t, aig->n_refs, aig->cap_nodes);
+	}
+	aig->fanins[2 * aig->n_nodes] = fanin0;
+	aig->fanins[2 * aig->n_nodes + 1] = fanin1;
+	aig->n_refs[aig->n_nodes] = 0;
+	return aig->n_nodes++;
+}
+
+/**
+ *  Reads the unsigned numbers on the current line, at most 'max' of them, and
+ *  moves to the next line. Returns how many were read, -1 if malformed.
+ */
+static int
+aig_read_line(char **pos, uint32_t *values, int max)
+{
+	int n = 0;
+
+	while (1) {
+		uint64_t value = 0;
+
+		for (; **pos == ' ' || **pos == '\t' || **pos == '\r'; (*pos)++);
+		if (**pos == '\n') {
+			(*pos)++;
+			return n;
+		}
+		if (**pos == '\0')
+			return n;
+		if (!isdigit(**pos) || n == max)
+			return -1;
+		for (; isdigit(**pos) && value <= UINT32_MAX; (*pos)++)
+			value = value * 10 + (**pos - '0');
+		if (value > UINT32_MAX)
+			return -1;
+		values[n++] = (uint32_t) value;
+	}
+}
+
+/** Reads a binary AIGER delta: 7 bits per byte, the last byte below 128. */
+static int
+aig_read_delta(char **pos, const char *end, uint32_t *delta)
+{
+	uint64_t value = 0;
+	uint32_t shift = 0;
+	unsigned char ch;
+
+	do {
+		if (*pos >= end || shift > 28)
+			return 0;
+		ch = (unsigned char) *(*pos)++;
+		value |= (uint64_t) (ch & 0x7f) << shift;
+		shift += 7;
+	} while (ch & 0x80);
+	if (value > UINT32_MAX)
+		return 0;
+	*delta = (uint32_t) value;
+	return 1;
+}
+
+/** Reads 'n' lines of a single literal each into 'lits'. */
+static int
+aig_read_lits(char **pos, uint32_t max_lit, vec_ui32_t *lits, uint32_t n)
+{
+	uint32_t lit;
+
+	for (uint32_t i = 0; i < n; i++) {
+		if (aig_read_line(pos, &lit, 1) != 1 || lit > max_lit)
+			return 0;
+		vec_push_back(lits, lit);
+	}
+	return 1;
+}
+
+/**
+ *  Hashes the AND node 'var' of the file once its fanins are, in depth first
+ *  order. 'defs' has the fanins of the file, 'lits_of' the literal of each
+ *  variable of the file in the AIG once hashed. Returns false on a cycle or an
+ *  undefined literal.
+ */
+static int
+aig_resolve(struct aig *aig, const uint32_t *defs, uint32_t *lits_of, uint8_t *mark,
+            vec_ui32_t *stack, uint32_t var)
+{
+	vec_clear(stack);
+	vec_push_back(stack, var);
+	while (vec_size(stack)) {
+		uint32_t v = vec_at(stack, vec_size(stack) - 1);
+		uint32_t f0 = defs[2 * v];
+		uint32_t f1 = defs[2 * v + 1];
+		uint32_t l0, l1;
+
+		if (lits_of[v] != UNDEF) {
+			vec_pop_back(stack);
+			continue;
+		}
+		if (f0 == UNDEF)
+			return 0;
+		l0 = lits_of[aig_var(f0)];
+		l1 = lits_of[aig_var(f1)];
+		if (l0 == UNDEF || l1 == UNDEF) {
+			if (mark[v])
+				return 0;
+			mark[v] = 1;
+			if (l0 == UNDEF)
+				vec_push_back(stack, aig_var(f0));
+			if (l1 == UNDEF)
+				vec_push_back(stack, aig_var(f1));
+			continue;
+		}
+		lits_of[v] = aig_and(aig, l0 ^ (f0 & 1), l1 ^ (f1 & 1));
+		vec_pop_back(stack);
+	}
+	return 1;
+}
+
+/** Gives file literals in the AIG, returns false if one is undefined. */
+static int
+aig_translate(vec_ui32_t *lits, const uint32_t *lits_of)
+{
+	for (uint32_t i = 0; i < vec_size(lits); i++) {
+		uint32_t lit = vec_at(lits, i);
+
+		if (lits_of[aig_var(lit)] == UNDEF)
+			return 0;
+		vec_data(lits)[i] = lits_of[aig_var(lit)] ^ (lit & 1);
+	}
+	return 1;
+}
+
+//===------------------------------------------------------------------------===
+// AIG external functions
+//===------------------------------------------------------------------------===
+struct aig *
+aig_alloc(uint32_t n_inputs, uint32_t n_latches)
+{
+	struct aig *aig = STM_CALLOC(struct aig, 1);
+
+	aig->n_inputs = n_inputs;
+	aig->n_latches = n_latches;
+	aig->table_mask = 255;
+	aig->table = STM_CALLOC(uint32_t, aig->table_mask + 1);
+	aig->latch_next = vec_ui32_alloc(n_latches);
+	aig->latch_init = vec_ui32_alloc(n_latches);
+	aig->outputs = vec_ui32_alloc(0);
+	aig->bad = vec_ui32_alloc(0);
+	aig->constraints = vec_ui32_alloc(0);
+	for (uint32_t i = 0; i < 1 + n_inputs + n_latches; i++)
+		aig_new_node(aig, UNDEF, UNDEF);
+	return aig;
+}
+
+void
+aig_free(struct aig *aig)
+{
+	STM_FREE(aig->fanins);
+	STM_FREE(aig->n_refs);
+	STM_FREE(aig->table);
+	vec_free(aig->latch_next);
+	vec_free(aig->latch_init);
+	vec_free(aig->outputs);
+	vec_free(aig->bad);
+	vec_free(aig->constraints);
+	STM_FREE(aig);
+}
+
+/**
+ *  Returns the literal of the AND of two literals: constants and trivial cases
+ *  are folded, and an existing node with the same fanins is reused.
+ */
+uint32_t
+aig_and(struct aig *aig, uint32_t a, uint32_t b)
+{
+	uint32_t i, var;
+
+	if (a > b) {
+		uint32_t tmp = a;
+		a = b;
+		b = tmp;
+	}
+	if (a == 0 || a == (b ^ 1))
+		return 0;
+	if (a == 1 || a == b)
+		return b;
+	i = aig_hash(a, b) & aig->table_mask;
+	for (; (var = aig->table[i]); i = (i + 1) & aig->table_mask)
+		if (aig_fanin0(aig, var) == a && aig_fanin1(aig, var) == b)
+			return 2 * var;
+	var = aig_new_node(aig, a, b);
+	aig->table[i] = var;
+	if (2 * aig_n_ands(aig) > aig->table_mask)
+		aig_rehash(aig);
+	return 2 * var;
+}
+
+/** Counts the fanouts of each node, latches, outputs and properties included. */
+void
+aig_count_refs(struct aig *aig)
+{
+	vec_ui32_t *roots[4] = { aig->latch_next, aig->outputs, aig->bad, aig->constraints };
+
+	memset(aig->n_refs, 0, aig->n_nodes * sizeof(uint32_t));
+	for (uint32_t var = 1; var < aig->n_nodes; var++) {
+		if (!aig_is_and(aig, var))
+			continue;
+		aig->n_refs[aig_var(aig_fanin0(aig, var))]++;
+		aig->n_refs[aig_var(aig_fanin1(aig, var))]++;
+	}
+	for (uint32_t i = 0; i < 4; i++)
+		for (uint32_t j = 0; j < vec_size(roots[i]); j++)
+			aig->n_refs[aig_var(vec_at(roots[i], j))]++;
+}
+
+/**
+ *  Reads an AIGER file, ASCII ('aag') or binary ('aig'), with the sections of
+ *  AIGER 1.9 (bad states, invariant constraints; justice and fairness
+ *  properties are skipped). AND nodes are hashed as they are read, so that
+ *  the resulting AIG has no structural duplicates. Returns NULL on a read or
+ *  format error.
+ */
+struct aig *
+aig_read(const char *fname)
+{
+	struct aig *aig = NULL;
+	uint32_t header[9] = { 0 };
+	uint32_t values[3];
+	uint32_t *defs = NULL, *lits_of = NULL;
+	uint8_t *mark = NULL;
+	vec_ui32_t *stack = vec_ui32_alloc(0);
+	size_t size;
+	char *buffer = file_open(fname, &size);
+	char *pos = buffer;
+	char *end = buffer + size;
+	uint32_t max_var, max_lit, n_justice;
+	int binary, n;
+	int valid = 0;
+
+	if (buffer == NULL) {
+		vec_free(stack);
+		return NULL;
+	}
+	if (strncmp(pos, "aag ", 4) && strncmp(pos, "aig ", 4))
+		goto error;
+	binary = (pos[1] == 'i');
+	pos += 4;
+	n = aig_read_line(&pos, header, 9);
+	max_var = header[0];
+	if (n < 5 || max_var >= UINT32_MAX / 2 - 1
+	    || (uint64_t) header[1] + header[2] + header[4] > max_var
+	    || (binary && header[1] + header[2] + header[4] != max_var))
+		goto error;
+	max_lit = 2 * max_var + 1;
+	aig = aig_alloc(header[1], header[2]);
+	aig->n_file_ands = header[4];
+	defs = STM_ALLOC(uint32_t, 2 * (max_var + 1));
+	lits_of = STM_ALLOC(uint32_t, max_var + 1);
+	mark = STM_CALLOC(uint8_t, max_var + 1);
+	for (uint32_t var = 0; var <= max_var; var++) {
+		defs[2 * var] = defs[2 * var + 1] = UNDEF;
+		lits_of[var] = UNDEF;
+	}
+	lits_of[0] = 0;
+
+	/* Inputs and latches */
+	for (uint32_t i = 0; i < aig->n_inputs; i++) {
+		values[0] = 2 * (i + 1);
+		if (!binary && (aig_read_line(&pos, values, 1) != 1 || values[0] > max_lit))
+			goto error;
+		if ((values[0] & 1) || values[0] == 0 || lits_of[aig_var(values[0])] != UNDEF)
+			goto error;
+		lits_of[aig_var(values[0])] = 2 * (1 + i);
+	}
+	for (uint32_t i = 0; i < aig->n_latches; i++) {
+		uint32_t lit = 2 * (aig->n_inputs + i + 1);
+
+		n = aig_read_line(&pos, binary ? values + 1 : values, binary ? 2 : 3);
+		if (binary)
+			values[0] = lit, n++;
+		if (n < 2 || (values[0] & 1) || values[0] == 0 || values[0] > max_lit
+		    || values[1] > max_lit || lits_of[aig_var(values[0])] != UNDEF)
+			goto error;
+		lits_of[aig_var(values[0])] = aig_latch(aig, i);
+		vec_push_back(aig->latch_next, values[1]);
+		if (n == 2 || values[2] == 0)
+			vec_push_back(aig->latch_init, 0);
+		else if (values[2] == 1)
+			vec_push_back(aig->latch_init, 1);
+		else if (values[2] == values[0])
+			vec_push_back(aig->latch_init, UNDEF);
+		else
+			goto error;
+	}
+
+	/* Outputs and properties */
+	if (!aig_read_lits(&pos, max_lit, aig->outputs, header[3])
+	    || !aig_read_lits(&pos, max_lit, aig->bad, header[5])
+	    || !aig_read_lits(&pos, max_lit, aig->constraints, header[6]))
+		goto error;
+	n_justice = 0;
+	for (uint32_t i = 0; i < header[7]; i++) {
+		if (aig_read_line(&pos, values, 1) != 1)
+			goto error;
+		n_justice += values[0];
+	}
+	for (uint32_t i = 0; i < n_justice + header[8]; i++)
+		if (aig_read_line(&pos, values, 1) != 1)
+			goto error;
+
+	/* AND nodes */
+	for (uint32_t i = 0; i < aig->n_file_ands; i++) {
+		if (binary) {
+			uint32_t delta0, delta1;
+
+			values[0] = 2 * (aig->n_inputs + aig->n_latches + i + 1);
+			if (!aig_read_delta(&pos, end, &delta0) || !aig_read_delta(&pos, end, &delta1)
+			    || delta0 == 0 || delta0 > values[0] || delta1 > values[0] - delta0)
+				goto error;
+			values[1] = values[0] - delta0;
+			values[2] = values[1] - delta1;
+		} else if (aig_read_line(&pos, values, 3) != 3)
+			goto error;
+		if ((values[0] & 1) || values[0] == 0 || values[0] > max_lit
+		    || values[1] > max_lit || values[2] > max_lit
+		    || lits_of[aig_var(values[0])] != UNDEF
+		    || defs[values[0]] != UNDEF)
+			goto error;
+		defs[values[0]] = values[1];
+		defs[values[0] + 1] = values[2];
+	}
+	for (uint32_t var = 1; var <= max_var; var++)
+		if (defs[2 * var] != UNDEF
+		    && !aig_resolve(aig, defs, lits_of, mark, stack, var))
+			goto error;
+
+	/* Literals are given in the AIG once hashed */
+	if (!aig_translate(aig->latch_next, lits_of) || !aig_translate(aig->outputs, lits_of)
+	    || !aig_translate(aig->bad, lits_of) || !aig_translate(aig->constraints, lits_of))
+		goto error;
+	aig_count_refs(aig);
+	valid = 1;
+error:
+	if (!valid) {
+		fprintf(stdout, "Invalid AIGER file: %s\n", fname);
+		if (aig)
+			aig_free(aig);
+		aig = NULL;
+	}
+	STM_FREE(defs);
+	STM_FREE(lits_of);
+	STM_FREE(mark);
+	STM_FREE(buffer);
+	vec_free(stack);
+	return aig;
+}
+
+/** Writes a binary AIGER delta: 7 bits per byte, the last byte below 128. */
+static void
+aig_write_delta(FILE *file, uint32_t delta)
+{
+	while (delta & ~0x7fu) {
+		fputc((int) ((delta & 0x7f) | 0x80), file);
+		delta >>= 7;
+	}
+	fputc((int) delta, file);
+}
+
+static inline uint32_t
+aig_map(const uint32_t *lits, uint32_t lit)
+{
+	return lits[aig_var(lit)] ^ (lit & 1);
+}
+
+/**
+ *  Writes the inputs, latches and outputs of an AIG in AIGER, binary if the
+ *  name ends in '.aig', ASCII otherwise. Only the AND nodes in the cone of
+ *  influence of the latches and outputs are written, renumbered in order. When
+ *  'names' is given, input i is named after 'names[i]' in the symbol table.
+ */
+int
+aig_write(struct aig *aig, const char *fname, const uint32_t *names)
+{
+	const char *dot = strrchr(fname, '.');
+	int binary = dot && !strcmp(dot, ".aig");
+	uint32_t first_and = 1 + aig->n_inputs + aig->n_latches;
+	uint32_t *lits = STM_ALLOC(uint32_t, aig->n_nodes);
+	uint8_t *mark = STM_CALLOC(uint8_t, aig->n_nodes);
+	vec_ui32_t *roots[2] = { aig->latch_next, aig->outputs };
+	uint32_t n_ands = 0;
+	FILE *file;
+	int ret = SATOMI_OK;
+
+	/* AND nodes come after their fanins, so a backward sweep marks the cone */
+	for (uint32_t i = 0; i < 2; i++)
+		for (uint32_t j = 0; j < vec_size(roots[i]); j++)
+			mark[aig_var(vec_at(roots[i], j))] = 1;
+	for (uint32_t var = aig->n_nodes; var-- > first_and; ) {
+		if (!mark[var])
+			continue;
+		mark[aig_var(aig_fanin0(aig, var))] = 1;
+		mark[aig_var(aig_fanin1(aig, var))] = 1;
+	}
+	for (uint32_t var = 0; var < aig->n_nodes; var++)
+		if (var < first_and)
+			lits[var] = 2 * var;
+		else if (mark[var])
+			lits[var] = 2 * (first_and + n_ands++);
+
+	file = fopen(fname, binary ? "wb" : "w");
+	if (file == NULL) {
+		fprintf(stdout, "Couldn't open file: %s\n", fname);
+		STM_FREE(lits);
+		STM_FREE(mark);
+		return SATOMI_ERR;
+	}
+	fprintf(file, "%s %u %u %u %u %u\n", binary ? "aig" : "aag",
+	        first_and - 1 + n_ands, aig->n_inputs, aig->n_latches,
+	        vec_size(aig->outputs), n_ands);
+	if (!binary)
+		for (uint32_t i = 0; i < aig->n_inputs; i++)
+			fprintf(file, "%u\n", 2 * (i + 1));
+	for (uint32_t i = 0; i < aig->n_latches; i++) {
+		uint32_t init = vec_at(aig->latch_init, i);
+
+		if (!binary)
+			fprintf(file, "%u ", aig_latch(aig, i));
+		fprintf(file, "%u", aig_map(lits, vec_at(aig->latch_next, i)));
+		if (init != 0)
+			fprintf(file, " %u", init == UNDEF ? aig_latch(aig, i) : 1);
+		fputc('\n', file);
+	}
+	for (uint32_t i = 0; i < vec_size(aig->outputs); i++)
+		fprintf(file, "%u\n", aig_map(lits, vec_at(aig->outputs, i)));
+	for (uint32_t var = first_and; var < aig->n_nodes; var++) {
+		uint32_t lhs = lits[var];
+		uint32_t rhs0 = aig_map(lits, aig_fanin0(aig, var));
+		uint32_t rhs1 = aig_map(lits, aig_fanin1(aig, var));
+
+		if (!mark[var])
+			continue;
+		if (rhs0 < rhs1) {
+			uint32_t tmp = rhs0;
+			rhs0 = rhs1;
+			rhs1 = tmp;
+		}
+		if (binary) {
+			aig_write_delta(file, lhs - rhs0);
+			aig_write_delta(file, rhs0 - rhs1);
+		} else
+			fprintf(file, "%u %u %u\n", lhs, rhs0, rhs1);
+	}
+	if (names)
+		for (uint32_t i = 0; i < aig->n_inputs; i++)
+			fprintf(file, "i%u %u\n", i, names[i]);
+	if (ferror(file))
+		ret = SATOMI_ERR;
+	if (fclose(file) != 0)
+		ret = SATOMI_ERR;
+	if (!ret)
+		fprintf(stdout, "Couldn't write file: %s\n", fname);
+	STM_FREE(lits);
+	STM_FREE(mark);
+	return ret;
+}
+
+//===------------------------------------------------------------------------===
+// Encoding internal functions
+//===------------------------------------------------------------------------===
+/** Returns true if an AND node can be merged into its single fanout. */
+static inline int
+aig_cnf_inner(struct aig_cnf *cnf, uint32_t var)
+{
+	return aig_is_and(cnf->aig, var) && cnf->aig->n_refs[var] == 1
+	       && cnf->map[var] == UNDEF;
+}
+
+static inline uint32_t
+aig_cnf_lit(struct aig_cnf *cnf, uint32_t lit)
+{
+	return cnf->map[aig_var(lit)] ^ (lit & 1);
+}
+
+static uint32_t
+aig_cnf_new_lit(solver_t *s)
+{
+	satomi_add_variable(s);
+	return var2lit(s->n_vars - 1, 0);
+}
+
+/**
+ *  Finds how an AND node is encoded and leaves in 'leaves' the literals it is a
+ *  function of. A node whose two fanins are the negations of single fanout ANDs
+ *  sharing a variable in opposite phases is the negation of an ITE (of a XOR
+ *  when the other two literals are opposite too): the leaves are the control,
+ *  then and else literals. Otherwise, the single fanout ANDs reached through
+ *  uncomplemented edges are merged into one multi-input AND.
+ */
+static int
+aig_cnf_gate(struct aig_cnf *cnf, uint32_t var)
+{
+	struct aig *aig = cnf->aig;
+	uint32_t f0 = aig_fanin0(aig, var);
+	uint32_t f1 = aig_fanin1(aig, var);
+	uint32_t i;
+
+	vec_clear(cnf->leaves);
+	if ((f0 & 1) && (f1 & 1) && aig_cnf_inner(cnf, aig_var(f0))
+	    && aig_cnf_inner(cnf, aig_var(f1))) {
+		uint32_t *p = aig->fanins + 2 * aig_var(f0);
+		uint32_t *q = aig->fanins + 2 * aig_var(f1);
+
+		for (uint32_t j = 0; j < 4; j++) {
+			if (p[j >> 1] != (q[j & 1] ^ 1))
+				continue;
+			vec_push_back(cnf->leaves, p[j >> 1]);
+			vec_push_back(cnf->leaves, p[!(j >> 1)]);
+			vec_push_back(cnf->leaves, q[!(j & 1)]);
+			return (p[!(j >> 1)] == (q[!(j & 1)] ^ 1)) ? AIG_CNF_XOR : AIG_CNF_ITE;
+		}
+	}
+	vec_push_back(cnf->leaves, f0);
+	vec_push_back(cnf->leaves, f1);
+	for (i = 0; i < vec_size(cnf->leaves); ) {
+		uint32_t lit = vec_at(cnf->leaves, i);
+
+		if ((lit & 1) || !aig_cnf_inner(cnf, aig_var(lit))) {
+			i++;
+			continue;
+		}
+		vec_data(cnf->leaves)[i] = aig_fanin0(aig, aig_var(lit));
+		vec_push_back(cnf->leaves, aig_fanin1(aig, aig_var(lit)));
+	}
+	return AIG_CNF_AND;
+}
+
+/** Adds the clauses defining 'lit' as the gate found by 'aig_cnf_gate'. */
+static int
+aig_cnf_define(solver_t *s, struct aig_cnf *cnf, int kind, uint32_t lit)
+{
+	uint32_t *leaves = vec_data(cnf->leaves);
+	uint32_t clause[3];
+	uint32_t c, t, e, ite;
+	int ret = SATOMI_OK;
+
+	if (kind == AIG_CNF_AND) {
+		vec_clear(cnf->clause);
+		vec_push_back(cnf->clause, lit);
+		for (uint32_t i = 0; i < vec_size(cnf->leaves); i++) {
+			clause[0] = lit_neg(lit);
+			clause[1] = aig_cnf_lit(cnf, leaves[i]);
+			vec_push_back(cnf->clause, lit_neg(clause[1]));
+			ret &= aig_cnf_add_clause(s, cnf, clause, 2);
+		}
+		cnf->n_ands++;
+		return ret & aig_cnf_add_clause(s, cnf, vec_data(cnf->clause),
+		                                vec_size(cnf->clause));
+	}
+	/* 'lit' is the negation of ITE(c, t, e) */
+	c = aig_cnf_lit(cnf, leaves[0]);
+	t = aig_cnf_lit(cnf, leaves[1]);
+	e = aig_cnf_lit(cnf, leaves[2]);
+	ite = lit_neg(lit);
+
+	clause[0] = lit_neg(c), clause[1] = lit_neg(t), clause[2] = ite;
+	ret &= aig_cnf_add_clause(s, cnf, clause, 3);
+	clause[0] = lit_neg(c), clause[1] = t, clause[2] = lit_neg(ite);
+	ret &= aig_cnf_add_clause(s, cnf, clause, 3);
+	clause[0] = c, clause[1] = lit_neg(e), clause[2] = ite;
+	ret &= aig_cnf_add_clause(s, cnf, clause, 3);
+	clause[0] = c, clause[1] = e, clause[2] = lit_neg(ite);
+	ret &= aig_cnf_add_clause(s, cnf, clause, 3);
+	if (kind == AIG_CNF_XOR)
+		cnf->n_xors++;
+	else
+		cnf->n_ites++;
+	return ret;
+}
+
+//===------------------------------------------------------------------------===
+// Encoding external functions
+//===------------------------------------------------------------------------===
+struct aig_cnf *
+aig_cnf_alloc(struct aig *aig)
+{
+	struct aig_cnf *cnf = STM_CALLOC(struct aig_cnf, 1);
+
+	cnf->aig = aig;
+	cnf->map = STM_ALLOC(uint32_t, aig->n_nodes);
+	cnf->stack = vec_ui32_alloc(0);
+	cnf->leaves = vec_ui32_alloc(0);
+	cnf->clause = vec_ui32_alloc(0);
+	aig_cnf_clear(cnf);
+	return cnf;
+}
+
+void
+aig_cnf_free(struct aig_cnf *cnf)
+{
+	STM_FREE(cnf->map);
+	vec_free(cnf->stack);
+	vec_free(cnf->leaves);
+	vec_free(cnf->clause);
+	STM_FREE(cnf);
+}
+
+/** Forgets the encoded nodes, so that the next ones get new variables. */
+void
+aig_cnf_clear(struct aig_cnf *cnf)
+{
+	for (uint32_t var = 0; var < cnf->aig->n_nodes; var++)
+		cnf->map[var] = UNDEF;
+}
+
+/**
+ *  Adds a clause of the encoding at level zero, straight to the clause
+ *  database. Definitions over new variables are given to the checker as
+ *  original clauses, which it takes as axioms once it has started checking.
+ */
+int
+aig_cnf_add_clause(solver_t *s, struct aig_cnf *cnf, const uint32_t *lits, uint32_t size)
+{
+	cnf->n_clauses++;
+	if (s->core)
+		return core_add_clause(s, lits, size);
+	if (s->checker)
+		checker_add_original(s->checker, lits, size);
+	return solver_add_clause_unsorted(s, lits, size);
+}
+
+/**
+ *  Returns the solver literal of an AIG literal, encoding its cone of influence
+ *  first: the nodes are visited depth first, each one getting a new variable
+ *  and its definition once its leaves have theirs. Inputs and latches not
+ *  mapped by the caller are free variables.
+ */
+uint32_t
+aig_cnf_encode(solver_t *s, struct aig_cnf *cnf, uint32_t lit)
+{
+	vec_ui32_t *stack = cnf->stack;
+
+	solver_backjump(s, 0);
+	vec_clear(stack);
+	vec_push_back(stack, aig_var(lit) << 1);
+	while (vec_size(stack)) {
+		uint32_t entry = vec_at(stack, vec_size(stack) - 1);
+		uint32_t var = entry >> 1;
+		int kind;
+
+		vec_pop_back(stack);
+		if (cnf->map[var] != UNDEF)
+			continue;
+		if (!aig_is_and(cnf->aig, var)) {
+			cnf->map[var] = aig_cnf_new_lit(s);
+			if (var == 0) {
+				uint32_t unit = lit_neg(cnf->map[var]);
+				aig_cnf_add_clause(s, cnf, &unit, 1);
+			}
+			continue;
+		}
+		kind = aig_cnf_gate(cnf, var);
+		if ((entry & 1) == 0) {
+			vec_push_back(stack, entry | 1);
+			for (uint32_t i = 0; i < vec_size(cnf->leaves); i++)
+				if (cnf->map[aig_var(vec_at(cnf->leaves, i))] == UNDEF)
+					vec_push_back(stack, aig_var(vec_at(cnf->leaves, i)) << 1);
+			continue;
+		}
+		cnf->map[var] = aig_cnf_new_lit(s);
+		aig_cnf_define(s, cnf, kind, cnf->map[var]);
+	}
+	return aig_cnf_lit(cnf, lit);
+}
+
+/**
+ *  Reads an AIGER file and encodes the question: can one of the selected
+ *  outputs be true? (All of them when 'outputs' is NULL, the bad state
+ *  properties when the circuit has no outputs.) Latches are free, and the
+ *  invariant constraints hold. Only the cone of influence of the outputs is
+ *  encoded.
+ *
+ *  Returns false if the question is trivially answered no, in which case the
+ *  solver is still returned. On a read or format error, no solver is returned.
+ */
+int
+satomi_parse_aiger(char *fname, satomi_opts_t *opts, const uint32_t *outputs,
+                   uint32_t n_outputs, satomi_t **solver)
+{
+	satomi_t *p;
+	struct aig *aig = aig_read(fname);
+	struct aig_cnf *cnf;
+	vec_ui32_t *roots, *clause;
+	char *name = strrchr(fname, '/');
+	int ret = SATOMI_OK;
+
+	*solver = NULL;
+	if (aig == NULL)
+		return SATOMI_ERR;
+	name = name ? name + 1 : fname;
+	roots = vec_size(aig->outputs) ? aig->outputs : aig->bad;
+	p = satomi_create(name);
+	if (opts)
+		satomi_configure(p, opts);
+
+	cnf = aig_cnf_alloc(aig);
+	clause = vec_ui32_alloc(0);
+	for (uint32_t i = 0; i < vec_size(aig->constraints); i++) {
+		uint32_t lit = aig_cnf_encode(p, cnf, vec_at(aig->constraints, i));
+
+		if (ret)
+			ret = aig_cnf_add_clause(p, cnf, &lit, 1);
+	}
+	for (uint32_t i = 0; i < (outputs ? n_outputs : vec_size(roots)); i++) {
+		uint32_t id = outputs ? outputs[i] : i;
+
+		if (id >= vec_size(roots)) {
+			fprintf(stdout, "There is no output %u.\n", id + 1);
+			continue;
+		}
+		vec_push_back(clause, aig_cnf_encode(p, cnf, vec_at(roots, id)));
+	}
+	if (ret)
+		ret = aig_cnf_add_clause(p, cnf, vec_data(clause), vec_size(clause));
+	if (opts == NULL || opts->verbose) {
+		fprintf(stdout, "aig          : %u inputs, %u latches, %u ands "
+		        "(%u once hashed)\n", aig->n_inputs, aig->n_latches,
+		        aig->n_file_ands, aig_n_ands(aig));
+		fprintf(stdout, "encoding     : %u vars, %llu clauses (%llu and, "
+		        "%llu xor, %llu ite)\n", p->n_vars,
+		        (unsigned long long) cnf->n_clauses,
+		        (unsigned long long) cnf->n_ands,
+		        (unsigned long long) cnf->n_xors,
+		        (unsigned long long) cnf->n_ites);
+	}
+	vec_free(clause);
+	aig_cnf_free(cnf);
+	aig_free(aig);
+	*solver = p;
+	return ret;
+}
@@ -0,0 +1,91 @@
+//===--- aiger.h ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__AIGER_H
+#define SATOMI__AIGER_H
+
+#include <stdint.h>
+
+#include "solver.h"
+#include "utils/vec/vec.h"
+
+/**
+ *  And-inverter graph, structurally hashed: no two AND nodes have the same
+ *  fanins. Literals are '2 * node + complemented' as in AIGER. Node 0 is the
+ *  constant false, then come the inputs, the latches and the AND nodes, each
+ *  one after its fanins.
+ */
+struct aig {
+	uint32_t n_inputs;
+	uint32_t n_latches;
+	uint32_t n_nodes;
+	uint32_t cap_nodes;
+	uint32_t *fanins;  /* two per node, UNDEF for the others than ANDs */
+	uint32_t *n_refs;  /* fanouts of each node, roots included */
+
+	/* Hash table of the AND nodes, on their fanins (zero is empty) */
+	uint32_t *table;
+	uint32_t table_mask;
+
+	vec_ui32_t *latch_next;
+	vec_ui32_t *latch_init;  /* 0, 1 or UNDEF when uninitialized */
+	vec_ui32_t *outputs;
+	vec_ui32_t *bad;
+	vec_ui32_t *constraints;
+	uint32_t n_file_ands;    /* AND nodes before hashing */
+};
+
+static inline uint32_t aig_var(uint32_t lit) { return lit >> 1; }
+static inline uint32_t aig_fanin0(struct aig *aig, uint32_t var) { return aig->fanins[2 * var]; }
+static inline uint32_t aig_fanin1(struct aig *aig, uint32_t var) { return aig->fanins[2 * var + 1]; }
+static inline uint32_t aig_is_and(struct aig *aig, uint32_t var)
+{
+	return aig->fanins[2 * var] != UNDEF;
+}
+static inline uint32_t aig_n_ands(struct aig *aig)
+{
+	return aig->n_nodes - 1 - aig->n_inputs - aig->n_latches;
+}
+static inline uint32_t aig_latch(struct aig *aig, uint32_t i)
+{
+	return 2 * (1 + aig->n_inputs + i);
+}
+
+/**
+ *  Tseitin encoding of an AIG into a solver, node by node on demand: only the
+ *  cone of influence of the literals asked for is encoded. 'map' gives the
+ *  solver literal of each node once encoded (or set by the caller, such as the
+ *  latches of a frame), UNDEF otherwise.
+ */
+struct aig_cnf {
+	struct aig *aig;
+	uint32_t *map;
+	vec_ui32_t *stack;
+	vec_ui32_t *leaves;
+	vec_ui32_t *clause;
+	uint64_t n_clauses;
+	uint64_t n_ands;
+	uint64_t n_xors;
+	uint64_t n_ites;
+};
+
+//===------------------------------------------------------------------------===
+extern struct aig *aig_alloc(uint32_t n_inputs, uint32_t n_latches);
+extern void aig_free(struct aig *);
+extern uint32_t aig_and(struct aig *, uint32_t, uint32_t);
+extern void aig_count_refs(struct aig *);
+extern struct aig *aig_read(const char *);
+extern int aig_write(struct aig *, const char *, const uint32_t *);
+
+extern struct aig_cnf *aig_cnf_alloc(struct aig *);
+extern void aig_cnf_free(struct aig_cnf *);
+extern void aig_cnf_clear(struct aig_cnf *);
+extern uint32_t aig_cnf_encode(solver_t *, struct aig_cnf *, uint32_t);
+extern int aig_cnf_add_clause(solver_t *, struct aig_cnf *, const uint32_t *, uint32_t);
+
+#endif /* SATOMI__AIGER_H */
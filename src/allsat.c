@@ -0,0 +1,118 @@
+//===--- allsat.c -----------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/vec/vec.h"
+
+//===------------------------------------------------------------------------===
+// AllSAT internal functions
+//===------------------------------------------------------------------------===
+/**
+ *  Builds, in 'block', the clause excluding the model on the trail. When every
+ *  decision is on a projected variable, the negated decisions are enough: they
+ *  imply the rest of the model. Otherwise it is the negated projection.
+ */
+static void
+allsat_blocking_clause(solver_t *s, const uint8_t *projected, vec_ui32_t *model,
+                       vec_ui32_t *block)
+{
+	uint32_t i, lit;
+
+	vec_clear(block);
+	for (i = 0; i < vec_size(s->trail_lim); i++) {
+		lit = vec_at(s->trail, vec_at(s->trail_lim, i));
+		if (projected && !projected[lit2var(lit)])
+			break;
+		vec_push_back(block, lit_neg(lit));
+	}
+	if (i == vec_size(s->trail_lim))
+		return;
+	vec_clear(block);
+	vec_ui32_foreach(model, lit, i)
+		vec_push_back(block, lit_neg(lit));
+}
+
+//===------------------------------------------------------------------------===
+// AllSAT external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Enumerates the models of the formula projected onto the 'n_proj' variables
+ *  of 'proj' (onto every variable if there is none). Each distinct projection
+ *  is given to 'model_fn' as literals, in the order of 'proj', and the search
+ *  goes on from where it found it: a clause blocking the model is added and
+ *  the solver backjumps just enough to leave it. The enumeration stops when
+ *  'model_fn' returns false.
+ *
+ *  Returns SATOMI_UNSAT once every model was enumerated, SATOMI_UNDEC if it
+ *  was stopped. The blocking clauses stay in the solver.
+ */
+int
+satomi_enumerate(solver_t *s, const uint32_t *proj, uint32_t n_proj,
+                 int (*model_fn)(void *, const uint32_t *, uint32_t), void *data)
+{
+	uint8_t *projected = NULL;
+	vec_ui32_t *model = vec_ui32_alloc(0);
+	vec_ui32_t *block = vec_ui32_alloc(0);
+	int status = SATOMI_UNDEC;
+
+	s->stats.init_time = stm_clock();
+	solver_backjump(s, 0);
+	vec_clear(s->failed);
+	if (n_proj) {
+		/* Projected variables no clause mentions are free */
+		for (uint32_t i = 0; i < n_proj; i++)
+			solver_reserve_vars(s, proj[i] + 1);
+		projected = STM_CALLOC(uint8_t, s->n_vars);
+		for (uint32_t i = 0; i < n_proj; i++)
+			projected[proj[i]] = 1;
+	}
+	if (s->checker)
+		checker_start(s->checker);
+	while (!vec_wl_failed(s->watches)) {
+		status = solver_search(s);
+		if (status != SATOMI_SAT)
+			break;
+		if (s->checker && satomi_check(s, status) != SATOMI_OK) {
+			fprintf(stdout, "[satomi] A model failed the check!\n");
+			status = SATOMI_UNDEC;
+			break;
+		}
+		vec_clear(model);
+		if (n_proj) {
+			for (uint32_t i = 0; i < n_proj; i++)
+				vec_push_back(model, var2lit(proj[i], var_value(s, proj[i]) == LIT_FALSE));
+		} else
+			for (uint32_t var = 0; var < s->n_vars; var++)
+				vec_push_back(model, var2lit(var, var_value(s, var) == LIT_FALSE));
+		s->stats.n_models++;
+		status = SATOMI_UNDEC;
+		if (!model_fn(data, vec_data(model), vec_size(model)))
+			break;
+		allsat_blocking_clause(s, projected, model, block);
+		if (s->checker)
+			checker_add_axiom(s->checker, vec_data(block), vec_size(block));
+		if (!solver_attach_clause(s, vec_data(block), vec_size(block))) {
+			status = SATOMI_UNSAT;
+			break;
+		}
+	}
+	if (status == SATOMI_UNSAT && s->checker
+	    && satomi_check(s, status) != SATOMI_OK) {
+		fprintf(stdout, "[satomi] The enumeration failed the check!\n");
+		status = SATOMI_UNDEC;
+	}
+	STM_FREE(projected);
+	vec_free(model);
+	vec_free(block);
+	return status;
+}
@@ -0,0 +1,206 @@
+//===--- backbone.c ---------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/vec/vec.h"
+
+/* Bounds of the number of candidates tested by a single call */
+#define BACKBONE_CHUNK_MIN 1
+#define BACKBONE_CHUNK_MAX 1024
+
+/* State of each variable */
+enum {
+	BB_NONE = 0,
+	BB_CANDIDATE,
+	BB_BACKBONE
+};
+
+struct backbone {
+	uint8_t *state;
+	vec_ui32_t *candidates; /* literals, filtered lazily */
+	vec_ui32_t *clause;
+	uint32_t n_vars;        /* selector variables come after these */
+	uint32_t n_harvested;   /* level zero literals already looked at */
+};
+
+//===------------------------------------------------------------------------===
+// Backbone internal functions
+//===------------------------------------------------------------------------===
+/** Candidates fixed at level zero are part of the backbone, for free. */
+static void
+backbone_harvest(solver_t *s, struct backbone *bb)
+{
+	uint32_t n_level0 = solver_dlevel(s) ? vec_at(s->trail_lim, 0)
+	                                     : vec_size(s->trail);
+
+	for (; bb->n_harvested < n_level0; bb->n_harvested++) {
+		uint32_t var = lit2var(vec_at(s->trail, bb->n_harvested));
+
+		if (var < bb->n_vars && bb->state[var] == BB_CANDIDATE)
+			bb->state[var] = BB_BACKBONE;
+	}
+}
+
+/** Drops the candidates the last model disagrees with, or already decided. */
+static void
+backbone_filter(solver_t *s, struct backbone *bb)
+{
+	uint32_t *data = vec_data(bb->candidates);
+	uint32_t i, j;
+
+	for (i = j = 0; i < vec_size(bb->candidates); i++) {
+		uint32_t var = lit2var(data[i]);
+
+		if (bb->state[var] != BB_CANDIDATE)
+			continue;
+		if (!satomi_value(s, data[i])) {
+			bb->state[var] = BB_NONE;
+			continue;
+		}
+		data[j++] = data[i];
+	}
+	vec_shrink(bb->candidates, j);
+}
+
+/** Adds a clause at level zero, trusted by the checker. */
+static int
+backbone_add(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	solver_backjump(s, 0);
+	if (s->checker)
+		checker_add_axiom(s->checker, lits, size);
+	return solver_attach_clause(s, lits, size);
+}
+
+/**
+ *  Tests whether the last 'n' candidates all belong to the backbone: a model
+ *  must falsify one of them. A single candidate is tested by assuming its
+ *  negation. Several ones need a clause of their negations, enabled by a fresh
+ *  selector variable and disabled for good afterwards.
+ */
+static int
+backbone_query(solver_t *s, struct backbone *bb, uint32_t n)
+{
+	uint32_t *chunk = vec_data(bb->candidates) + vec_size(bb->candidates) - n;
+	uint32_t selector;
+	int status;
+
+	if (n == 1) {
+		uint32_t lit = lit_neg(chunk[0]);
+
+		status = solver_solve(s, &lit, 1);
+		if (status == SATOMI_UNSAT && vec_size(s->failed)) {
+			/* Keep the literal as a unit, its clause was just checked */
+			solver_backjump(s, 0);
+			if (lit_value(s, chunk[0]) == VAR_UNASSING)
+				solver_enqueue(s, chunk[0], CREF_UNDEF);
+		}
+	} else {
+		selector = var2lit(s->n_vars, 0);
+		satomi_add_variable(s);
+		vec_clear(bb->clause);
+		vec_push_back(bb->clause, lit_neg(selector));
+		for (uint32_t i = 0; i < n; i++)
+			vec_push_back(bb->clause, lit_neg(chunk[i]));
+		if (!backbone_add(s, vec_data(bb->clause), vec_size(bb->clause)))
+			return SATOMI_UNDEC;
+		status = solver_solve(s, &selector, 1);
+		selector = lit_neg(selector);
+		backbone_add(s, &selector, 1);
+	}
+	if (status == SATOMI_UNSAT && vec_size(s->failed) == 0)
+		return SATOMI_UNDEC; /* The formula had a model */
+	if (status == SATOMI_UNSAT)
+		for (uint32_t i = 0; i < n; i++)
+			bb->state[lit2var(chunk[i])] = BB_BACKBONE;
+	return status;
+}
+
+//===------------------------------------------------------------------------===
+// Backbone external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Finds the literals true in every model, among the 'n_vars' variables of
+ *  'vars' (among all of them if there is none), and gives them once found to
+ *  'backbone_fn', in the order of 'vars'.
+ *
+ *  The candidates are the literals of the first model. Each later model rules
+ *  out the candidates it falsifies, and the candidates the solver fixes at
+ *  level zero are kept without a call. The others are tested in chunks, asking
+ *  for a model falsifying one of them, whose size doubles while the answer is
+ *  no and halves when it is yes.
+ *
+ *  Returns SATOMI_SAT with the backbone, SATOMI_UNSAT if the formula has no
+ *  model and SATOMI_UNDEC if the search failed. Clauses over selector variables
+ *  are left in the solver, disabled.
+ */
+int
+satomi_backbone(solver_t *s, const uint32_t *vars, uint32_t n_vars,
+                void (*backbone_fn)(void *, const uint32_t *, uint32_t), void *data)
+{
+	struct backbone bb;
+	uint32_t n_orig = s->n_vars;
+	uint32_t chunk = BACKBONE_CHUNK_MIN;
+	int status;
+
+	s->stats.init_time = stm_clock();
+	status = solver_solve(s, NULL, 0);
+	if (status != SATOMI_SAT)
+		return status;
+
+	bb.state = STM_CALLOC(uint8_t, n_orig);
+	bb.candidates = vec_ui32_alloc(0);
+	bb.clause = vec_ui32_alloc(0);
+	bb.n_vars = n_orig;
+	bb.n_harvested = 0;
+	for (uint32_t i = 0; i < (vars ? n_vars : n_orig); i++) {
+		uint32_t var = vars ? vars[i] : i;
+
+		if (var >= n_orig || bb.state[var] != BB_NONE)
+			continue;
+		bb.state[var] = BB_CANDIDATE;
+		vec_push_back(bb.candidates, var2lit(var, !satomi_value(s, var2lit(var, 0))));
+	}
+	while (1) {
+		backbone_harvest(s, &bb);
+		backbone_filter(s, &bb);
+		if (vec_size(bb.candidates) == 0)
+			break;
+		if (chunk > vec_size(bb.candidates))
+			chunk = vec_size(bb.candidates);
+		status = backbone_query(s, &bb, chunk);
+		if (status == SATOMI_UNDEC)
+			break;
+		if (status == SATOMI_UNSAT && chunk < BACKBONE_CHUNK_MAX)
+			chunk *= 2;
+		else if (status == SATOMI_SAT && chunk > BACKBONE_CHUNK_MIN)
+			chunk /= 2;
+	}
+	if (status != SATOMI_UNDEC) {
+		status = SATOMI_SAT;
+		vec_clear(bb.clause);
+		for (uint32_t i = 0; i < (vars ? n_vars : n_orig); i++) {
+			uint32_t var = vars ? vars[i] : i;
+
+			if (var >= n_orig || bb.state[var] != BB_BACKBONE)
+				continue;
+			bb.state[var] = BB_NONE;
+			vec_push_back(bb.clause, var2lit(var, !satomi_value(s, var2lit(var, 0))));
+		}
+		backbone_fn(data, vec_data(bb.clause), vec_size(bb.clause));
+	}
+	STM_FREE(bb.state);
+	vec_free(bb.candidates);
+	vec_free(bb.clause);
+	return status;
+}
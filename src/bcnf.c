@@ -0,0 +1,346 @@
+//===--- bcnf.c -------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+
+#define BCNF_MAGIC "SATOMIBC"
+#define BCNF_VERSION 1
+
+/* The whole file is read, so its pages are faulted in up front */
+#if defined(MAP_POPULATE)
+#define BCNF_MAP_FLAGS MAP_POPULATE
+#else
+#define BCNF_MAP_FLAGS 0
+#endif
+
+/**
+ *  Binary CNF: a header, the unit clauses (one literal each) and then the
+ *  other clauses, each one as its size followed by its literals. This is the
+ *  layout of the clauses database, so the clauses are copied to it in one go.
+ *
+ *  Optionally, the watch lists follow: the size and number of binary watchers
+ *  of each list, and then all the watchers, list after list. Watching clauses
+ *  one by one scatters writes all over memory, which takes longer than reading
+ *  the whole file; lists read from the file are used as they are.
+ *
+ *  It stores the formula as the solver holds it after adding the clauses of a
+ *  DIMACS file: duplicated literals, tautologies and clauses satisfied at level
+ *  zero are gone, and the units are apart.
+ */
+struct bcnf_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t n_vars;
+	uint64_t n_clauses;
+	uint64_t n_units;
+	uint64_t n_words;
+	uint64_t n_watchers;
+	uint32_t unsat;
+	uint32_t has_watches;
+};
+
+struct bcnf_list {
+	uint32_t size;
+	uint32_t n_bin;
+};
+
+struct bcnf_watcher {
+	uint32_t cref;
+	uint32_t blocker;
+};
+
+//===------------------------------------------------------------------------===
+// Binary CNF internal functions
+//===------------------------------------------------------------------------===
+static int
+bcnf_check(const struct bcnf_header *h, uint64_t file_size)
+{
+	uint64_t n_words = (file_size - sizeof(*h)) / sizeof(uint32_t);
+
+	if (memcmp(h->magic, BCNF_MAGIC, sizeof(h->magic)) != 0
+	    || h->version != BCNF_VERSION || (file_size - sizeof(*h)) % sizeof(uint32_t))
+		return SATOMI_ERR;
+	if (h->has_watches) {
+		uint64_t n_tail = 2 * (uint64_t) h->n_vars * (sizeof(struct bcnf_list) / sizeof(uint32_t));
+		if (h->n_watchers > n_words)
+			return SATOMI_ERR;
+		n_tail += h->n_watchers * (sizeof(struct bcnf_watcher) / sizeof(uint32_t));
+		if (n_tail > n_words)
+			return SATOMI_ERR;
+		n_words -= n_tail;
+	}
+	if (h->n_units > n_words || h->n_words != n_words - h->n_units
+	    || h->n_words > CDB_MAX_WORDS || h->n_clauses > UINT32_MAX)
+		return SATOMI_ERR;
+	return SATOMI_OK;
+}
+
+/**
+ *  Watch lists are loaded back to back, each one with its exact size as
+ *  capacity, into the (still empty) arena of the solver.
+ */
+static int
+bcnf_load_watches(solver_t *s, const struct bcnf_header *h, const uint32_t *data)
+{
+	const struct bcnf_list *lists = (const struct bcnf_list *) data;
+	const struct bcnf_watcher *watchers = (const struct bcnf_watcher *)(lists + 2 * (size_t) s->n_vars);
+	vec_wl_t *vec_wl = s->watches;
+	uint64_t start = 0;
+	uint32_t lit;
+
+	assert(vec_wl->arena_size == 0);
+	if (!vec_wl_arena_reserve(vec_wl, h->n_watchers))
+		return SATOMI_ERR;
+	for (lit = 0; lit < 2 * s->n_vars; lit++) {
+		struct watch_list *wl = vec_wl_at(vec_wl, lit);
+
+		if (lists[lit].n_bin > lists[lit].size || lists[lit].size > h->n_watchers - start)
+			return SATOMI_ERR;
+		wl->start = start;
+		wl->cap = wl->size = lists[lit].size;
+		wl->n_bin = lists[lit].n_bin;
+		start += wl->size;
+	}
+	if (start != h->n_watchers)
+		return SATOMI_ERR;
+	for (uint64_t i = 0; i < h->n_watchers; i++) {
+		if (watchers[i].cref >= h->n_words || lit2var(watchers[i].blocker) >= s->n_vars)
+			return SATOMI_ERR;
+		vec_wl->watchers[i].cref = watchers[i].cref;
+		vec_wl->watchers[i].blocker = watchers[i].blocker;
+	}
+	vec_wl->arena_size = h->n_watchers;
+	return SATOMI_OK;
+}
+
+/** Copies the clauses to the database, and watches them if they aren't. */
+static int
+bcnf_load_clauses(solver_t *s, const struct bcnf_header *h, const uint32_t *words)
+{
+	cref_t cref = 0;
+
+	cdb_grow(s->clause_db, h->n_words);
+	memcpy(s->clause_db->data, words, sizeof(uint32_t) * h->n_words);
+	s->clause_db->size = (cref_t) h->n_words;
+	vec_reserve(s->clauses, (uint32_t) h->n_clauses);
+	while (cref < h->n_words) {
+		struct clause *clause = clause_read(s, cref);
+		uint32_t i;
+
+		if (clause->size < 2 || clause->size > h->n_words - cref - 1)
+			return SATOMI_ERR;
+		for (i = 0; i < clause->size; i++)
+			if (lit2var(clause->lits[i]) >= s->n_vars)
+				return SATOMI_ERR;
+		if (s->checker)
+			checker_add_original(s->checker, clause->lits, clause->size);
+		vec_push_back(s->clauses, cref);
+		s->stats.n_lits += clause->size;
+		if (!h->has_watches && !clause_watch(s, cref))
+			return SATOMI_ERR;
+		cref += 1 + clause->size;
+	}
+	if (vec_size(s->clauses) != h->n_clauses)
+		return SATOMI_ERR;
+	if (h->has_watches)
+		return bcnf_load_watches(s, h, words + h->n_words);
+	return SATOMI_OK;
+}
+
+/**
+ *  Watches are written only when the clauses fill the database back to back,
+ *  in order, so that clause references are offsets in the file as well.
+ */
+static int
+bcnf_can_write_watches(solver_t *s)
+{
+	uint64_t offset = 0;
+	uint32_t i;
+	cref_t cref;
+
+	vec_cref_foreach(s->clauses, cref, i) {
+		if (cref != offset)
+			return 0;
+		offset += 1 + clause_read(s, cref)->size;
+	}
+	return offset == cdb_size(s->clause_db) && offset <= UINT32_MAX;
+}
+
+static int
+bcnf_write_watches(solver_t *s, FILE *file)
+{
+	uint32_t lit;
+
+	for (lit = 0; lit < 2 * s->n_vars; lit++) {
+		struct watch_list *wl = vec_wl_at(s->watches, lit);
+		struct bcnf_list list = { wl->size, wl->n_bin };
+		if (fwrite(&list, sizeof(list), 1, file) != 1)
+			return SATOMI_ERR;
+	}
+	for (lit = 0; lit < 2 * s->n_vars; lit++) {
+		struct watcher *w;
+
+		watch_list_foreach(s->watches, w, lit) {
+			struct bcnf_watcher bw = { (uint32_t) w->cref, w->blocker };
+			if (fwrite(&bw, sizeof(bw), 1, file) != 1)
+				return SATOMI_ERR;
+		}
+	}
+	return SATOMI_OK;
+}
+
+//===------------------------------------------------------------------------===
+// Binary CNF external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Writes the clauses of a solver, at level zero, in binary CNF. 'unsat' marks
+ *  a formula found unsatisfiable while adding its clauses.
+ */
+int
+satomi_write_bcnf(satomi_t *s, const char *fname, int unsat)
+{
+	struct bcnf_header h;
+	FILE *file;
+	uint32_t i;
+	cref_t cref;
+	int ret = SATOMI_OK;
+
+	if (solver_dlevel(s) > 0)
+		return SATOMI_ERR;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, BCNF_MAGIC, sizeof(h.magic));
+	h.version = BCNF_VERSION;
+	h.n_vars = s->n_vars;
+	h.n_clauses = vec_size(s->clauses);
+	h.n_units = vec_size(s->trail);
+	h.unsat = (unsat != 0);
+	vec_cref_foreach(s->clauses, cref, i)
+		h.n_words += 1 + clause_read(s, cref)->size;
+	h.has_watches = bcnf_can_write_watches(s);
+	if (h.has_watches)
+		for (uint32_t lit = 0; lit < 2 * s->n_vars; lit++)
+			h.n_watchers += watch_list_size(vec_wl_at(s->watches, lit));
+
+	file = fopen(fname, "wb");
+	if (file == NULL) {
+		fprintf(stdout, "Couldn't open file: %s\n", fname);
+		return SATOMI_ERR;
+	}
+	if (fwrite(&h, sizeof(h), 1, file) != 1)
+		ret = SATOMI_ERR;
+	if (ret && h.n_units
+	    && fwrite(vec_data(s->trail), sizeof(uint32_t), h.n_units, file) != h.n_units)
+		ret = SATOMI_ERR;
+	vec_cref_foreach(s->clauses, cref, i) {
+		struct clause *clause = clause_read(s, cref);
+		if (!ret || fwrite(clause, sizeof(uint32_t), 1 + clause->size, file) != 1 + clause->size) {
+			ret = SATOMI_ERR;
+			break;
+		}
+	}
+	if (ret && h.has_watches)
+		ret = bcnf_write_watches(s, file);
+	if (fclose(file) != 0)
+		ret = SATOMI_ERR;
+	if (!ret)
+		fprintf(stdout, "Couldn't write file: %s\n", fname);
+	return ret;
+}
+
+/** Start the solver and reads a binary CNF file.
+ *
+ * Behaves as satomi_parse_dimacs: returns false upon immediate conflict, with
+ * the solver, and returns no solver on read or format errors.
+ */
+int
+satomi_parse_bcnf(char *fname, satomi_opts_t *opts, satomi_t **solver)
+{
+	const struct bcnf_header *h;
+	const uint32_t *units;
+	satomi_t *p;
+	struct stat st;
+	char *base;
+	char *name = strrchr(fname, '/');
+	int valid = 1;
+	int conflict = 0;
+	int fd = open(fname, O_RDONLY);
+
+	*solver = NULL;
+	if (fd < 0) {
+		fprintf(stdout, "Couldn't open file: %s\n", fname);
+		return SATOMI_ERR;
+	}
+	if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(*h)) {
+		fprintf(stdout, "Invalid binary CNF file: %s\n", fname);
+		close(fd);
+		return SATOMI_ERR;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | BCNF_MAP_FLAGS, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		fprintf(stdout, "Couldn't map file: %s\n", fname);
+		return SATOMI_ERR;
+	}
+#if defined(MADV_SEQUENTIAL)
+	madvise(base, st.st_size, MADV_SEQUENTIAL);
+#endif
+	h = (const struct bcnf_header *) base;
+	if (!bcnf_check(h, st.st_size)) {
+		fprintf(stdout, "Invalid binary CNF file: %s\n", fname);
+		munmap(base, st.st_size);
+		return SATOMI_ERR;
+	}
+
+	p = satomi_create(name ? name + 1 : fname);
+	if (opts)
+		satomi_configure(p, opts);
+	if (p->core) {
+		fprintf(stdout, "Cores need the clauses of a DIMACS file: %s\n", fname);
+		munmap(base, st.st_size);
+		satomi_destroy(p);
+		return SATOMI_ERR;
+	}
+	for (uint32_t i = 0; i < h->n_vars; i++)
+		satomi_add_variable(p);
+	units = (const uint32_t *)(base + sizeof(*h));
+	for (uint64_t i = 0; valid && i < h->n_units; i++) {
+		if (lit2var(units[i]) >= p->n_vars) {
+			valid = 0;
+			break;
+		}
+		if (p->checker)
+			checker_add_original(p->checker, &units[i], 1);
+		if (lit_value(p, units[i]) == LIT_FALSE)
+			conflict = 1;
+		else if (lit_value(p, units[i]) == VAR_UNASSING)
+			solver_enqueue(p, units[i], CREF_UNDEF);
+	}
+	if (valid)
+		valid = bcnf_load_clauses(p, h, units + h->n_units);
+	conflict |= h->unsat;
+	munmap(base, st.st_size);
+	if (!valid) {
+		fprintf(stdout, "Invalid binary CNF file: %s\n", fname);
+		satomi_destroy(p);
+		return SATOMI_ERR;
+	}
+	*solver = p;
+	if (conflict || solver_propagate(p) != CREF_UNDEF)
+		return 0;
+	return SATOMI_OK;
+}
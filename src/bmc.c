@@ -0,0 +1,291 @@
+//===--- bmc.c --------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+#include <string.h>
+
+#include "aiger.h"
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/vec/vec.h"
+
+struct bmc {
+	struct aig *aig;
+	struct aig_cnf *cnf;
+	vec_ui32_t *props;    /* bad state literals of the AIG */
+	vec_ui32_t *latches;  /* indices of the latches in the cone of influence */
+	vec_ui32_t *next;     /* their next state literals in the solver */
+	vec_ui32_t *init;     /* solver literals of all latches at frame 0 */
+	vec_ui32_t *inputs;   /* solver literals of the inputs, frame after frame */
+	vec_ui32_t *clause;
+	uint32_t const_lit;   /* false in the solver */
+	uint8_t blocked;      /* no path meets the constraints any longer */
+};
+
+//===------------------------------------------------------------------------===
+// BMC internal functions
+//===------------------------------------------------------------------------===
+/**
+ *  Finds the latches the properties depend on, through any number of frames:
+ *  those in the support of the properties and constraints, then of their next
+ *  state functions, up to a fixed point. The others are never encoded.
+ */
+static void
+bmc_coi(struct bmc *bmc)
+{
+	struct aig *aig = bmc->aig;
+	uint8_t *mark = STM_CALLOC(uint8_t, aig->n_nodes);
+	vec_ui32_t *stack = vec_ui32_alloc(0);
+	uint32_t first_latch = aig_var(aig_latch(aig, 0));
+
+	for (uint32_t i = 0; i < vec_size(bmc->props); i++)
+		vec_push_back(stack, aig_var(vec_at(bmc->props, i)));
+	for (uint32_t i = 0; i < vec_size(aig->constraints); i++)
+		vec_push_back(stack, aig_var(vec_at(aig->constraints, i)));
+	while (vec_size(stack)) {
+		uint32_t var = vec_at(stack, vec_size(stack) - 1);
+
+		vec_pop_back(stack);
+		if (mark[var])
+			continue;
+		mark[var] = 1;
+		if (aig_is_and(aig, var)) {
+			vec_push_back(stack, aig_var(aig_fanin0(aig, var)));
+			vec_push_back(stack, aig_var(aig_fanin1(aig, var)));
+		} else if (var >= first_latch) {
+			vec_push_back(bmc->latches, var - first_latch);
+			vec_push_back(stack, aig_var(vec_at(aig->latch_next, var - first_latch)));
+		}
+	}
+	STM_FREE(mark);
+	vec_free(stack);
+}
+
+/** Maps the latches of a new frame: to their initial values for frame 0, to
+ *  the next state literals of the previous frame otherwise. */
+static void
+bmc_new_frame(solver_t *s, struct bmc *bmc, uint32_t depth)
+{
+	struct aig *aig = bmc->aig;
+
+	aig_cnf_clear(bmc->cnf);
+	bmc->cnf->map[0] = bmc->const_lit;
+	for (uint32_t i = 0; i < vec_size(bmc->latches); i++) {
+		uint32_t latch = vec_at(bmc->latches, i);
+		uint32_t var = aig_var(aig_latch(aig, latch));
+		uint32_t init = vec_at(aig->latch_init, latch);
+
+		if (depth)
+			bmc->cnf->map[var] = vec_at(bmc->next, i);
+		else if (init != UNDEF)
+			bmc->cnf->map[var] = bmc->const_lit ^ init;
+		else {
+			satomi_add_variable(s);
+			bmc->cnf->map[var] = var2lit(s->n_vars - 1, 0);
+		}
+	}
+}
+
+/** Keeps the literals of the inputs of the frame, UNDEF for those not
+ *  encoded, and those of the latches at frame 0, for the witness. */
+static void
+bmc_save_frame(struct bmc *bmc, uint32_t depth)
+{
+	struct aig *aig = bmc->aig;
+
+	for (uint32_t i = 0; i < aig->n_inputs; i++)
+		vec_push_back(bmc->inputs, bmc->cnf->map[i + 1]);
+	if (depth)
+		return;
+	for (uint32_t i = 0; i < aig->n_latches; i++)
+		vec_push_back(bmc->init, bmc->cnf->map[aig_var(aig_latch(aig, i))]);
+}
+
+static char
+bmc_value(solver_t *s, uint32_t lit)
+{
+	if (lit == UNDEF)
+		return 'x';
+	return satomi_value(s, lit) ? '1' : '0';
+}
+
+/**
+ *  Gives the counterexample of the last model in the AIGER witness format: the
+ *  property reached, the initial state, the inputs of each frame. Values out of
+ *  the cone of influence are 'x', unless they are initial values.
+ */
+static void
+bmc_witness(solver_t *s, struct bmc *bmc, uint32_t depth, uint32_t prop,
+            void (*witness_fn)(void *, const char *), void *data)
+{
+	struct aig *aig = bmc->aig;
+	uint32_t size = aig->n_inputs > aig->n_latches ? aig->n_inputs : aig->n_latches;
+	char *line = STM_ALLOC(char, size + 16);
+
+	witness_fn(data, "1");
+	snprintf(line, size + 16, "b%u", prop);
+	witness_fn(data, line);
+	for (uint32_t i = 0; i < aig->n_latches; i++)
+		if (vec_at(aig->latch_init, i) != UNDEF)
+			line[i] = '0' + vec_at(aig->latch_init, i);
+		else
+			line[i] = bmc_value(s, vec_at(bmc->init, i));
+	line[aig->n_latches] = '\0';
+	witness_fn(data, line);
+	for (uint32_t k = 0; k <= depth; k++) {
+		for (uint32_t i = 0; i < aig->n_inputs; i++)
+			line[i] = bmc_value(s, vec_at(bmc->inputs, k * aig->n_inputs + i));
+		line[aig->n_inputs] = '\0';
+		witness_fn(data, line);
+	}
+	witness_fn(data, ".");
+	STM_FREE(line);
+}
+
+/**
+ *  Adds a frame and checks whether a bad state is reached in it: the properties
+ *  are encoded over the latches of the frame, and their disjunction is enabled
+ *  by a new activation literal, assumed for this call only. When no property is reached, the activation
+ *  literal is fixed to false, which the checker verified, and the next state
+ *  functions are encoded for the next frame. Returns the answer.
+ */
+static int
+bmc_check_frame(solver_t *s, struct bmc *bmc, uint32_t depth, uint32_t *prop)
+{
+	struct aig *aig = bmc->aig;
+	uint32_t act;
+	int status;
+
+	bmc_new_frame(s, bmc, depth);
+	for (uint32_t i = 0; i < vec_size(aig->constraints); i++) {
+		uint32_t lit = aig_cnf_encode(s, bmc->cnf, vec_at(aig->constraints, i));
+
+		if (!aig_cnf_add_clause(s, bmc->cnf, &lit, 1)) {
+			bmc->blocked = 1;
+			return SATOMI_UNSAT;
+		}
+	}
+	satomi_add_variable(s);
+	act = var2lit(s->n_vars - 1, 0);
+	vec_clear(bmc->clause);
+	vec_push_back(bmc->clause, lit_neg(act));
+	for (uint32_t i = 0; i < vec_size(bmc->props); i++)
+		vec_push_back(bmc->clause, aig_cnf_encode(s, bmc->cnf, vec_at(bmc->props, i)));
+	aig_cnf_add_clause(s, bmc->cnf, vec_data(bmc->clause), vec_size(bmc->clause));
+
+	status = solver_solve(s, &act, 1);
+	if (status == SATOMI_SAT) {
+		for (*prop = 0; *prop < vec_size(bmc->props); (*prop)++)
+			if (satomi_value(s, vec_at(bmc->clause, *prop + 1)))
+				break;
+		bmc_save_frame(bmc, depth);
+		return status;
+	}
+	if (status != SATOMI_UNSAT)
+		return status;
+	if (vec_size(s->failed) == 0) {
+		bmc->blocked = 1;
+		return status;
+	}
+	act = lit_neg(act);
+	aig_cnf_add_clause(s, bmc->cnf, &act, 1);
+	vec_clear(bmc->next);
+	for (uint32_t i = 0; i < vec_size(bmc->latches); i++) {
+		uint32_t latch = vec_at(bmc->latches, i);
+
+		vec_push_back(bmc->next, aig_cnf_encode(s, bmc->cnf,
+		                                        vec_at(aig->latch_next, latch)));
+	}
+	bmc_save_frame(bmc, depth);
+	return status;
+}
+
+//===------------------------------------------------------------------------===
+// BMC external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Bounded model checking of the AIGER circuit in 'fname': can a bad state
+ *  (an output, when the circuit has no bad state property) be reached within
+ *  'config->max_depth' steps from the initial states?
+ *
+ *  The circuit is unrolled one frame at a time into the same solver, so learnt
+ *  clauses carry over from a depth to the next. Only the latches in the cone
+ *  of influence of the properties are encoded. After each depth, 'depth' is
+ *  called with its answer (SATOMI_UNSAT when no bad state is reached) and the
+ *  seconds it took, and no depth is started once 'budget' seconds are spent. A
+ *  counterexample is given line by line to 'witness', in the AIGER witness
+ *  format.
+ *
+ *  Returns SATOMI_SAT if a bad state is reached, SATOMI_UNSAT if none can be
+ *  within the bound (or at all, when the constraints cut every path), and
+ *  SATOMI_UNDEC otherwise. The solver is returned for its statistics, unless
+ *  the file can't be read.
+ */
+int
+satomi_bmc(char *fname, satomi_opts_t *opts, const struct satomi_bmc *config,
+           satomi_t **solver)
+{
+	struct bmc bmc;
+	satomi_opts_t bmc_opts;
+	satomi_t *s;
+	char *name = strrchr(fname, '/');
+	uint32_t prop = 0;
+	int status = SATOMI_UNDEC;
+
+	*solver = NULL;
+	bmc.aig = aig_read(fname);
+	if (bmc.aig == NULL)
+		return SATOMI_UNDEC;
+	name = name ? name + 1 : fname;
+	s = satomi_create(name);
+	if (opts) {
+		bmc_opts = *opts;
+		bmc_opts.core = 0;
+		satomi_configure(s, &bmc_opts);
+	}
+	s->stats.init_time = stm_clock();
+
+	bmc.props = vec_size(bmc.aig->bad) ? bmc.aig->bad : bmc.aig->outputs;
+	bmc.cnf = aig_cnf_alloc(bmc.aig);
+	bmc.latches = vec_ui32_alloc(0);
+	bmc.next = vec_ui32_alloc(0);
+	bmc.init = vec_ui32_alloc(0);
+	bmc.inputs = vec_ui32_alloc(0);
+	bmc.clause = vec_ui32_alloc(0);
+	bmc.blocked = 0;
+	bmc.const_lit = aig_cnf_encode(s, bmc.cnf, 0);
+	bmc_coi(&bmc);
+
+	for (uint32_t depth = 0; depth <= config->max_depth; depth++) {
+		double start = stm_clock();
+
+		if (config->budget > 0 && start - s->stats.init_time >= config->budget)
+			break;
+		status = bmc_check_frame(s, &bmc, depth, &prop);
+		if (config->depth)
+			config->depth(config->data, depth, status, stm_clock() - start);
+		if (status == SATOMI_SAT && config->witness)
+			bmc_witness(s, &bmc, depth, prop, config->witness, config->data);
+		if (status != SATOMI_UNSAT || bmc.blocked)
+			break;
+		if (depth < config->max_depth)
+			status = SATOMI_UNDEC;
+	}
+
+	aig_cnf_free(bmc.cnf);
+	aig_free(bmc.aig);
+	vec_free(bmc.latches);
+	vec_free(bmc.next);
+	vec_free(bmc.init);
+	vec_free(bmc.inputs);
+	vec_free(bmc.clause);
+	*solver = s;
+	return status;
+}
@@ -11,15 +11,39 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "clause.h"
 #include "utils/mem.h"
+#include "utils/vec/vec.h"
+
+/* Clause references are indexes into the database. By default they are 32-bit
+ * integers, which limits the database to 4G words (16 GB). Building with
+ * SATOMI_CREF64 makes them 64-bit, at the cost of bigger watchers. */
+#ifdef SATOMI_CREF64
+typedef uint64_t cref_t;
+typedef vec_ui64_t vec_cref_t;
+#define CREF_UNDEF UINT64_MAX
+#define vec_cref_alloc vec_ui64_alloc
+#define vec_cref_foreach vec_ui64_foreach
+#else
+typedef uint32_t cref_t;
+typedef vec_ui32_t vec_cref_t;
+#define CREF_UNDEF UINT32_MAX
+#define vec_cref_alloc vec_ui32_alloc
+#define vec_cref_foreach vec_ui32_foreach
+#endif
+
+/* Maximum number of words, the last reference is reserved for CREF_UNDEF */
+#define CDB_MAX_WORDS ((uint64_t) CREF_UNDEF - 1)
 
 /* Clauses DB */
 struct cdb {
-	uint32_t size;
-	uint32_t cap;
-	uint32_t wasted;
+	cref_t size;
+	cref_t cap;
+	cref_t wasted;
+	size_t map_size;
 	uint32_t *data;
 };
 
@@ -27,35 +51,58 @@ struct cdb {
 // Clause DB API
 //===------------------------------------------------------------------------===
 static inline struct clause *
-cdb_handler(struct cdb *p, uint32_t cref)
+cdb_handler(struct cdb *p, cref_t cref)
 {
-	return cref != 0xFFFFFFFF ? (struct clause *)(p->data + cref) : NULL;
+	return cref != CREF_UNDEF ? (struct clause *)(p->data + cref) : NULL;
 }
 
-static inline uint32_t
+static inline cref_t
 cdb_cref(struct cdb *p, uint32_t *clause)
 {
-	return (uint32_t)(clause - &(p->data[0]));
+	return (cref_t)(clause - &(p->data[0]));
 }
 
+/**
+ *  The database lives in a mapped arena (see utils/mem.h) that grows by
+ *  remapping. Capacities are computed on 64 bits and checked against the
+ *  width of the references, running out of them is a fatal error.
+ */
 static inline void
-cdb_grow(struct cdb *p, uint32_t cap)
+cdb_grow(struct cdb *p, uint64_t cap)
 {
-	uint32_t prev_cap = p->cap;
+	uint64_t new_cap = p->cap;
+	size_t map_size;
+	uint32_t *data;
 
 	if (p->cap >= cap)
 		return;
-	while (p->cap < cap) {
-		uint32_t delta = ((p->cap >> 1) + (p->cap >> 3) + 2) & (uint32_t)(~1);
-		p->cap += delta;
-		assert(p->cap >= prev_cap);
+	if (cap > CDB_MAX_WORDS) {
+		fprintf(stderr, "[satomi] The clause database exceeds %llu words. "
+		        "Build with CREF64=1 for bigger instances.\n",
+		        (unsigned long long) CDB_MAX_WORDS);
+		exit(EXIT_FAILURE);
+	}
+	while (new_cap < cap) {
+		uint64_t delta = ((new_cap >> 1) + (new_cap >> 3) + 2) & ~(uint64_t) 1;
+		new_cap += delta;
+	}
+	map_size = stm_map_round(new_cap * sizeof(uint32_t));
+	data = stm_map_grow(p->data, p->map_size, map_size);
+	if (data == NULL) {
+		fprintf(stderr, "[satomi] Failed to grow the clause database from "
+		        "%.1f MB to %.1f MB.\n", 1.0 * p->map_size / (1 << 20),
+		        1.0 * map_size / (1 << 20));
+		exit(EXIT_FAILURE);
 	}
-	assert(p->cap > 0);
-	p->data = STM_REALLOC(uint32_t, p->data, p->cap);
+	p->data = data;
+	p->map_size = map_size;
+	new_cap = map_size / sizeof(uint32_t);
+	p->cap = (cref_t)(new_cap < CDB_MAX_WORDS ? new_cap : CDB_MAX_WORDS);
+	assert(p->cap >= cap);
 }
 
 static inline struct cdb *
-cdb_alloc(uint32_t cap)
+cdb_alloc(uint64_t cap)
 {
 	struct cdb *p = STM_CALLOC(struct cdb, 1);
 	if (cap <= 0)
@@ -67,16 +114,16 @@ cdb_alloc(uint32_t cap)
 static inline void
 cdb_free(struct cdb *p)
 {
-	STM_FREE(p->data);
+	stm_map_free(p->data, p->map_size);
 	STM_FREE(p);
 }
 
-static inline uint32_t
+static inline cref_t
 cdb_append(struct cdb *p, uint32_t size)
 {
-	uint32_t prev_size;
+	cref_t prev_size;
 	assert(size > 0);
-	cdb_grow(p, p->size + size);
+	cdb_grow(p, (uint64_t) p->size + size);
 	prev_size = p->size;
 	p->size += size;
 	assert(p->size > prev_size);
@@ -86,13 +133,13 @@ cdb_append(struct cdb *p, uint32_t size)
 static inline void
 cdb_remove(struct cdb *p, struct clause *clause) { p->wasted += clause->size; }
 
-static inline uint32_t
+static inline cref_t
 cdb_capacity(struct cdb *p) { return p->cap; }
 
-static inline uint32_t
+static inline cref_t
 cdb_size(struct cdb *p) { return p->size; }
 
-static inline uint32_t
+static inline cref_t
 cdb_wasted(struct cdb *p) { return p->wasted; }
 
 #endif /* SATOMI__CDB_H */
@@ -0,0 +1,491 @@
+//===--- checker.c ----------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "checker.h"
+#include "clause.h"
+#include "satomi.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/vec/vec.h"
+
+enum {
+	CHK_UNDEF = 0,
+	CHK_TRUE = 1,
+	CHK_FALSE = 2
+};
+
+/* Number of words the solver accumulates before handing learnt clauses over
+ * to the checking thread. */
+#define CHK_FLUSH_WORDS (1 << 12)
+/* Marks, in the size of a submitted clause, a clause added without a check */
+#define CHK_AXIOM 0x80000000u
+
+//===------------------------------------------------------------------------===
+// Checker internal functions
+//===------------------------------------------------------------------------===
+static inline uint8_t
+checker_value(struct checker *c, uint32_t lit) { return vec_data(c->values)[lit]; }
+
+static inline void
+checker_assign(struct checker *c, uint32_t lit)
+{
+	vec_data(c->values)[lit] = CHK_TRUE;
+	vec_data(c->values)[lit ^ 1] = CHK_FALSE;
+	vec_push_back(c->trail, lit);
+}
+
+static void
+checker_grow(struct checker *c, uint32_t n_vars)
+{
+	if (n_vars <= c->n_vars)
+		return;
+	vec_resize(c->values, 2 * n_vars);
+	memset(vec_data(c->values) + 2 * c->n_vars, CHK_UNDEF, 2 * (n_vars - c->n_vars));
+	if (2 * n_vars > c->watches_cap) {
+		uint32_t cap = c->watches_cap < 16 ? 16 : c->watches_cap;
+
+		while (cap < 2 * n_vars)
+			cap *= 2;
+		c->watches = STM_REALLOC(vec_cref_t *, c->watches, cap);
+		for (uint32_t i = c->watches_cap; i < cap; i++)
+			c->watches[i] = vec_cref_alloc(0);
+		c->watches_cap = cap;
+	}
+	c->n_vars = n_vars;
+}
+
+/**
+ *  Appends a clause to the checker's database. Literals are sorted and
+ *  duplicates removed so that no clause watches the same literal twice.
+ */
+static cref_t
+checker_append(struct checker *c, const uint32_t *lits, uint32_t size)
+{
+	struct clause *clause;
+	cref_t cref;
+	uint32_t i, j;
+	uint32_t max_var = 0;
+
+	cref = cdb_append(c->clause_db, 1 + size);
+	clause = cdb_handler(c->clause_db, cref);
+	memcpy(&(clause->lits[0]), lits, sizeof(uint32_t) * size);
+	qsort(&(clause->lits[0]), size, sizeof(uint32_t), stm_ui32_comp_desc);
+	for (i = j = 0; i < size; i++) {
+		if (j > 0 && clause->lits[i] == clause->lits[j - 1])
+			continue;
+		clause->lits[j++] = clause->lits[i];
+	}
+	clause->size = j;
+	if (j > 0)
+		max_var = clause->lits[0] >> 1;
+	checker_grow(c, max_var + 1);
+	return cref;
+}
+
+static int
+checker_propagate(struct checker *c)
+{
+	while (c->i_qhead < vec_size(c->trail)) {
+		uint32_t false_lit = vec_at(c->trail, c->i_qhead++) ^ 1;
+		vec_cref_t *ws = c->watches[false_lit];
+		cref_t *crefs = vec_data(ws);
+		uint32_t n = vec_size(ws);
+		uint32_t i, j;
+
+		for (i = j = 0; i < n; i++) {
+			struct clause *clause = cdb_handler(c->clause_db, crefs[i]);
+			uint32_t *lits = &(clause->lits[0]);
+
+			if (lits[0] == false_lit)
+				STM_SWAP(uint32_t, lits[0], lits[1]);
+			if (checker_value(c, lits[0]) == CHK_TRUE) {
+				crefs[j++] = crefs[i];
+				continue;
+			}
+			for (uint32_t k = 2; k < clause->size; k++) {
+				if (checker_value(c, lits[k]) != CHK_FALSE) {
+					STM_SWAP(uint32_t, lits[1], lits[k]);
+					vec_push_back(c->watches[lits[1]], crefs[i]);
+					goto next;
+				}
+			}
+			crefs[j++] = crefs[i];
+			if (checker_value(c, lits[0]) == CHK_FALSE) {
+				for (i++; i < n; i++)
+					crefs[j++] = crefs[i];
+				vec_shrink(ws, j);
+				c->i_qhead = vec_size(c->trail);
+				return 1;
+			}
+			checker_assign(c, lits[0]);
+		next:
+			;
+		}
+		vec_shrink(ws, j);
+	}
+	return 0;
+}
+
+/**
+ *  Attaches a clause at level zero. Two non-false literals are moved to the
+ *  front and watched; clauses with a single one are units and get propagated
+ *  right away, clauses with none make the database inconsistent.
+ */
+static void
+checker_attach(struct checker *c, cref_t cref)
+{
+	struct clause *clause = cdb_handler(c->clause_db, cref);
+	uint32_t *lits = &(clause->lits[0]);
+	uint32_t n = 0;
+
+	if (c->inconsistent)
+		return;
+	for (uint32_t k = 0; k < clause->size && n < 2; k++) {
+		if (checker_value(c, lits[k]) != CHK_FALSE) {
+			STM_SWAP(uint32_t, lits[n], lits[k]);
+			n++;
+		}
+	}
+	if (n == 0) {
+		c->inconsistent = 1;
+	} else if (n == 1) {
+		if (checker_value(c, lits[0]) == CHK_UNDEF) {
+			checker_assign(c, lits[0]);
+			c->inconsistent = checker_propagate(c);
+		}
+	} else {
+		vec_push_back(c->watches[lits[0]], cref);
+		vec_push_back(c->watches[lits[1]], cref);
+	}
+}
+
+static void
+checker_init_rup(struct checker *c)
+{
+	uint32_t *data = vec_data(c->originals);
+	uint32_t i = 0;
+
+	if (c->rup_ready)
+		return;
+	c->rup_ready = 1;
+	while (i < vec_size(c->originals)) {
+		checker_attach(c, checker_append(c, data + i + 1, data[i]));
+		i += 1 + data[i];
+	}
+}
+
+/**
+ *  Reverse unit propagation: falsify every literal of the clause and check
+ *  that unit propagation gets into a conflict. The assignment is undone
+ *  afterwards, leaving only the level zero literals on the trail.
+ */
+static int
+checker_rup(struct checker *c, const uint32_t *lits, uint32_t size)
+{
+	uint32_t mark = vec_size(c->trail);
+	int conflict = 0;
+
+	if (c->inconsistent)
+		return 1;
+	for (uint32_t i = 0; i < size && !conflict; i++) {
+		uint8_t value = checker_value(c, lits[i]);
+		if (value == CHK_TRUE)
+			conflict = 1;
+		else if (value == CHK_UNDEF)
+			checker_assign(c, lits[i] ^ 1);
+	}
+	if (!conflict)
+		conflict = checker_propagate(c);
+	for (uint32_t i = mark; i < vec_size(c->trail); i++) {
+		uint32_t lit = vec_at(c->trail, i);
+		vec_data(c->values)[lit] = CHK_UNDEF;
+		vec_data(c->values)[lit ^ 1] = CHK_UNDEF;
+	}
+	vec_shrink(c->trail, mark);
+	c->i_qhead = mark;
+	return conflict;
+}
+
+/**
+ *  Checks a batch of learnt clauses, returning the number of clauses that
+ *  failed. Failed clauses are not added to the database.
+ */
+static uint64_t
+checker_process(struct checker *c, vec_ui32_t *batch, uint64_t *n_clauses)
+{
+	uint32_t *data = vec_data(batch);
+	uint32_t i = 0;
+	uint64_t n_failed = 0;
+	double start = stm_clock();
+
+	*n_clauses = 0;
+	while (i < vec_size(batch)) {
+		uint32_t size = data[i] & ~CHK_AXIOM;
+		uint32_t *lits = data + i + 1;
+
+		/* Learnt clauses may mention variables no original clause has */
+		for (uint32_t k = 0; k < size; k++)
+			checker_grow(c, (lits[k] >> 1) + 1);
+		if ((data[i] & CHK_AXIOM) || checker_rup(c, lits, size))
+			checker_attach(c, checker_append(c, lits, size));
+		else
+			n_failed++;
+		(*n_clauses)++;
+		i += 1 + size;
+	}
+	vec_clear(batch);
+	c->check_time += stm_clock() - start;
+	return n_failed;
+}
+
+static void
+checker_flush(struct checker *c)
+{
+	if (vec_size(c->buffer) == 0)
+		return;
+	pthread_mutex_lock(&c->lock);
+	if (vec_size(c->pending) == 0) {
+		STM_SWAP(vec_ui32_t *, c->pending, c->buffer);
+	} else {
+		uint32_t size = vec_size(c->pending);
+		vec_resize(c->pending, size + vec_size(c->buffer));
+		memcpy(vec_data(c->pending) + size, vec_data(c->buffer),
+		       sizeof(uint32_t) * vec_size(c->buffer));
+		vec_clear(c->buffer);
+	}
+	pthread_cond_signal(&c->has_work);
+	pthread_mutex_unlock(&c->lock);
+}
+
+static void *
+checker_thread(void *arg)
+{
+	struct checker *c = (struct checker *) arg;
+
+	checker_init_rup(c);
+	pthread_mutex_lock(&c->lock);
+	while (1) {
+		uint64_t n_clauses, n_failed;
+
+		while (vec_size(c->pending) == 0 && !c->stop) {
+			pthread_cond_broadcast(&c->idle);
+			pthread_cond_wait(&c->has_work, &c->lock);
+		}
+		if (vec_size(c->pending) == 0)
+			break;
+		STM_SWAP(vec_ui32_t *, c->pending, c->work);
+		pthread_mutex_unlock(&c->lock);
+		n_failed = checker_process(c, c->work, &n_clauses);
+		pthread_mutex_lock(&c->lock);
+		c->n_checked += n_clauses - n_failed;
+		c->n_failed += n_failed;
+	}
+	pthread_cond_broadcast(&c->idle);
+	pthread_mutex_unlock(&c->lock);
+	return NULL;
+}
+
+//===------------------------------------------------------------------------===
+// Checker external functions
+//===------------------------------------------------------------------------===
+struct checker *
+checker_alloc(int threaded)
+{
+	struct checker *c = STM_CALLOC(struct checker, 1);
+
+	c->originals = vec_ui32_alloc(0);
+	c->clause_db = cdb_alloc(0);
+	c->values = vec_ui8_alloc(0);
+	c->trail = vec_ui32_alloc(0);
+	c->buffer = vec_ui32_alloc(0);
+	c->pending = vec_ui32_alloc(0);
+	c->work = vec_ui32_alloc(0);
+	c->threaded = (uint8_t) threaded;
+	pthread_mutex_init(&c->lock, NULL);
+	pthread_cond_init(&c->has_work, NULL);
+	pthread_cond_init(&c->idle, NULL);
+	return c;
+}
+
+void
+checker_free(struct checker *c)
+{
+	if (c->running) {
+		pthread_mutex_lock(&c->lock);
+		c->stop = 1;
+		pthread_cond_signal(&c->has_work);
+		pthread_mutex_unlock(&c->lock);
+		pthread_join(c->thread, NULL);
+	}
+	pthread_mutex_destroy(&c->lock);
+	pthread_cond_destroy(&c->has_work);
+	pthread_cond_destroy(&c->idle);
+	for (uint32_t i = 0; i < c->watches_cap; i++)
+		vec_free(c->watches[i]);
+	STM_FREE(c->watches);
+	vec_free(c->originals);
+	cdb_free(c->clause_db);
+	vec_free(c->values);
+	vec_free(c->trail);
+	vec_free(c->buffer);
+	vec_free(c->pending);
+	vec_free(c->work);
+	STM_FREE(c);
+}
+
+/**
+ *  Original clauses added once the checker has started checking, e.g. between
+ *  two incremental solves, are taken as axioms: the RUP database is already
+ *  seeded, and on the checking thread it can only grow in order with the
+ *  learnt clauses.
+ */
+void
+checker_add_original(struct checker *c, const uint32_t *lits, uint32_t size)
+{
+	uint32_t max_var = 0;
+
+	if (c->running || c->rup_ready) {
+		checker_add_axiom(c, lits, size);
+		return;
+	}
+	vec_push_back(c->originals, size);
+	for (uint32_t i = 0; i < size; i++) {
+		vec_push_back(c->originals, lits[i]);
+		if ((lits[i] >> 1) > max_var)
+			max_var = lits[i] >> 1;
+	}
+	checker_grow(c, max_var + 1);
+	c->n_originals++;
+}
+
+static void
+checker_submit(struct checker *c, const uint32_t *lits, uint32_t size, uint32_t flags)
+{
+	vec_push_back(c->buffer, size | flags);
+	for (uint32_t i = 0; i < size; i++)
+		vec_push_back(c->buffer, lits[i]);
+	c->n_submitted++;
+	if (c->running && vec_size(c->buffer) >= CHK_FLUSH_WORDS)
+		checker_flush(c);
+}
+
+void
+checker_add_learnt(struct checker *c, const uint32_t *lits, uint32_t size)
+{
+	checker_submit(c, lits, size, 0);
+}
+
+/**
+ *  Adds a clause that constrains the formula further (e.g. blocking a model),
+ *  taken as it is, in order with the learnt clauses.
+ */
+void
+checker_add_axiom(struct checker *c, const uint32_t *lits, uint32_t size)
+{
+	checker_submit(c, lits, size, CHK_AXIOM);
+}
+
+void
+checker_start(struct checker *c)
+{
+	if (!c->threaded || c->running)
+		return;
+	if (pthread_create(&c->thread, NULL, checker_thread, c) != 0) {
+		fprintf(stdout, "[checker] Couldn't start thread, checking at the end.\n");
+		c->threaded = 0;
+		return;
+	}
+	c->running = 1;
+}
+
+/**
+ *  Evaluates every original clause under the model, given as a truth value
+ *  for each literal. Literals are evaluated eight at a time and combined
+ *  without branches, which keeps the loop free of mispredictions for the
+ *  common case of a clause satisfied within its first literals.
+ */
+int
+checker_check_model(struct checker *c, const uint8_t *lit_true, uint32_t n_lits)
+{
+	uint32_t *data = vec_data(c->originals);
+	uint32_t cref = 0;
+	double start = stm_clock();
+
+	if (n_lits < 2 * c->n_vars)
+		return SATOMI_ERR;
+	while (cref < vec_size(c->originals)) {
+		uint32_t size = data[cref];
+		const uint32_t *lits = data + cref + 1;
+		uint8_t sat = 0;
+		uint32_t i = 0;
+
+		for (; !sat && i + 8 <= size; i += 8)
+			sat = lit_true[lits[i + 0]] | lit_true[lits[i + 1]]
+			    | lit_true[lits[i + 2]] | lit_true[lits[i + 3]]
+			    | lit_true[lits[i + 4]] | lit_true[lits[i + 5]]
+			    | lit_true[lits[i + 6]] | lit_true[lits[i + 7]];
+		for (; i < size; i++)
+			sat |= lit_true[lits[i]];
+		if (!sat) {
+			c->check_time += stm_clock() - start;
+			return SATOMI_ERR;
+		}
+		cref += 1 + size;
+	}
+	c->check_time += stm_clock() - start;
+	return SATOMI_OK;
+}
+
+/** Waits for every submitted clause to be checked. */
+static void
+checker_sync(struct checker *c)
+{
+	if (c->running) {
+		checker_flush(c);
+		pthread_mutex_lock(&c->lock);
+		while (c->n_checked + c->n_failed < c->n_submitted)
+			pthread_cond_wait(&c->idle, &c->lock);
+		pthread_mutex_unlock(&c->lock);
+	} else {
+		uint64_t n_clauses, n_failed;
+
+		checker_init_rup(c);
+		n_failed = checker_process(c, c->buffer, &n_clauses);
+		c->n_checked += n_clauses - n_failed;
+		c->n_failed += n_failed;
+	}
+}
+
+/**
+ *  Waits for every learnt clause to be checked and then confirms that the
+ *  database is inconsistent at level zero.
+ */
+int
+checker_check_unsat(struct checker *c)
+{
+	checker_sync(c);
+	if (!c->inconsistent)
+		c->inconsistent = checker_propagate(c);
+	return (c->n_failed == 0 && c->inconsistent) ? SATOMI_OK : SATOMI_ERR;
+}
+
+/**
+ *  Confirms an UNSAT answer under assumptions: the clause negating the failing
+ *  assumptions must follow, by RUP, from the checked learnt clauses.
+ */
+int
+checker_check_implied(struct checker *c, const uint32_t *lits, uint32_t size)
+{
+	checker_add_learnt(c, lits, size);
+	checker_sync(c);
+	return (c->n_failed == 0) ? SATOMI_OK : SATOMI_ERR;
+}
@@ -0,0 +1,77 @@
+//===--- checker.h ----------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__CHECKER_H
+#define SATOMI__CHECKER_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "cdb.h"
+#include "utils/vec/vec.h"
+
+/**
+ *  The checker keeps its own copy of the original clauses, stored back to back
+ *  in a flat array separated from the solver's database (which gets modified
+ *  by the search). Models are evaluated directly against this copy.
+ *
+ *  Unsatisfiability is checked by forward RUP (reverse unit propagation): each
+ *  learnt clause must lead to a conflict by unit propagation once all its
+ *  literals are falsified. Checked clauses are added to a database of their
+ *  own, seeded with the original clauses, and the
+ *  answer is confirmed when unit propagation at level zero gets into a
+ *  conflict. The check can run on a second thread, consuming the learnt
+ *  clauses as the solver produces them.
+ */
+struct checker {
+	/* Original clauses: each one is stored as its size followed by its lits */
+	vec_ui32_t *originals;
+	uint32_t n_originals;
+	uint32_t n_vars;
+
+	/* RUP state: originals and checked learnt clauses */
+	struct cdb *clause_db;
+	uint8_t rup_ready;
+	vec_ui8_t *values;
+	vec_ui32_t *trail;
+	vec_cref_t **watches;
+	uint32_t watches_cap;
+	uint32_t i_qhead;
+	uint8_t inconsistent;
+
+	/* Learnt clauses: each one is stored as its size followed by its lits */
+	vec_ui32_t *buffer;
+	vec_ui32_t *pending;
+	vec_ui32_t *work;
+	uint64_t n_submitted;
+	uint64_t n_checked;
+	uint64_t n_failed;
+	double check_time;
+
+	/* Concurrent mode */
+	uint8_t threaded;
+	uint8_t running;
+	uint8_t stop;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t has_work;
+	pthread_cond_t idle;
+};
+
+//===------------------------------------------------------------------------===
+extern struct checker *checker_alloc(int threaded);
+extern void checker_free(struct checker *);
+extern void checker_add_original(struct checker *, const uint32_t *, uint32_t);
+extern void checker_add_learnt(struct checker *, const uint32_t *, uint32_t);
+extern void checker_add_axiom(struct checker *, const uint32_t *, uint32_t);
+extern void checker_start(struct checker *);
+extern int checker_check_model(struct checker *, const uint8_t *, uint32_t);
+extern int checker_check_unsat(struct checker *);
+extern int checker_check_implied(struct checker *, const uint32_t *, uint32_t);
+
+#endif /* SATOMI__CHECKER_H */
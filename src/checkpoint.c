@@ -0,0 +1,453 @@
+//===--- checkpoint.c -------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "satomi.h"
+#include "solver.h"
+#include "watch_list.h"
+#include "utils/mem.h"
+
+/* A periodic checkpoint, written on a thread of its own from a copy of the
+ * sections taken at a conflict */
+struct ckpt_writer {
+	struct ckpt_header h;
+	const void *data[CKPT_N_SECTIONS];
+	char *buffer;
+	size_t buffer_size;
+	const char *path;
+	char *tmp;
+	pthread_t thread;
+	atomic_int done;
+	int ret;
+};
+
+//===------------------------------------------------------------------------===
+// Checkpoint internal functions
+//===------------------------------------------------------------------------===
+static inline uint64_t
+ckpt_align(uint64_t offset)
+{
+	return (offset + CKPT_ALIGN - 1) & ~((uint64_t) CKPT_ALIGN - 1);
+}
+
+static inline uint32_t
+ckpt_trail_size(solver_t *s)
+{
+	if (solver_dlevel(s) == 0)
+		return vec_size(s->trail);
+	return vec_at(s->trail_lim, 0);
+}
+
+/** Fills the header and gathers the data of each section. */
+static void
+ckpt_layout(solver_t *s, struct ckpt_header *h, const void **data)
+{
+	uint64_t offset;
+	uint32_t i;
+
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, CKPT_MAGIC, sizeof(h->magic));
+	h->version = CKPT_VERSION;
+	h->cref_bytes = sizeof(cref_t);
+	h->n_vars = s->n_vars;
+	h->n_sections = CKPT_N_SECTIONS;
+	h->cdb_wasted = s->clause_db->wasted;
+	h->n_garbage = s->n_garbage;
+	h->wl_n_free = s->watches->n_free;
+	memcpy(h->wl_free_lists, s->watches->free_lists, sizeof(h->wl_free_lists));
+	h->stats = s->stats;
+	h->heur = s->heur->state;
+
+	data[CKPT_NAME] = s->fname;
+	h->sections[CKPT_NAME].size = strlen(s->fname) + 1;
+	data[CKPT_TRAIL] = vec_data(s->trail);
+	h->sections[CKPT_TRAIL].size = sizeof(uint32_t) * (uint64_t) ckpt_trail_size(s);
+	data[CKPT_CLAUSES] = vec_data(s->clauses);
+	h->sections[CKPT_CLAUSES].size = sizeof(cref_t) * (uint64_t) vec_size(s->clauses);
+	data[CKPT_CDB] = s->clause_db->data;
+	h->sections[CKPT_CDB].size = sizeof(uint32_t) * (uint64_t) cdb_size(s->clause_db);
+	data[CKPT_WATCH_LISTS] = s->watches->watch_lists;
+	h->sections[CKPT_WATCH_LISTS].size = sizeof(struct watch_list) * (uint64_t) s->watches->size;
+	data[CKPT_WATCH_ARENA] = s->watches->watchers;
+	h->sections[CKPT_WATCH_ARENA].size = sizeof(struct watcher) * s->watches->arena_size;
+	data[CKPT_PHASES] = vec_data(s->polarity);
+	h->sections[CKPT_PHASES].size = s->n_vars;
+	data[CKPT_VMTF_LINKS] = s->heur->links;
+	h->sections[CKPT_VMTF_LINKS].size = sizeof(struct vmtf_link) * (uint64_t) s->n_vars;
+	data[CKPT_SCORES] = s->heur->scores;
+	h->sections[CKPT_SCORES].size = sizeof(double) * (uint64_t) s->n_vars;
+	data[CKPT_ERWA] = s->heur->erwa;
+	h->sections[CKPT_ERWA].size = sizeof(struct erwa_var) * (uint64_t) s->n_vars;
+
+	offset = ckpt_align(sizeof(*h));
+	for (i = 0; i < CKPT_N_SECTIONS; i++) {
+		h->sections[i].offset = offset;
+		offset = ckpt_align(offset + h->sections[i].size);
+	}
+}
+
+static int
+ckpt_pwrite(int fd, const void *data, uint64_t size, uint64_t offset)
+{
+	const char *p = data;
+
+	while (size > 0) {
+		ssize_t n = pwrite(fd, p, size, (off_t) offset);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return SATOMI_ERR;
+		}
+		p += n;
+		size -= (uint64_t) n;
+		offset += (uint64_t) n;
+	}
+	return SATOMI_OK;
+}
+
+/**
+ *  Writes the header and the sections to 'tmp' and renames it to 'path', so
+ *  that a previous checkpoint is only replaced by a complete one.
+ */
+static int
+ckpt_write(const struct ckpt_header *h, const void **data, const char *path,
+           const char *tmp)
+{
+	int ret = SATOMI_OK;
+	int fd;
+	uint32_t i;
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return SATOMI_ERR;
+	ret = ckpt_pwrite(fd, h, sizeof(*h), 0);
+	for (i = 0; ret && i < CKPT_N_SECTIONS; i++)
+		ret = ckpt_pwrite(fd, data[i], h->sections[i].size, h->sections[i].offset);
+	if (ret && fsync(fd) != 0)
+		ret = SATOMI_ERR;
+	if (close(fd) != 0)
+		ret = SATOMI_ERR;
+	if (ret && rename(tmp, path) != 0)
+		ret = SATOMI_ERR;
+	if (!ret)
+		unlink(tmp);
+	return ret;
+}
+
+static char *
+ckpt_tmp_path(const char *path)
+{
+	size_t len = strlen(path) + 5;
+	char *tmp = STM_ALLOC(char, len);
+
+	if (tmp)
+		snprintf(tmp, len, "%s.tmp", path);
+	return tmp;
+}
+
+static void
+ckpt_writer_free(struct ckpt_writer *w)
+{
+	stm_map_free(w->buffer, w->buffer_size);
+	STM_FREE(w->tmp);
+	STM_FREE(w);
+}
+
+/**
+ *  Copies the sections of the solver, one after the other, into a buffer of
+ *  the writer, which then only refers to its copy. Returns NULL if memory is
+ *  short.
+ */
+static struct ckpt_writer *
+ckpt_snapshot(solver_t *s)
+{
+	struct ckpt_writer *w = STM_CALLOC(struct ckpt_writer, 1);
+	uint64_t size = 0;
+	char *p;
+	uint32_t i;
+
+	if (w == NULL)
+		return NULL;
+	ckpt_layout(s, &w->h, w->data);
+	for (i = 0; i < CKPT_N_SECTIONS; i++)
+		size += w->h.sections[i].size;
+	w->path = s->opts.checkpoint;
+	w->tmp = ckpt_tmp_path(w->path);
+	w->buffer_size = stm_map_round(size);
+	w->buffer = stm_map_alloc(w->buffer_size);
+	if (w->tmp == NULL || w->buffer == NULL) {
+		ckpt_writer_free(w);
+		return NULL;
+	}
+	p = w->buffer;
+	for (i = 0; i < CKPT_N_SECTIONS; i++) {
+		memcpy(p, w->data[i], w->h.sections[i].size);
+		w->data[i] = p;
+		p += w->h.sections[i].size;
+	}
+	return w;
+}
+
+static void *
+ckpt_thread(void *arg)
+{
+	struct ckpt_writer *w = (struct ckpt_writer *) arg;
+
+	w->ret = ckpt_write(&w->h, w->data, w->path, w->tmp);
+	atomic_store(&w->done, 1);
+	return NULL;
+}
+
+/** Joins the writer once it is done, or right away when 'wait' is set. */
+static void
+ckpt_reap(solver_t *s, int wait)
+{
+	struct ckpt_writer *w = s->ckpt_writer;
+
+	if (!wait && !atomic_load(&w->done))
+		return;
+	pthread_join(w->thread, NULL);
+	if (!w->ret)
+		fprintf(stdout, "[satomi] Couldn't write checkpoint: %s\n", w->path);
+	ckpt_writer_free(w);
+	s->ckpt_writer = NULL;
+}
+
+static int
+ckpt_check(const struct ckpt_header *h, uint64_t file_size)
+{
+	uint32_t i;
+
+	if (memcmp(h->magic, CKPT_MAGIC, sizeof(h->magic)) != 0
+	    || h->version != CKPT_VERSION || h->cref_bytes != sizeof(cref_t)
+	    || h->n_sections != CKPT_N_SECTIONS)
+		return SATOMI_ERR;
+	for (i = 0; i < CKPT_N_SECTIONS; i++) {
+		const struct ckpt_section *sec = &h->sections[i];
+		if (sec->offset > file_size || sec->size > file_size - sec->offset)
+			return SATOMI_ERR;
+	}
+	if (h->sections[CKPT_NAME].size == 0
+	    || h->sections[CKPT_TRAIL].size % sizeof(uint32_t)
+	    || h->sections[CKPT_CLAUSES].size % sizeof(cref_t)
+	    || h->sections[CKPT_CDB].size % sizeof(uint32_t)
+	    || h->sections[CKPT_CDB].size / sizeof(uint32_t) > CDB_MAX_WORDS
+	    || h->sections[CKPT_WATCH_LISTS].size != 2 * sizeof(struct watch_list) * (uint64_t) h->n_vars
+	    || h->sections[CKPT_WATCH_ARENA].size % sizeof(struct watcher)
+	    || h->sections[CKPT_PHASES].size != h->n_vars
+	    || h->sections[CKPT_VMTF_LINKS].size != sizeof(struct vmtf_link) * (uint64_t) h->n_vars
+	    || h->sections[CKPT_SCORES].size != sizeof(double) * (uint64_t) h->n_vars
+	    || h->sections[CKPT_ERWA].size != sizeof(struct erwa_var) * (uint64_t) h->n_vars)
+		return SATOMI_ERR;
+	return SATOMI_OK;
+}
+
+static inline int
+ckpt_bad_var(uint32_t var, uint32_t n_vars)
+{
+	return var != UNDEF && var >= n_vars;
+}
+
+/** Loads the sections into a solver with 'n_vars' variables. */
+static int
+ckpt_load(solver_t *s, const struct ckpt_header *h, const char *base)
+{
+	const struct ckpt_section *sec = h->sections;
+	uint64_t n_words = sec[CKPT_CDB].size / sizeof(uint32_t);
+	uint64_t n_slots = sec[CKPT_WATCH_ARENA].size / sizeof(struct watcher);
+	uint32_t n_clauses = sec[CKPT_CLAUSES].size / sizeof(cref_t);
+	uint32_t n_trail = sec[CKPT_TRAIL].size / sizeof(uint32_t);
+	const uint32_t *trail = (const uint32_t *)(base + sec[CKPT_TRAIL].offset);
+	struct heur *heur = s->heur;
+	cref_t *clauses;
+	uint32_t i;
+
+	cdb_grow(s->clause_db, n_words);
+	memcpy(s->clause_db->data, base + sec[CKPT_CDB].offset, sec[CKPT_CDB].size);
+	s->clause_db->size = (cref_t) n_words;
+	s->clause_db->wasted = (cref_t) h->cdb_wasted;
+	s->n_garbage = h->n_garbage;
+
+	vec_resize(s->clauses, n_clauses);
+	clauses = vec_data(s->clauses);
+	memcpy(clauses, base + sec[CKPT_CLAUSES].offset, sec[CKPT_CLAUSES].size);
+	for (i = 0; i < n_clauses; i++)
+		if (clauses[i] >= n_words)
+			return SATOMI_ERR;
+
+	/* Watches are taken as they are, only their bounds are checked */
+	if (!vec_wl_arena_reserve(s->watches, n_slots))
+		return SATOMI_ERR;
+	memcpy(s->watches->watchers, base + sec[CKPT_WATCH_ARENA].offset,
+	       sec[CKPT_WATCH_ARENA].size);
+	s->watches->arena_size = n_slots;
+	s->watches->n_free = h->wl_n_free;
+	memcpy(s->watches->free_lists, h->wl_free_lists, sizeof(h->wl_free_lists));
+	memcpy(s->watches->watch_lists, base + sec[CKPT_WATCH_LISTS].offset,
+	       sec[CKPT_WATCH_LISTS].size);
+	for (i = 0; i < s->watches->size; i++) {
+		struct watch_list *wl = s->watches->watch_lists + i;
+		if (wl->size > wl->cap || wl->n_bin > wl->size
+		    || (wl->cap && wl->start + wl->cap > n_slots))
+			return SATOMI_ERR;
+	}
+
+	/* The level zero trail is propagated again by the search */
+	for (i = 0; i < n_trail; i++) {
+		if (lit2var(trail[i]) >= s->n_vars)
+			return SATOMI_ERR;
+		if (lit_value(s, trail[i]) == VAR_UNASSING)
+			solver_enqueue(s, trail[i], CREF_UNDEF);
+	}
+	s->i_qhead = 0;
+	s->stats = h->stats;
+
+	/* So is the VMTF queue */
+	memcpy(vec_data(s->polarity), base + sec[CKPT_PHASES].offset, sec[CKPT_PHASES].size);
+	memcpy(heur->links, base + sec[CKPT_VMTF_LINKS].offset, sec[CKPT_VMTF_LINKS].size);
+	memcpy(heur->scores, base + sec[CKPT_SCORES].offset, sec[CKPT_SCORES].size);
+	memcpy(heur->erwa, base + sec[CKPT_ERWA].offset, sec[CKPT_ERWA].size);
+	heur->state = h->heur;
+	if (heur->state.mode > HEUR_CHB
+	    || ckpt_bad_var(heur->state.first, s->n_vars)
+	    || ckpt_bad_var(heur->state.last, s->n_vars))
+		return SATOMI_ERR;
+	for (i = 0; i < s->n_vars; i++) {
+		if (ckpt_bad_var(heur->links[i].prev, s->n_vars)
+		    || ckpt_bad_var(heur->links[i].next, s->n_vars))
+			return SATOMI_ERR;
+		vec_data(s->polarity)[i] &= 1;
+	}
+	heur_reset(s);
+	return SATOMI_OK;
+}
+
+//===------------------------------------------------------------------------===
+// Checkpoint external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Called after conflicts: every 'checkpoint_interval' conflicts, the solver
+ *  copies its sections and a thread writes the checkpoint from the copy, so
+ *  that the search only stops for the copy. A checkpoint is skipped while the
+ *  previous one is still being written.
+ */
+void
+checkpoint_periodic(solver_t *s)
+{
+	struct ckpt_writer *w;
+
+	if (s->stats.n_conflicts < s->ckpt_next)
+		return;
+	s->ckpt_next = s->stats.n_conflicts + s->opts.checkpoint_interval;
+	if (s->ckpt_writer) {
+		ckpt_reap(s, 0);
+		if (s->ckpt_writer)
+			return;
+	}
+	w = ckpt_snapshot(s);
+	if (w == NULL) {
+		fprintf(stdout, "[satomi] Couldn't copy the solver to write checkpoint: "
+		        "%s\n", s->opts.checkpoint);
+		return;
+	}
+	if (pthread_create(&w->thread, NULL, ckpt_thread, w) != 0) {
+		fprintf(stdout, "[satomi] Couldn't start thread, writing checkpoint "
+		        "now.\n");
+		ckpt_thread(w);
+		if (!w->ret)
+			fprintf(stdout, "[satomi] Couldn't write checkpoint: %s\n", w->path);
+		ckpt_writer_free(w);
+		return;
+	}
+	s->ckpt_writer = w;
+}
+
+void
+checkpoint_wait(solver_t *s)
+{
+	if (s->ckpt_writer)
+		ckpt_reap(s, 1);
+}
+
+/**
+ *  Writes a checkpoint of the solver to 'path'. The search resumes from it at
+ *  level zero. Answer checking state is not saved.
+ */
+int
+satomi_checkpoint(satomi_t *s, const char *path)
+{
+	char *tmp = ckpt_tmp_path(path);
+	struct ckpt_header h;
+	const void *data[CKPT_N_SECTIONS];
+	int ret;
+
+	if (tmp == NULL)
+		return SATOMI_ERR;
+	ckpt_layout(s, &h, data);
+	ret = ckpt_write(&h, data, path, tmp);
+	if (!ret)
+		fprintf(stdout, "[satomi] Couldn't write checkpoint: %s\n", path);
+	STM_FREE(tmp);
+	return ret;
+}
+
+/**
+ *  Creates a solver from a checkpoint. The file is mapped and its sections
+ *  copied straight into the solver's arrays. Returns NULL if the file can't be
+ *  read or isn't a valid checkpoint (for this build of satomi).
+ */
+satomi_t *
+satomi_restore(const char *path)
+{
+	const struct ckpt_header *h;
+	satomi_t *s = NULL;
+	struct stat st;
+	char *base;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		fprintf(stdout, "Couldn't open file: %s\n", path);
+		return NULL;
+	}
+	if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(*h)) {
+		fprintf(stdout, "[satomi] Invalid checkpoint: %s\n", path);
+		close(fd);
+		return NULL;
+	}
+	base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		fprintf(stdout, "Couldn't map file: %s\n", path);
+		return NULL;
+	}
+	h = (const struct ckpt_header *) base;
+	if (ckpt_check(h, st.st_size)
+	    && base[h->sections[CKPT_NAME].offset + h->sections[CKPT_NAME].size - 1] == '\0') {
+		s = satomi_create(base + h->sections[CKPT_NAME].offset);
+		for (uint32_t i = 0; i < h->n_vars; i++)
+			satomi_add_variable(s);
+		if (!ckpt_load(s, h, base)) {
+			satomi_destroy(s);
+			s = NULL;
+		}
+	}
+	if (s == NULL)
+		fprintf(stdout, "[satomi] Invalid checkpoint: %s\n", path);
+	munmap(base, st.st_size);
+	return s;
+}
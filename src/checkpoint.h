@@ -0,0 +1,70 @@
+//===--- checkpoint.h -------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__CHECKPOINT_H
+#define SATOMI__CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "heuristic.h"
+#include "solver.h"
+
+#define CKPT_MAGIC "SATOMICK"
+#define CKPT_VERSION 8
+/* Sections start at page boundaries, so that they can be mapped in place */
+#define CKPT_ALIGN 4096
+
+/**
+ *  A checkpoint holds the state the search can resume from at level zero: the
+ *  clauses database arena, the list of clauses, the watch lists (with their
+ *  arena, as is), the level zero trail, the state of the decision heuristics
+ *  and the statistics. The file is a
+ *  header followed by sections, each one a raw copy of an array of the solver.
+ *
+ *  Watches are kept exactly as they were, which is sound since propagation of
+ *  the level zero trail is started again from the beginning when restoring.
+ */
+enum {
+	CKPT_NAME = 0,
+	CKPT_TRAIL,
+	CKPT_CLAUSES,
+	CKPT_CDB,
+	CKPT_WATCH_LISTS,
+	CKPT_WATCH_ARENA,
+	CKPT_PHASES,
+	CKPT_VMTF_LINKS,
+	CKPT_SCORES,
+	CKPT_ERWA,
+	CKPT_N_SECTIONS
+};
+
+struct ckpt_section {
+	uint64_t offset;
+	uint64_t size; /* in bytes */
+};
+
+struct ckpt_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t cref_bytes;
+	uint32_t n_vars;
+	uint32_t n_sections;
+	uint64_t cdb_wasted;
+	uint64_t n_garbage;
+	uint64_t wl_n_free;
+	uint64_t wl_free_lists[WL_N_CLASSES];
+	struct satomi_stats stats;
+	struct heur_state heur;
+	struct ckpt_section sections[CKPT_N_SECTIONS];
+};
+
+//===------------------------------------------------------------------------===
+extern void checkpoint_periodic(solver_t *);
+extern void checkpoint_wait(solver_t *);
+
+#endif /* SATOMI__CHECKPOINT_H */
@@ -20,6 +20,11 @@ struct clause {
 //===------------------------------------------------------------------------===
 // Clause API
 //===------------------------------------------------------------------------===
+/* Deleted clauses keep their place in the database with a size of zero, until
+ * no watcher refers to them anymore */
+static inline int
+clause_is_garbage(struct clause *clause) { return clause->size == 0; }
+
 static inline void
 clause_print(struct clause *clause)
 {
@@ -8,143 +8,384 @@
 //===------------------------------------------------------------------------===
 #include <assert.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "core.h"
 #include "satomi.h"
 #include "solver.h"
 #include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/parse.h"
 #include "utils/vec/vec.h"
 
-/** Read the file into an internal buffer.
- *
- * This function will receive a file name. The return data is a string ended
- * with '\0'.
- *
+/* Files are split in chunks of at least this size, one per thread */
+#define CNF_CHUNK_MIN_SIZE (8 << 20)
+#define CNF_MAX_THREADS 64
+
+/**
+ *  The clauses of a chunk, each one stored as its size followed by its
+ *  literals, sorted and without duplicates (tautologies are dropped).
  */
-static char *
-file_open(const char *fname)
+struct cnf_chunk {
+	char *begin;
+	char *end;
+	vec_ui32_t *clauses;
+	vec_ui32_t *lits;
+	uint32_t n_clauses;
+	uint8_t threaded;
+	int error; /* set on a format error, which stops the chunk */
+	pthread_t thread;
+};
+
+/** Returns SATOMI_ERR on a format error. Comment lines may come in the middle
+ *  of a clause. */
+static int
+read_clause(char **token, vec_ui32_t *lits)
 {
-	FILE *file = fopen(fname, "rb");
-	char *buffer;
-	size_t sz_file;
+	int error = 0;
+	int var;
+	uint32_t sign;
 
-	if (file == NULL) {
-		fprintf(stdout, "Couldn't open file: %s\n", fname);
-		exit(EXIT_FAILURE);
+	vec_clear(lits);
+	while (1) {
+		skip_spaces(token);
+		if (**token == 'c') {
+			skip_line(token);
+			continue;
+		}
+		var = read_int(token, &error);
+		if (error)
+			return SATOMI_ERR;
+		if (var == 0)
+			return SATOMI_OK;
+		sign = (var > 0);
+		var = abs(var) - 1;
+		vec_push_back(lits, var2lit((uint32_t) var, !sign));
 	}
-	fseek(file, 0, SEEK_END);
-	sz_file = ftell(file);
-	rewind(file);
-	buffer = STM_ALLOC(char, sz_file + 3);
-	fread(buffer, sz_file, 1, file);
-	buffer[sz_file + 0] = '\n';
-	buffer[sz_file + 1] = '\0';
-	return buffer;
 }
 
-static void
-skip_spaces(char **pos)
+/** Sorts the literals in descending order and drops the duplicated ones.
+ *  Returns false if the clause is a tautology. */
+static int
+normalize_clause(vec_ui32_t *lits)
 {
-	assert(pos != NULL);
-	for (; isspace(**pos); (*pos)++);
+	uint32_t *data = vec_data(lits);
+	uint32_t i, j;
+
+	qsort((void *) data, vec_size(lits), sizeof(uint32_t), stm_ui32_comp_desc);
+	for (i = j = 1; i < vec_size(lits); i++) {
+		if (data[i] == data[j - 1])
+			continue;
+		if (data[i] == lit_neg(data[j - 1]))
+			return 0;
+		data[j++] = data[i];
+	}
+	if (vec_size(lits))
+		vec_shrink(lits, j);
+	return 1;
 }
 
-static void
-skip_line(char **pos)
+static void *
+cnf_chunk_parse(void *arg)
 {
-	assert(pos != NULL);
-	for(; **pos != '\n' && **pos != '\r' && **pos != EOF; (*pos)++);
-	if (**pos != EOF)
-		(*pos)++;
-	return;
+	struct cnf_chunk *chunk = arg;
+	char *token = chunk->begin;
+
+	while (1) {
+		skip_spaces(&token);
+		if (*token == 0 || token >= chunk->end)
+			break;
+		if (*token == 'c') {
+			skip_line(&token);
+			continue;
+		}
+		if (!read_clause(&token, chunk->lits)) {
+			chunk->error = 1;
+			break;
+		}
+		if (!normalize_clause(chunk->lits))
+			continue;
+		vec_push_back(chunk->clauses, vec_size(chunk->lits));
+		for (uint32_t i = 0; i < vec_size(chunk->lits); i++)
+			vec_push_back(chunk->clauses, vec_at(chunk->lits, i));
+		chunk->n_clauses++;
+	}
+	return NULL;
 }
 
+/**
+ *  Returns true if the line ending right before 'pos' ends with a '0' token.
+ *  Comment lines and the parameter line never end a clause, whatever their
+ *  last token.
+ */
 static int
-read_int(char **token)
+line_ends_clause(const char *begin, const char *pos)
 {
-	int value = 0;
-	int neg = 0;
+	const char *start = pos - 1;
+	const char *p = pos - 1;
 
-	skip_spaces(token);
-	if (**token == '-') {
-		neg = 1;
-		(*token)++;
-	} else if (**token == '+')
-		(*token)++;
-
-	if (!isdigit(**token)) {
-		fprintf(stdout, "Parsing error. Unexpected char: %c.\n", **token);
-		exit(EXIT_FAILURE);
+	while (start > begin && start[-1] != '\n')
+		start--;
+	while (start < p && isspace((unsigned char) *start))
+		start++;
+	if (*start == 'c' || *start == 'p')
+		return 0;
+	while (p > start && isspace((unsigned char) p[-1]))
+		p--;
+	return p > start && p[-1] == '0'
+	       && (p - 1 == start || isspace((unsigned char) p[-2]));
+}
+
+/**
+ *  Splits the clauses in '[begin, end)' at line starts that follow the end of a
+ *  clause. Returns the number of chunks.
+ */
+static uint32_t
+cnf_split(char *begin, char *end, struct cnf_chunk *chunks, uint32_t n_chunks)
+{
+	size_t size = end - begin;
+	char *prev = begin;
+	uint32_t n = 0;
+
+	for (uint32_t i = 1; i < n_chunks; i++) {
+		char *pos = begin + size / n_chunks * i;
+
+		if (pos <= prev)
+			continue;
+		while (pos < end) {
+			char *nl = memchr(pos, '\n', end - pos);
+			if (nl == NULL) {
+				pos = end;
+				break;
+			}
+			pos = nl + 1;
+			if (line_ends_clause(prev, nl + 1))
+				break;
+		}
+		if (pos >= end)
+			break;
+		chunks[n].begin = prev;
+		chunks[n++].end = pos;
+		prev = pos;
 	}
-	while (isdigit(**token)) {
-		value = (value * 10) + (**token - '0');
-		(*token)++;
+	chunks[n].begin = prev;
+	chunks[n++].end = end;
+	return n;
+}
+
+static uint32_t
+cnf_n_threads(size_t size)
+{
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t n = size / CNF_CHUNK_MIN_SIZE;
+
+	if (n_cpus < 1)
+		n_cpus = 1;
+	if (n > (size_t) n_cpus)
+		n = n_cpus;
+	if (n > CNF_MAX_THREADS)
+		n = CNF_MAX_THREADS;
+	return n ? (uint32_t) n : 1;
+}
+
+/** Adds the clauses of a chunk, returns false upon immediate conflict. */
+static int
+cnf_chunk_add(satomi_t *p, struct cnf_chunk *chunk)
+{
+	uint32_t *data = vec_data(chunk->clauses);
+	uint32_t *end = data + vec_size(chunk->clauses);
+
+	while (data < end) {
+		uint32_t size = *data++;
+
+		if (p->core) {
+			core_add_clause(p, data, size);
+			data += size;
+			continue;
+		}
+		if (p->checker)
+			checker_add_original(p->checker, data, size);
+		if (!solver_add_clause_sorted(p, data, size)) {
+			fprintf(stdout, "Conflicting clause: ");
+			for (uint32_t i = 0; i < size; i++)
+				fprintf(stdout, "%s%u ", lit_polarity(data[i]) ? "-" : "",
+				        lit2var(data[i]) + 1);
+			fprintf(stdout, "0\n");
+			return 0;
+		}
+		data += size;
 	}
-	return neg ? -value : value;
+	return SATOMI_OK;
 }
 
-static void
-read_clause(char **token, vec_ui32_t *lits)
+/**
+ *  Opens a DIMACS file and reads its header: comments and the parameter line,
+ *  whose number of variables goes to 'n_vars' if given. Returns the buffer of the file,
+ *  'token' pointing to its first clause, NULL on a read or format error.
+ */
+static char *
+cnf_open(char *fname, size_t *size, char **token, uint32_t *n_vars)
 {
-	int var;
-	uint32_t sign;
+	char *buffer = file_open(fname, size);
+	int error = 0;
+	int n;
 
-	vec_clear(lits);
+	if (buffer == NULL)
+		return NULL;
+	*token = buffer;
 	while (1) {
-		var = read_int(token);
-		if (var == 0)
+		skip_spaces(token);
+		if (**token == 'c')
+			skip_line(token);
+		else
 			break;
-		sign = (var > 0);
-		var = abs(var) - 1;
-		vec_push_back(lits, var2lit((uint32_t) var, !sign));
 	}
+	if (**token != 'p') {
+		if (**token != 0)
+			fprintf(stdout, "There is no parameter line.\n");
+		STM_FREE(buffer);
+		return NULL;
+	}
+	(*token)++;
+	skip_spaces(token);
+	for(; !isspace(**token); (*token)++); /* skip 'cnf' */
+	n = read_int(token, &error); /* variables */
+	read_int(token, &error); /* clauses */
+	if (error || n < 0) {
+		STM_FREE(buffer);
+		return NULL;
+	}
+	skip_line(token);
+	if (n_vars)
+		*n_vars = (uint32_t) n;
+	return buffer;
+}
+
+/**
+ *  Adds the clauses from 'token' up to 'end'. Big files are split in chunks,
+ *  at clause boundaries, which are tokenized on parallel threads. The clauses
+ *  are then added in the order of the file, so the result does not depend on
+ *  the number of threads. Returns false upon immediate conflict. On a format
+ *  error, sets 'error' and adds nothing more.
+ */
+static int
+cnf_read_clauses(satomi_t *p, char *token, char *end, int *error)
+{
+	struct cnf_chunk chunks[CNF_MAX_THREADS];
+	uint32_t n_chunks;
+	int ret = SATOMI_OK;
+
+	n_chunks = cnf_split(token, end, chunks, cnf_n_threads(end - token));
+	for (uint32_t i = 0; i < n_chunks; i++) {
+		chunks[i].clauses = vec_ui32_alloc(0);
+		chunks[i].lits = vec_ui32_alloc(0);
+		chunks[i].n_clauses = 0;
+		chunks[i].threaded = 0;
+		chunks[i].error = 0;
+	}
+	for (uint32_t i = 1; i < n_chunks; i++)
+		chunks[i].threaded = !pthread_create(&chunks[i].thread, NULL,
+		                                     cnf_chunk_parse, &chunks[i]);
+	for (uint32_t i = 0; i < n_chunks; i++)
+		if (!chunks[i].threaded)
+			cnf_chunk_parse(&chunks[i]);
+	for (uint32_t i = 0; i < n_chunks; i++) {
+		if (chunks[i].threaded)
+			pthread_join(chunks[i].thread, NULL);
+		if (chunks[i].error)
+			*error = 1;
+		if (ret && !*error)
+			ret = cnf_chunk_add(p, &chunks[i]);
+		vec_free(chunks[i].clauses);
+		vec_free(chunks[i].lits);
+	}
+	return ret;
 }
 
 /** Start the solver and reads the DIMAC file.
  *
- * Returns false upon immediate conflict.
+ * The solver is configured with 'opts', when given, before any clause is added.
+ * Returns false upon immediate conflict, in which case the solver is still
+ * returned (the formula is unsatisfiable). On a read or format error, no solver
+ * is returned.
  */
 int
-satomi_parse_dimacs(char *fname, satomi_t **solver)
+satomi_parse_dimacs(char *fname, satomi_opts_t *opts, satomi_t **solver)
 {
 	satomi_t *p = NULL;
-	vec_ui32_t *lits = NULL;
-	int n_var;
-	int n_clause;
-	char *token = file_open(fname);
-	char *name = strrchr(fname, '/') + 1;
+	int error = 0;
+	int ret;
+	size_t size;
+	uint32_t n_vars;
+	char *token;
+	char *buffer = cnf_open(fname, &size, &token, &n_vars);
+	char *name = strrchr(fname, '/');
 
-	while (1) {
-		skip_spaces(&token);
-		if (*token == 0)
-			break;
-		else if (*token == 'c')
-			skip_line(&token);
-		else if (*token == 'p') {
-			token++;
-			skip_spaces(&token);
-			for(; !isspace(*token); token++); /* skip 'cnf' */
+	*solver = NULL;
+	if (buffer == NULL)
+		return SATOMI_ERR;
+	name = name ? name + 1 : fname;
+	p = satomi_create(name);
+	if (opts)
+		satomi_configure(p, opts);
+	/* Variables of the header that no clause mentions are free in models */
+	solver_reserve_vars(p, n_vars);
+	ret = cnf_read_clauses(p, token, buffer + size, &error);
+	STM_FREE(buffer);
+	if (error) {
+		satomi_destroy(p);
+		return SATOMI_ERR;
+	}
+	*solver = p;
+	return ret;
+}
 
-			n_var = read_int(&token);
-			n_clause = read_int(&token);
-			skip_line(&token);
-			lits = vec_ui32_alloc((uint32_t) n_var);
-			p = satomi_create(name);
-		} else {
-			if (lits == NULL) {
-				fprintf(stdout, "There is no parameter line.\n");
-				return -1;
-			}
-			read_clause(&token, lits);
-			if (!satomi_add_clause(p, vec_data(lits), vec_size(lits))) {
-				vec_print(lits);
-				return 0;
-			}
-        	}
+/**
+ *  Starts the solver with the clauses of two DIMACS files, A then B, recording
+ *  the refutation for satomi_write_interpolant. Returns as satomi_parse_dimacs.
+ */
+int
+satomi_parse_partition(char *a_fname, char *b_fname, satomi_opts_t *opts,
+                       satomi_t **solver)
+{
+	satomi_opts_t itp_opts;
+	satomi_t *p = NULL;
+	int error = 0;
+	int ret;
+	size_t a_size, b_size;
+	char *a_token, *b_token;
+	char *a_buffer = cnf_open(a_fname, &a_size, &a_token, NULL);
+	char *b_buffer = a_buffer ? cnf_open(b_fname, &b_size, &b_token, NULL) : NULL;
+	char *name = strrchr(a_fname, '/');
+
+	*solver = NULL;
+	if (b_buffer == NULL) {
+		STM_FREE(a_buffer);
+		return SATOMI_ERR;
+	}
+	name = name ? name + 1 : a_fname;
+	p = satomi_create(name);
+	if (opts)
+		itp_opts = *opts;
+	else
+		satomi_default_opts(&itp_opts);
+	itp_opts.core = 0;
+	itp_opts.interpolate = 1;
+	satomi_configure(p, &itp_opts);
+	ret = cnf_read_clauses(p, a_token, a_buffer + a_size, &error);
+	satomi_set_partition(p, 1);
+	if (ret && !error)
+		ret = cnf_read_clauses(p, b_token, b_buffer + b_size, &error);
+	STM_FREE(a_buffer);
+	STM_FREE(b_buffer);
+	if (error) {
+		satomi_destroy(p);
+		return SATOMI_ERR;
 	}
-	vec_free(lits);
 	*solver = p;
-	return SATOMI_OK;
+	return ret;
 }
@@ -0,0 +1,405 @@
+//===--- core.c -------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+
+#include "core.h"
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/vec/vec.h"
+
+/* State of each clause during the MUS extraction */
+enum {
+	MUS_REMOVED = 0,
+	MUS_CANDIDATE,
+	MUS_NECESSARY
+};
+
+/**
+ *  The working set is made of the candidate and the necessary clauses. The
+ *  occurrence lists, over the clauses of the first core, serve model rotation.
+ */
+struct mus {
+	uint8_t *state;
+	uint8_t *model;     /* value of each variable of the formula */
+	uint32_t *occ_start; /* per literal, where its clauses start in 'occs' */
+	uint32_t *occs;
+	vec_ui32_t *assumptions;
+	vec_ui32_t *frames; /* model rotation: clause, next literal, flipped var */
+};
+
+//===------------------------------------------------------------------------===
+// Core internal functions
+//===------------------------------------------------------------------------===
+static inline const uint32_t *
+core_clause(struct core *core, uint32_t id, uint32_t *size)
+{
+	uint32_t *data = vec_data(core->clauses) + vec_at(core->offsets, id);
+
+	*size = data[0];
+	return data + 1;
+}
+
+/** Gives the kept clauses to the solver, each one with its selector. */
+static void
+core_attach(solver_t *s)
+{
+	struct core *core = s->core;
+	vec_ui32_t *lits = vec_ui32_alloc(0);
+
+	core->attached = 1;
+	core->first_selector = s->n_vars;
+	for (uint32_t i = 0; i < core_n_clauses(core); i++)
+		satomi_add_variable(s);
+	for (uint32_t i = 0; i < core_n_clauses(core); i++) {
+		uint32_t size;
+		const uint32_t *clause = core_clause(core, i, &size);
+
+		vec_clear(lits);
+		for (uint32_t j = 0; j < size; j++)
+			vec_push_back(lits, clause[j]);
+		vec_push_back(lits, lit_neg(core_selector(core, i)));
+		if (s->checker)
+			checker_add_original(s->checker, vec_data(lits), vec_size(lits));
+		solver_attach_clause(s, vec_data(lits), vec_size(lits));
+	}
+	vec_free(lits);
+}
+
+/** Disables a clause for good, the checker takes it as given. */
+static void
+core_disable(solver_t *s, uint32_t id)
+{
+	uint32_t lit = lit_neg(core_selector(s->core, id));
+
+	solver_backjump(s, 0);
+	if (s->checker)
+		checker_add_axiom(s->checker, &lit, 1);
+	solver_attach_clause(s, &lit, 1);
+}
+
+/** Marks, in 'in_core', the clauses whose selectors failed. */
+static void
+core_mark_failed(solver_t *s, uint8_t *in_core)
+{
+	uint32_t lit, i;
+
+	vec_ui32_foreach(s->failed, lit, i)
+		if (lit2var(lit) >= s->core->first_selector)
+			in_core[lit2var(lit) - s->core->first_selector] = 1;
+}
+
+static inline int
+mus_lit_true(struct mus *m, uint32_t lit)
+{
+	return m->model[lit2var(lit)] != lit_polarity(lit);
+}
+
+/** Occurrence lists of the literals over the clauses still in the working set. */
+static void
+mus_occurrences(struct core *core, struct mus *m)
+{
+	uint32_t n_lits = 2 * core->first_selector;
+	uint32_t n_occs = 0;
+
+	m->occ_start = STM_CALLOC(uint32_t, n_lits + 1);
+	for (uint32_t id = 0; id < core_n_clauses(core); id++) {
+		uint32_t size;
+		const uint32_t *clause = core_clause(core, id, &size);
+
+		if (m->state[id] == MUS_REMOVED)
+			continue;
+		for (uint32_t i = 0; i < size; i++)
+			m->occ_start[clause[i] + 1]++;
+		n_occs += size;
+	}
+	for (uint32_t lit = 0; lit < n_lits; lit++)
+		m->occ_start[lit + 1] += m->occ_start[lit];
+	m->occs = STM_ALLOC(uint32_t, n_occs ? n_occs : 1);
+	for (uint32_t id = 0; id < core_n_clauses(core); id++) {
+		uint32_t size;
+		const uint32_t *clause = core_clause(core, id, &size);
+
+		if (m->state[id] == MUS_REMOVED)
+			continue;
+		for (uint32_t i = 0; i < size; i++)
+			m->occs[m->occ_start[clause[i]]++] = id;
+	}
+	for (uint32_t lit = n_lits; lit > 0; lit--)
+		m->occ_start[lit] = m->occ_start[lit - 1];
+	m->occ_start[0] = 0;
+}
+
+/**
+ *  Returns the only clause of the working set falsified once 'lit' is made
+ *  false, UNDEF if there is none or more than one. Only clauses with 'lit'
+ *  can be, the model satisfying all the others.
+ */
+static uint32_t
+mus_falsified(struct core *core, struct mus *m, uint32_t lit)
+{
+	uint32_t found = UNDEF;
+
+	for (uint32_t k = m->occ_start[lit]; k < m->occ_start[lit + 1]; k++) {
+		uint32_t id = m->occs[k];
+		uint32_t size, i;
+		const uint32_t *clause;
+
+		if (m->state[id] == MUS_REMOVED)
+			continue;
+		clause = core_clause(core, id, &size);
+		for (i = 0; i < size && !mus_lit_true(m, clause[i]); i++);
+		if (i < size)
+			continue;
+		if (found != UNDEF)
+			return UNDEF;
+		found = id;
+	}
+	return found;
+}
+
+/**
+ *  Model rotation: the model falsifies only the clause 'id', now necessary.
+ *  Flipping one of its variables may leave a single other clause falsified,
+ *  which is then necessary too, and is rotated from in turn. The recursion is
+ *  kept on an explicit stack of frames.
+ */
+static void
+mus_rotate(struct core *core, struct mus *m, uint32_t id)
+{
+	vec_clear(m->frames);
+	vec_push_back(m->frames, id);
+	vec_push_back(m->frames, 0);
+	vec_push_back(m->frames, UNDEF);
+	while (vec_size(m->frames)) {
+		uint32_t *frame = vec_data(m->frames) + vec_size(m->frames) - 3;
+		uint32_t size, lit, next;
+		const uint32_t *clause = core_clause(core, frame[0], &size);
+
+		if (frame[1] == size) {
+			if (frame[2] != UNDEF)
+				m->model[frame[2]] ^= 1;
+			vec_shrink(m->frames, vec_size(m->frames) - 3);
+			continue;
+		}
+		lit = clause[frame[1]++];
+		m->model[lit2var(lit)] ^= 1;
+		next = mus_falsified(core, m, lit_neg(lit));
+		if (next != UNDEF && m->state[next] == MUS_CANDIDATE) {
+			m->state[next] = MUS_NECESSARY;
+			vec_push_back(m->frames, next);
+			vec_push_back(m->frames, 0);
+			vec_push_back(m->frames, lit2var(lit));
+			continue;
+		}
+		m->model[lit2var(lit)] ^= 1;
+	}
+}
+
+/** Clause-set refinement: the clauses out of the last core are removed. */
+static void
+mus_refine(solver_t *s, struct mus *m, uint8_t *in_core)
+{
+	core_mark_failed(s, in_core);
+	for (uint32_t id = 0; id < core_n_clauses(s->core); id++) {
+		if (m->state[id] == MUS_CANDIDATE && !in_core[id]) {
+			m->state[id] = MUS_REMOVED;
+			core_disable(s, id);
+		}
+		in_core[id] = 0;
+	}
+}
+
+//===------------------------------------------------------------------------===
+// Core external functions
+//===------------------------------------------------------------------------===
+struct core *
+core_alloc(void)
+{
+	struct core *core = STM_CALLOC(struct core, 1);
+
+	core->clauses = vec_ui32_alloc(0);
+	core->offsets = vec_ui32_alloc(0);
+	return core;
+}
+
+void
+core_free(struct core *core)
+{
+	vec_free(core->clauses);
+	vec_free(core->offsets);
+	STM_FREE(core);
+}
+
+/**
+ *  Keeps an original clause aside. Returns false once the clauses reached the
+ *  solver: selectors then follow the variables of the formula.
+ */
+int
+core_add_clause(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	struct core *core = s->core;
+
+	if (core->attached)
+		return SATOMI_ERR;
+	vec_push_back(core->offsets, vec_size(core->clauses));
+	vec_push_back(core->clauses, size);
+	for (uint32_t i = 0; i < size; i++) {
+		while (lit2var(lits[i]) >= s->n_vars)
+			satomi_add_variable(s);
+		vec_push_back(core->clauses, lits[i]);
+	}
+	return SATOMI_OK;
+}
+
+/**
+ *  Solves with the 'n' clauses of 'ids' (all of them if there is none), the
+ *  ones out of the core of an UNSAT answer being left unassumed.
+ */
+int
+core_solve(solver_t *s, const uint32_t *ids, uint32_t n)
+{
+	struct core *core = s->core;
+	vec_ui32_t *assumptions = vec_ui32_alloc(ids ? n : core_n_clauses(core));
+	int status;
+
+	if (!core->attached)
+		core_attach(s);
+	for (uint32_t i = 0; i < (ids ? n : core_n_clauses(core)); i++)
+		vec_push_back(assumptions, core_selector(core, ids ? ids[i] : i));
+	status = solver_solve(s, vec_data(assumptions), vec_size(assumptions));
+	vec_free(assumptions);
+	return status;
+}
+
+/**
+ *  Gives the reference and the literals of an original clause, as numbered in
+ *  the order they were added. Returns its size, or zero out of core mode.
+ */
+uint32_t
+satomi_core_clause(solver_t *s, uint32_t id, const uint32_t **lits)
+{
+	uint32_t size = 0;
+
+	*lits = NULL;
+	if (s->core && id < core_n_clauses(s->core))
+		*lits = core_clause(s->core, id, &size);
+	return size;
+}
+
+/**
+ *  Finds an UNSAT core: the original clauses whose selectors the UNSAT answer
+ *  is due to. Their numbers are given, in increasing order, to 'core_fn'.
+ *  Needs the clauses to be tagged ('core' option). Returns the answer.
+ */
+int
+satomi_core(solver_t *s, void (*core_fn)(void *, const uint32_t *, uint32_t),
+            void *data)
+{
+	uint8_t *in_core;
+	vec_ui32_t *ids;
+	int status;
+
+	if (s->core == NULL)
+		return SATOMI_UNDEC;
+	s->stats.init_time = stm_clock();
+	status = core_solve(s, NULL, 0);
+	if (status != SATOMI_UNSAT)
+		return status;
+	in_core = STM_CALLOC(uint8_t, core_n_clauses(s->core));
+	ids = vec_ui32_alloc(vec_size(s->failed));
+	core_mark_failed(s, in_core);
+	for (uint32_t id = 0; id < core_n_clauses(s->core); id++)
+		if (in_core[id])
+			vec_push_back(ids, id);
+	core_fn(data, vec_data(ids), vec_size(ids));
+	STM_FREE(in_core);
+	vec_free(ids);
+	return status;
+}
+
+/**
+ *  Extracts a minimal unsatisfiable subset of the original clauses by deletion:
+ *  each clause of the first core is dropped in turn, and is necessary if the
+ *  others are then satisfiable. All the calls are made by the same solver, so
+ *  learnt clauses carry over. Two things spare calls:
+ *
+ *  - clause-set refinement: on an UNSAT answer, the clauses out of its core
+ *    are dropped too;
+ *  - model rotation: the model of a SAT answer, falsifying only the clause
+ *    tested, can show other clauses to be necessary (see mus_rotate).
+ *
+ *  The MUS is given to 'mus_fn' as for satomi_core. Removed clauses stay
+ *  disabled in the solver. Returns the answer.
+ */
+int
+satomi_mus(solver_t *s, void (*mus_fn)(void *, const uint32_t *, uint32_t),
+           void *data)
+{
+	struct core *core = s->core;
+	struct mus m;
+	uint8_t *in_core;
+	int status;
+
+	if (core == NULL)
+		return SATOMI_UNDEC;
+	s->stats.init_time = stm_clock();
+	status = core_solve(s, NULL, 0);
+	if (status != SATOMI_UNSAT)
+		return status;
+
+	m.state = STM_ALLOC(uint8_t, core_n_clauses(core));
+	memset(m.state, MUS_CANDIDATE, core_n_clauses(core));
+	m.model = STM_CALLOC(uint8_t, core->first_selector);
+	m.assumptions = vec_ui32_alloc(0);
+	m.frames = vec_ui32_alloc(0);
+	in_core = STM_CALLOC(uint8_t, core_n_clauses(core));
+	mus_refine(s, &m, in_core);
+	mus_occurrences(core, &m);
+
+	for (uint32_t id = 0; id < core_n_clauses(core); id++) {
+		if (m.state[id] != MUS_CANDIDATE)
+			continue;
+		vec_clear(m.assumptions);
+		for (uint32_t j = 0; j < core_n_clauses(core); j++)
+			if (j != id && m.state[j] != MUS_REMOVED)
+				vec_push_back(m.assumptions, core_selector(core, j));
+		status = solver_solve(s, vec_data(m.assumptions), vec_size(m.assumptions));
+		if (status == SATOMI_UNSAT && vec_size(s->failed)) {
+			m.state[id] = MUS_REMOVED;
+			core_disable(s, id);
+			mus_refine(s, &m, in_core);
+		} else if (status == SATOMI_SAT) {
+			m.state[id] = MUS_NECESSARY;
+			for (uint32_t var = 0; var < core->first_selector; var++)
+				m.model[var] = vec_at(s->model, var);
+			mus_rotate(core, &m, id);
+		} else {
+			status = SATOMI_UNDEC;
+			break;
+		}
+	}
+	if (status != SATOMI_UNDEC) {
+		status = SATOMI_UNSAT;
+		vec_clear(m.assumptions);
+		for (uint32_t id = 0; id < core_n_clauses(core); id++)
+			if (m.state[id] == MUS_NECESSARY)
+				vec_push_back(m.assumptions, id);
+		mus_fn(data, vec_data(m.assumptions), vec_size(m.assumptions));
+	}
+	STM_FREE(m.state);
+	STM_FREE(m.model);
+	STM_FREE(m.occ_start);
+	STM_FREE(m.occs);
+	STM_FREE(in_core);
+	vec_free(m.assumptions);
+	vec_free(m.frames);
+	return status;
+}
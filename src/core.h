@@ -0,0 +1,45 @@
+//===--- core.h -------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__CORE_H
+#define SATOMI__CORE_H
+
+#include <stdint.h>
+
+#include "solver.h"
+
+/**
+ *  Original clauses tagged for cores: the clauses are kept aside as they are
+ *  added and reach the solver, on the first call, each one weakened by the
+ *  negation of its own selector variable. Selectors come after every variable
+ *  of the formula, the one of clause 'i' being 'first_selector' + i. A clause
+ *  takes part in a call when its selector is assumed.
+ */
+struct core {
+	vec_ui32_t *clauses; /* each one as its size followed by its literals */
+	vec_ui32_t *offsets; /* where each clause starts in 'clauses' */
+	uint32_t first_selector;
+	uint8_t attached;
+};
+
+static inline uint32_t
+core_n_clauses(struct core *core) { return vec_size(core->offsets); }
+
+static inline uint32_t
+core_selector(struct core *core, uint32_t id)
+{
+	return var2lit(core->first_selector + id, 0);
+}
+
+//===------------------------------------------------------------------------===
+extern struct core *core_alloc(void);
+extern void core_free(struct core *);
+extern int core_add_clause(solver_t *, const uint32_t *, uint32_t);
+extern int core_solve(solver_t *, const uint32_t *, uint32_t);
+
+#endif /* SATOMI__CORE_H */
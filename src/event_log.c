@@ -0,0 +1,255 @@
+//===--- event_log.c --------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+#include <string.h>
+
+#include "event_log.h"
+#include "satomi.h"
+#include "utils/mem.h"
+#include "utils/parse.h"
+#include "utils/vec/vec.h"
+
+/* Longest varint, for 64-bit values */
+#define EVLOG_MAX_VARINT 10
+
+//===------------------------------------------------------------------------===
+// Event log internal functions
+//===------------------------------------------------------------------------===
+static void
+evlog_flush(struct event_log *log)
+{
+	if (log->size && !log->failed
+	    && fwrite(log->buffer, log->size, 1, log->file) != 1) {
+		fprintf(stdout, "[satomi] Failed to write the event log.\n");
+		log->failed = 1;
+	}
+	log->size = 0;
+}
+
+/** Makes room in the buffer for an event of 'n_fields' fields. */
+static inline void
+evlog_reserve(struct event_log *log, uint32_t n_fields)
+{
+	if (log->size + 1 + n_fields * EVLOG_MAX_VARINT > EVLOG_BUFFER_SIZE)
+		evlog_flush(log);
+}
+
+static inline void
+evlog_put(struct event_log *log, uint64_t value)
+{
+	while (value >= 0x80) {
+		log->buffer[log->size++] = (uint8_t) value | 0x80;
+		value >>= 7;
+	}
+	log->buffer[log->size++] = (uint8_t) value;
+}
+
+static void
+evlog_decision(void *data, uint32_t lit, uint32_t level)
+{
+	struct event_log *log = data;
+
+	evlog_reserve(log, 2);
+	log->buffer[log->size++] = EVLOG_DECISION;
+	evlog_put(log, lit);
+	evlog_put(log, level);
+}
+
+static void
+evlog_conflict(void *data, uint64_t n_conflicts, uint32_t level)
+{
+	struct event_log *log = data;
+
+	evlog_reserve(log, 2);
+	log->buffer[log->size++] = EVLOG_CONFLICT;
+	evlog_put(log, n_conflicts);
+	evlog_put(log, level);
+}
+
+static void
+evlog_learnt(void *data, const uint32_t *lits, uint32_t size, uint32_t lbd)
+{
+	struct event_log *log = data;
+
+	evlog_reserve(log, 2);
+	log->buffer[log->size++] = EVLOG_LEARNT;
+	evlog_put(log, size);
+	evlog_put(log, lbd);
+	for (uint32_t i = 0; i < size; i++) {
+		if (log->size + EVLOG_MAX_VARINT > EVLOG_BUFFER_SIZE)
+			evlog_flush(log);
+		evlog_put(log, lits[i]);
+	}
+}
+
+static void
+evlog_backjump(void *data, uint32_t from_level, uint32_t to_level)
+{
+	struct event_log *log = data;
+
+	evlog_reserve(log, 2);
+	log->buffer[log->size++] = EVLOG_BACKJUMP;
+	evlog_put(log, from_level);
+	evlog_put(log, to_level);
+}
+
+static void
+evlog_restart(void *data, uint64_t n_conflicts)
+{
+	struct event_log *log = data;
+
+	evlog_reserve(log, 1);
+	log->buffer[log->size++] = EVLOG_RESTART;
+	evlog_put(log, n_conflicts);
+}
+
+static void
+evlog_reduce(void *data, uint64_t n_kept, uint64_t n_removed)
+{
+	struct event_log *log = data;
+
+	evlog_reserve(log, 2);
+	log->buffer[log->size++] = EVLOG_REDUCE;
+	evlog_put(log, n_kept);
+	evlog_put(log, n_removed);
+}
+
+/** Reads a varint, returns false past the end of the log. */
+static inline int
+evlog_get(const uint8_t **pos, const uint8_t *end, uint64_t *value)
+{
+	uint32_t shift = 0;
+
+	*value = 0;
+	while (*pos < end && shift < 64) {
+		uint8_t byte = *(*pos)++;
+
+		*value |= (uint64_t) (byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return SATOMI_OK;
+		shift += 7;
+	}
+	return SATOMI_ERR;
+}
+
+//===------------------------------------------------------------------------===
+// Event log external functions
+//===------------------------------------------------------------------------===
+struct event_log *
+event_log_open(const char *fname)
+{
+	struct event_log *log = STM_CALLOC(struct event_log, 1);
+	uint32_t version = EVLOG_VERSION;
+
+	log->file = fopen(fname, "wb");
+	if (log->file == NULL) {
+		fprintf(stdout, "Couldn't open file: %s\n", fname);
+		STM_FREE(log);
+		return NULL;
+	}
+	memcpy(log->buffer, EVLOG_MAGIC, 8);
+	memcpy(log->buffer + 8, &version, sizeof(uint32_t));
+	log->size = 8 + sizeof(uint32_t);
+	return log;
+}
+
+void
+event_log_hooks(struct event_log *log, struct satomi_hooks *hooks)
+{
+	hooks->data = log;
+	hooks->decision = evlog_decision;
+	hooks->conflict = evlog_conflict;
+	hooks->learnt = evlog_learnt;
+	hooks->backjump = evlog_backjump;
+	hooks->restart = evlog_restart;
+	hooks->reduce = evlog_reduce;
+}
+
+void
+event_log_close(struct event_log *log)
+{
+	evlog_flush(log);
+	fclose(log->file);
+	STM_FREE(log);
+}
+
+/**
+ *  Reads an event log and calls the hooks, the ones that are set, for each
+ *  event in order. Returns false if the file is not an event log, or is
+ *  truncated, in which case the events up to the damage were replayed.
+ */
+int
+satomi_replay(const char *fname, const struct satomi_hooks *hooks)
+{
+	size_t size;
+	char *buffer = file_open(fname, &size);
+	const uint8_t *pos = (const uint8_t *) buffer;
+	const uint8_t *end = pos + size;
+	vec_ui32_t *lits;
+	uint32_t version = 0;
+	int ret = SATOMI_OK;
+
+	if (buffer == NULL)
+		return SATOMI_ERR;
+	if (size >= 12)
+		memcpy(&version, buffer + 8, sizeof(uint32_t));
+	if (size < 12 || memcmp(buffer, EVLOG_MAGIC, 8) || version != EVLOG_VERSION) {
+		fprintf(stdout, "[satomi] %s is not an event log.\n", fname);
+		STM_FREE(buffer);
+		return SATOMI_ERR;
+	}
+	pos += 12;
+	lits = vec_ui32_alloc(0);
+	while (pos < end) {
+		uint8_t type = *pos++;
+		uint64_t a, b;
+
+		if (!evlog_get(&pos, end, &a)
+		    || (type != EVLOG_RESTART && !evlog_get(&pos, end, &b))) {
+			ret = SATOMI_ERR;
+			break;
+		}
+		if (type == EVLOG_DECISION) {
+			if (hooks->decision)
+				hooks->decision(hooks->data, a, b);
+		} else if (type == EVLOG_CONFLICT) {
+			if (hooks->conflict)
+				hooks->conflict(hooks->data, a, b);
+		} else if (type == EVLOG_LEARNT) {
+			uint64_t lit;
+
+			vec_clear(lits);
+			for (uint64_t i = 0; i < a && ret; i++) {
+				ret = evlog_get(&pos, end, &lit);
+				vec_push_back(lits, (uint32_t) lit);
+			}
+			if (!ret)
+				break;
+			if (hooks->learnt)
+				hooks->learnt(hooks->data, vec_data(lits), a, b);
+		} else if (type == EVLOG_BACKJUMP) {
+			if (hooks->backjump)
+				hooks->backjump(hooks->data, a, b);
+		} else if (type == EVLOG_RESTART) {
+			if (hooks->restart)
+				hooks->restart(hooks->data, a);
+		} else if (type == EVLOG_REDUCE) {
+			if (hooks->reduce)
+				hooks->reduce(hooks->data, a, b);
+		} else {
+			ret = SATOMI_ERR;
+			break;
+		}
+	}
+	if (!ret)
+		fprintf(stdout, "[satomi] The event log %s is damaged.\n", fname);
+	vec_free(lits);
+	STM_FREE(buffer);
+	return ret;
+}
@@ -0,0 +1,48 @@
+//===--- event_log.h --------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__EVENT_LOG_H
+#define SATOMI__EVENT_LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "satomi.h"
+
+#define EVLOG_MAGIC "SATOMIEV"
+#define EVLOG_VERSION 1
+#define EVLOG_BUFFER_SIZE (1 << 16)
+
+/**
+ *  The event log is a consumer of the hooks writing every event it gets to a
+ *  file: the magic and the version (32 bits), then the events, each one a type
+ *  byte followed by the arguments of its hook as LEB128 varints. A learnt
+ *  clause is written as its size, its LBD and its literals.
+ */
+enum {
+	EVLOG_DECISION = 1,
+	EVLOG_CONFLICT,
+	EVLOG_LEARNT,
+	EVLOG_BACKJUMP,
+	EVLOG_RESTART,
+	EVLOG_REDUCE
+};
+
+struct event_log {
+	FILE *file;
+	uint32_t size;
+	uint8_t failed;
+	uint8_t buffer[EVLOG_BUFFER_SIZE];
+};
+
+//===------------------------------------------------------------------------===
+extern struct event_log *event_log_open(const char *);
+extern void event_log_hooks(struct event_log *, struct satomi_hooks *);
+extern void event_log_close(struct event_log *);
+
+#endif /* SATOMI__EVENT_LOG_H */
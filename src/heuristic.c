@@ -0,0 +1,504 @@
+//===--- heuristic.c --------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdlib.h>
+#include <string.h>
+
+#include "heuristic.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/vec/vec.h"
+
+#define HEUR_DECAY 0.95
+#define HEUR_MAX_SCORE 1e100
+#define HEUR_LUBY_UNIT 1024   /* conflicts, in stable mode */
+#define HEUR_RESTART_MARGIN 1.1
+#define HEUR_STEP_INIT 0.4
+#define HEUR_STEP_MIN 0.06
+#define HEUR_STEP_DECAY 1e-6  /* per conflict */
+#define HEUR_CHB_MISS 0.9     /* reward multiplier of a propagation without conflict */
+#define HEUR_LRB_DECAY 0.95   /* per conflict a variable stays unassigned */
+
+//===------------------------------------------------------------------------===
+// Heuristic internal functions
+//===------------------------------------------------------------------------===
+static int
+vmtf_bump_comp(const void *a, const void *b)
+{
+	uint64_t x = ((const struct vmtf_bump *) a)->stamp;
+	uint64_t y = ((const struct vmtf_bump *) b)->stamp;
+
+	return (x > y) - (x < y);
+}
+
+static inline void
+vmtf_unlink(struct heur *heur, uint32_t var)
+{
+	struct vmtf_link *l = heur->links + var;
+
+	if (l->prev != UNDEF)
+		heur->links[l->prev].next = l->next;
+	else
+		heur->state.first = l->next;
+	if (l->next != UNDEF)
+		heur->links[l->next].prev = l->prev;
+	else
+		heur->state.last = l->prev;
+}
+
+/** Puts a variable at the end of the queue, as the most recent one. */
+static inline void
+vmtf_append(struct heur *heur, uint32_t var)
+{
+	struct vmtf_link *l = heur->links + var;
+
+	l->prev = heur->state.last;
+	l->next = UNDEF;
+	l->stamp = ++heur->state.stamp;
+	if (heur->state.last != UNDEF)
+		heur->links[heur->state.last].next = var;
+	else
+		heur->state.first = var;
+	heur->state.last = var;
+}
+
+static void
+heap_sift_up(struct heur *heur, uint32_t i)
+{
+	uint32_t var = heur->heap[i];
+	double score = heur->scores[var];
+
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+
+		if (heur->scores[heur->heap[parent]] >= score)
+			break;
+		heur->heap[i] = heur->heap[parent];
+		heur->heap_pos[heur->heap[i]] = i;
+		i = parent;
+	}
+	heur->heap[i] = var;
+	heur->heap_pos[var] = i;
+}
+
+static void
+heap_sift_down(struct heur *heur, uint32_t i)
+{
+	uint32_t var = heur->heap[i];
+	double score = heur->scores[var];
+
+	while (2 * i + 1 < heur->heap_size) {
+		uint32_t child = 2 * i + 1;
+
+		if (child + 1 < heur->heap_size
+		    && heur->scores[heur->heap[child + 1]] > heur->scores[heur->heap[child]])
+			child++;
+		if (heur->scores[heur->heap[child]] <= score)
+			break;
+		heur->heap[i] = heur->heap[child];
+		heur->heap_pos[heur->heap[i]] = i;
+		i = child;
+	}
+	heur->heap[i] = var;
+	heur->heap_pos[var] = i;
+}
+
+/** Moves a variable of the heap whose score changed from 'old_score'. */
+static inline void
+heap_update(struct heur *heur, uint32_t var, double old_score)
+{
+	if (heur->heap_pos[var] == UNDEF)
+		return;
+	if (heur->scores[var] > old_score)
+		heap_sift_up(heur, heur->heap_pos[var]);
+	else
+		heap_sift_down(heur, heur->heap_pos[var]);
+}
+
+static uint32_t
+heap_pop(struct heur *heur)
+{
+	uint32_t var = heur->heap[0];
+
+	heur->heap_pos[var] = UNDEF;
+	if (--heur->heap_size > 0) {
+		heur->heap[0] = heur->heap[heur->heap_size];
+		heap_sift_down(heur, 0);
+	}
+	return var;
+}
+
+/** Returns the i-th element (from 0) of the Luby sequence: 1 1 2 1 1 2 4... */
+static uint64_t
+luby(uint32_t i)
+{
+	uint64_t size = 1;
+	uint32_t seq = 0;
+
+	while (size < (uint64_t) i + 1) {
+		seq++;
+		size = 2 * size + 1;
+	}
+	while (size - 1 != i) {
+		size = (size - 1) >> 1;
+		seq--;
+		i = i % size;
+	}
+	return (uint64_t) 1 << seq;
+}
+
+static double
+power(double x, uint64_t n)
+{
+	double y = 1.0;
+
+	for (; n; n >>= 1, x *= x)
+		if (n & 1)
+			y *= x;
+	return y;
+}
+
+/** Moves a score towards 'reward', by the current step. */
+static inline void
+erwa_update(struct heur *heur, uint32_t var, double reward)
+{
+	double old_score = heur->scores[var];
+
+	heur->scores[var] = (1 - heur->state.step) * old_score + heur->state.step * reward;
+	heap_update(heur, var, old_score);
+}
+
+/**
+ *  The reason side of LRB: variables of the reasons of the learnt clause which
+ *  are not in it nearly took part in the conflict.
+ */
+static void
+lrb_reason_side(solver_t *s, vec_ui32_t *learnt)
+{
+	uint32_t stamp = solver_new_stamp(s);
+	uint32_t i, j;
+
+	for (i = 0; i < vec_size(learnt); i++)
+		s->stamps[2 * lit2var(vec_at(learnt, i))] = stamp;
+	for (i = 0; i < vec_size(learnt); i++) {
+		cref_t cref = lit_reason(s, vec_at(learnt, i));
+		struct clause *clause;
+
+		if (cref == CREF_UNDEF)
+			continue;
+		clause = clause_read(s, cref);
+		s->stats.n_ticks += solver_ticks(clause->size * sizeof(uint32_t));
+		for (j = 0; j < clause->size; j++) {
+			uint32_t var = lit2var(clause->lits[j]);
+
+			if (s->stamps[2 * var] == stamp)
+				continue;
+			s->stamps[2 * var] = stamp;
+			s->heur->erwa[var].reasoned++;
+		}
+	}
+}
+
+//===------------------------------------------------------------------------===
+// Heuristic external functions
+//===------------------------------------------------------------------------===
+struct heur *
+heur_alloc(uint64_t mode_ticks)
+{
+	struct heur *heur = STM_CALLOC(struct heur, 1);
+
+	heur->state.mode = HEUR_FOCUSED;
+	heur->state.mode_length = mode_ticks;
+	heur->state.mode_limit = mode_ticks;
+	heur->state.first = UNDEF;
+	heur->state.last = UNDEF;
+	heur->state.inc = 1.0;
+	heur->state.step = HEUR_STEP_INIT;
+	heur->state.restart_limit = 2;
+	heur->search = UNDEF;
+	heur->bumped = vec_ui32_alloc(0);
+	return heur;
+}
+
+void
+heur_free(struct heur *heur)
+{
+	STM_FREE(heur->links);
+	STM_FREE(heur->scores);
+	STM_FREE(heur->heap);
+	STM_FREE(heur->heap_pos);
+	STM_FREE(heur->erwa);
+	vec_free(heur->bumped);
+	STM_FREE(heur->order);
+	STM_FREE(heur);
+}
+
+/** Adds variable 'var', the last one of the solver, at the end of the queue. */
+void
+heur_add_variable(solver_t *s, uint32_t var)
+{
+	struct heur *heur = s->heur;
+
+	if (var >= heur->cap_vars) {
+		heur->cap_vars = heur->cap_vars ? 2 * heur->cap_vars : 64;
+		heur->links = STM_REALLOC(struct vmtf_link, heur->links, heur->cap_vars);
+		heur->scores = STM_REALLOC(double, heur->scores, heur->cap_vars);
+		heur->heap = STM_REALLOC(uint32_t, heur->heap, heur->cap_vars);
+		heur->heap_pos = STM_REALLOC(uint32_t, heur->heap_pos, heur->cap_vars);
+		heur->erwa = STM_REALLOC(struct erwa_var, heur->erwa, heur->cap_vars);
+	}
+	heur->n_vars = var + 1;
+	heur->scores[var] = 0;
+	heur->heap_pos[var] = UNDEF;
+	memset(heur->erwa + var, 0, sizeof(struct erwa_var));
+	vmtf_append(heur, var);
+	if (heur->state.mode == HEUR_FOCUSED)
+		heur->search = var;
+	else
+		heur_heap_insert(heur, var);
+}
+
+/** Sets the mode for the branching option of the solver. */
+void
+heur_configure(solver_t *s)
+{
+	struct heur_state *st = &s->heur->state;
+
+	if (st->n_switches == 0) {
+		st->mode_length = s->opts.mode_ticks;
+		st->mode_limit = s->opts.mode_ticks;
+	}
+	if (s->opts.branching == SATOMI_BRANCH_LRB)
+		st->mode = HEUR_LRB;
+	else if (s->opts.branching == SATOMI_BRANCH_CHB)
+		st->mode = HEUR_CHB;
+	else if (st->mode > HEUR_STABLE)
+		st->mode = HEUR_FOCUSED;
+	heur_reset(s);
+}
+
+/** Rebuilds the structure of the current mode from the assignment. */
+void
+heur_reset(solver_t *s)
+{
+	struct heur *heur = s->heur;
+
+	heur->search = heur->state.last;
+	for (uint32_t var = 0; var < heur->n_vars; var++)
+		heur->heap_pos[var] = UNDEF;
+	heur->heap_size = 0;
+	heur_backjump(heur, vec_size(s->trail));
+	if (heur->state.mode != HEUR_FOCUSED)
+		for (uint32_t var = 0; var < heur->n_vars; var++)
+			if (var_value(s, var) == VAR_UNASSING)
+				heur_heap_insert(heur, var);
+}
+
+void
+heur_heap_insert(struct heur *heur, uint32_t var)
+{
+	heur->heap[heur->heap_size] = var;
+	heur->heap_pos[var] = heur->heap_size++;
+	heap_sift_up(heur, heur->heap_pos[var]);
+}
+
+/** Returns the next decision, with its saved phase, UNDEF if all variables
+ *  are assigned. */
+uint32_t
+heur_decide(solver_t *s)
+{
+	struct heur *heur = s->heur;
+	uint32_t var = UNDEF;
+
+	if (heur->state.mode == HEUR_FOCUSED) {
+		var = heur->search;
+		while (var != UNDEF && var_value(s, var) != VAR_UNASSING)
+			var = heur->links[var].prev;
+		if (var == UNDEF) {
+			heur->search = heur->state.first;
+			return UNDEF;
+		}
+		heur->search = var;
+	} else {
+		while (heur->heap_size) {
+			var = heur->heap[0];
+			/* LRB: scores decay while variables are not assigned */
+			if (heur->state.mode == HEUR_LRB && var_value(s, var) == VAR_UNASSING
+			    && heur->erwa[var].canceled < s->stats.n_conflicts) {
+				uint64_t age = s->stats.n_conflicts - heur->erwa[var].canceled;
+
+				heur->scores[var] *= power(HEUR_LRB_DECAY, age);
+				heur->erwa[var].canceled = s->stats.n_conflicts;
+				heap_sift_down(heur, 0);
+				continue;
+			}
+			var = heap_pop(heur);
+			if (var_value(s, var) == VAR_UNASSING)
+				break;
+			var = UNDEF;
+		}
+		if (var == UNDEF)
+			return UNDEF;
+	}
+	return var2lit(var, vec_at(s->polarity, var));
+}
+
+/**
+ *  Bumps the variables of the last conflict, still assigned: in focused mode,
+ *  they move to the end of the queue in the order they had, in stable mode
+ *  their scores grow by an increment which itself grows at each conflict. LRB
+ *  and CHB only count the conflict, their scores change as variables are
+ *  unassigned or propagated.
+ */
+void
+heur_bump(solver_t *s, vec_ui32_t *learnt)
+{
+	struct heur *heur = s->heur;
+	uint32_t n = vec_size(heur->bumped);
+	uint32_t *vars = vec_data(heur->bumped);
+
+	if (heur->state.mode == HEUR_FOCUSED) {
+		struct vmtf_bump *order;
+
+		if (n > heur->cap_order) {
+			heur->cap_order = 2 * n;
+			heur->order = STM_REALLOC(struct vmtf_bump, heur->order, heur->cap_order);
+		}
+		order = heur->order;
+		for (uint32_t i = 0; i < n; i++) {
+			order[i].stamp = heur->links[vars[i]].stamp;
+			order[i].var = vars[i];
+		}
+		qsort(order, n, sizeof(struct vmtf_bump), vmtf_bump_comp);
+		for (uint32_t i = 0; i < n; i++) {
+			vmtf_unlink(heur, order[i].var);
+			vmtf_append(heur, order[i].var);
+		}
+	} else if (heur->state.mode == HEUR_STABLE) {
+		for (uint32_t i = 0; i < n; i++) {
+			uint32_t var = vars[i];
+
+			heur->scores[var] += heur->state.inc;
+			if (heur->scores[var] > HEUR_MAX_SCORE) {
+				for (uint32_t v = 0; v < heur->n_vars; v++)
+					heur->scores[v] /= HEUR_MAX_SCORE;
+				heur->state.inc /= HEUR_MAX_SCORE;
+			}
+			if (heur->heap_pos[var] != UNDEF)
+				heap_sift_up(heur, heur->heap_pos[var]);
+		}
+		heur->state.inc /= HEUR_DECAY;
+	} else {
+		if (heur->state.mode == HEUR_LRB) {
+			for (uint32_t i = 0; i < n; i++)
+				heur->erwa[vars[i]].participated++;
+			lrb_reason_side(s, learnt);
+		} else {
+			for (uint32_t i = 0; i < n; i++)
+				heur->erwa[vars[i]].conflicted = s->stats.n_conflicts;
+		}
+		if (heur->state.step > HEUR_STEP_MIN)
+			heur->state.step -= HEUR_STEP_DECAY;
+	}
+	/* A link, a score or counters per variable */
+	s->stats.n_ticks += n;
+	vec_clear(heur->bumped);
+}
+
+/**
+ *  Called after each propagation in LRB and CHB, with the assignments it made
+ *  (and the decision before them) still on the trail. LRB starts counting
+ *  the conflicts of the assigned variables, CHB rewards them, more so when
+ *  the propagation ended in a conflict and when they were in recent ones.
+ */
+void
+heur_propagated(solver_t *s, int conflict)
+{
+	struct heur *heur = s->heur;
+	uint32_t *trail = vec_data(s->trail);
+	double miss = conflict ? 1.0 : HEUR_CHB_MISS;
+
+	for (uint32_t i = heur->trail_done; i < vec_size(s->trail); i++) {
+		uint32_t var = lit2var(trail[i]);
+		struct erwa_var *e = heur->erwa + var;
+
+		if (heur->state.mode == HEUR_LRB) {
+			e->assigned = s->stats.n_conflicts;
+			e->participated = 0;
+			e->reasoned = 0;
+		} else
+			erwa_update(heur, var, miss / (s->stats.n_conflicts - e->conflicted + 1));
+	}
+	heur->trail_done = vec_size(s->trail);
+}
+
+/**
+ *  LRB: rewards an unassigned variable with the share of the conflicts since
+ *  it was assigned that it took part in, or nearly did.
+ */
+void
+heur_lrb_unassign(solver_t *s, uint32_t var)
+{
+	struct heur *heur = s->heur;
+	struct erwa_var *e = heur->erwa + var;
+	uint64_t interval = s->stats.n_conflicts - e->assigned;
+
+	if (interval > 0)
+		erwa_update(heur, var, (double) (e->participated + e->reasoned) / interval);
+	e->canceled = s->stats.n_conflicts;
+	if (heur->heap_pos[var] == UNDEF)
+		heur_heap_insert(heur, var);
+}
+
+/**
+ *  Called after each conflict with the LBD of its learnt clause. Returns true
+ *  if the search should restart: when the LBD of the last clauses goes above
+ *  its long term average in focused mode (and with LRB or CHB), when the Luby
+ *  sequence says so in stable mode, and when the mode is over.
+ */
+int
+heur_restart_due(solver_t *s, uint32_t lbd)
+{
+	struct heur_state *st = &s->heur->state;
+
+	if (st->mode != HEUR_STABLE) {
+		if (st->lbd_slow == 0)
+			st->lbd_fast = st->lbd_slow = lbd;
+		st->lbd_fast += (lbd - st->lbd_fast) / 32;
+		st->lbd_slow += (lbd - st->lbd_slow) / 4096;
+	}
+	if (s->opts.branching == SATOMI_BRANCH_MODES && s->stats.n_ticks >= st->mode_limit)
+		return 1;
+	if (s->stats.n_conflicts < st->restart_limit)
+		return 0;
+	return st->mode == HEUR_STABLE || st->lbd_fast > HEUR_RESTART_MARGIN * st->lbd_slow;
+}
+
+/** Restarts, switching modes once the current one is over. */
+void
+heur_restart(solver_t *s)
+{
+	struct heur_state *st = &s->heur->state;
+
+	solver_backjump(s, 0);
+	s->stats.n_restarts++;
+	solver_hook(s, restart, s->stats.n_conflicts);
+	if (s->opts.branching == SATOMI_BRANCH_MODES && s->stats.n_ticks >= st->mode_limit) {
+		st->mode ^= 1;
+		st->n_switches++;
+		if (st->mode == HEUR_FOCUSED)
+			st->mode_length *= 2;
+		st->mode_limit = s->stats.n_ticks + st->mode_length;
+		st->luby_index = 0;
+		heur_reset(s);
+	}
+	if (st->mode != HEUR_STABLE)
+		st->restart_limit = s->stats.n_conflicts + 2;
+	else
+		st->restart_limit = s->stats.n_conflicts + HEUR_LUBY_UNIT * luby(st->luby_index++);
+}
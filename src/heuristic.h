@@ -0,0 +1,153 @@
+//===--- heuristic.h --------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__HEURISTIC_H
+#define SATOMI__HEURISTIC_H
+
+#include <stdint.h>
+
+#include "solver.h"
+#include "utils/vec/vec.h"
+
+/* Search modes */
+enum {
+	HEUR_FOCUSED = 0, /* VMTF decisions, frequent restarts */
+	HEUR_STABLE  = 1, /* EVSIDS decisions, rare restarts */
+	HEUR_LRB     = 2, /* learning rate decisions, frequent restarts */
+	HEUR_CHB     = 3  /* conflict history decisions, frequent restarts */
+};
+
+/* Links of a variable in the VMTF queue */
+struct vmtf_link {
+	uint32_t prev;
+	uint32_t next;
+	uint64_t stamp; /* when it was last moved to the end */
+};
+
+/* Variables of a conflict, to be moved in the queue in the order they have */
+struct vmtf_bump {
+	uint64_t stamp;
+	uint32_t var;
+};
+
+/* Counters of a variable for the ERWA scores of LRB and CHB, in conflicts */
+struct erwa_var {
+	uint64_t assigned;     /* LRB: when it was last assigned */
+	uint64_t canceled;     /* LRB: when it was last unassigned */
+	uint64_t conflicted;   /* CHB: when it was last part of a conflict */
+	uint32_t participated; /* LRB: conflicts it took part in since assigned */
+	uint32_t reasoned;     /* LRB: reasons of the learnt clauses it was in */
+};
+
+/**
+ *  Scalar state of the heuristics, kept apart so that checkpoints can save it
+ *  as it is.
+ */
+struct heur_state {
+	uint32_t mode;
+	uint32_t n_switches;
+	uint64_t mode_limit;   /* in ticks, when the mode switches */
+	uint64_t mode_length;  /* in ticks, of the current mode */
+
+	/* VMTF queue, from the oldest variable to the most recently bumped */
+	uint32_t first;
+	uint32_t last;
+	uint64_t stamp;
+
+	/* EVSIDS */
+	double inc;
+
+	/* LRB and CHB: step of the exponential recency weighted average */
+	double step;
+
+	/* Restarts: moving averages of the LBD in the other modes, a Luby
+	 * sequence of conflicts in stable mode */
+	double lbd_fast;
+	double lbd_slow;
+	uint64_t restart_limit; /* in conflicts */
+	uint32_t luby_index;
+	uint32_t pad;
+};
+
+/**
+ *  Decision heuristics switching between two modes: a focused mode, where the
+ *  variables of each conflict are moved to the end of a queue and decisions
+ *  take the last unassigned one (VMTF), with restarts as soon as the LBD of the
+ *  learnt clauses goes up, and a stable mode, where the variables of each
+ *  conflict get an exponentially growing bump of their score and decisions
+ *  take the best one from a heap (EVSIDS), with restarts on a Luby sequence.
+ *
+ *  Modes alternate on a schedule in ticks, each pair of modes lasting twice as
+ *  long as the previous one. Only the structure of the current mode is kept
+ *  up to date, the other one is rebuilt when the mode switches.
+ *
+ *  LRB and CHB are single modes using the heap of EVSIDS, with scores which
+ *  are averages of rewards: LRB rewards the share of the conflicts a variable
+ *  took part in while it was assigned, when it is unassigned, CHB rewards
+ *  recent conflicts of the variables assigned by each propagation.
+ */
+struct heur {
+	struct heur_state state;
+	uint32_t n_vars;
+	uint32_t cap_vars;
+	struct vmtf_link *links;
+	uint32_t search; /* no variable after it in the queue is unassigned */
+	double *scores;
+	uint32_t *heap;
+	uint32_t *heap_pos; /* UNDEF when not in the heap */
+	uint32_t heap_size;
+	struct erwa_var *erwa;
+	uint32_t trail_done; /* trail assignments LRB and CHB have seen */
+	uint8_t restart; /* due at the next decision */
+	vec_ui32_t *bumped;
+	struct vmtf_bump *order;
+	uint32_t cap_order;
+};
+
+//===------------------------------------------------------------------------===
+extern struct heur *heur_alloc(uint64_t);
+extern void heur_free(struct heur *);
+extern void heur_add_variable(solver_t *, uint32_t);
+extern void heur_configure(solver_t *);
+extern void heur_reset(solver_t *);
+extern uint32_t heur_decide(solver_t *);
+extern void heur_bump(solver_t *, vec_ui32_t *);
+extern void heur_propagated(solver_t *, int);
+extern void heur_heap_insert(struct heur *, uint32_t);
+extern void heur_lrb_unassign(solver_t *, uint32_t);
+extern int heur_restart_due(solver_t *, uint32_t);
+extern void heur_restart(solver_t *);
+
+//===------------------------------------------------------------------------===
+// Inline heuristic functions
+//===------------------------------------------------------------------------===
+/** Keeps the cached search position and the heap right for an unassigned
+ *  variable. */
+static inline void
+heur_unassign(solver_t *s, uint32_t var)
+{
+	struct heur *heur = s->heur;
+
+	if (heur->state.mode == HEUR_FOCUSED) {
+		if (heur->links[var].stamp > heur->links[heur->search].stamp)
+			heur->search = var;
+	} else if (heur->state.mode == HEUR_LRB)
+		heur_lrb_unassign(s, var);
+	else if (heur->heap_pos[var] == UNDEF)
+		heur_heap_insert(heur, var);
+}
+
+/** Forgets the trail assignments undone by a backjump. */
+static inline void
+heur_backjump(struct heur *heur, uint32_t trail_size)
+{
+	if (heur->trail_done > trail_size)
+		heur->trail_done = trail_size;
+}
+
+#endif /* SATOMI__HEURISTIC_H */
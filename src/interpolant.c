@@ -0,0 +1,441 @@
+//===--- interpolant.c ------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+#include <string.h>
+
+#include "aiger.h"
+#include "interpolant.h"
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/vec/vec.h"
+
+//===------------------------------------------------------------------------===
+// Interpolation internal functions
+//===------------------------------------------------------------------------===
+static inline uint32_t
+itp_hash(cref_t cref)
+{
+	return (uint32_t) (((uint64_t) cref * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+static void
+itp_rehash(struct itp *itp)
+{
+	cref_t *keys = itp->keys;
+	uint32_t *ids = itp->ids;
+	uint32_t size = itp->table_mask + 1;
+
+	itp->table_mask = 2 * size - 1;
+	itp->keys = STM_ALLOC(cref_t, 2 * size);
+	itp->ids = STM_ALLOC(uint32_t, 2 * size);
+	for (uint32_t i = 0; i < 2 * size; i++)
+		itp->keys[i] = CREF_UNDEF;
+	for (uint32_t i = 0; i < size; i++) {
+		uint32_t j;
+
+		if (keys[i] == CREF_UNDEF)
+			continue;
+		j = itp_hash(keys[i]) & itp->table_mask;
+		while (itp->keys[j] != CREF_UNDEF)
+			j = (j + 1) & itp->table_mask;
+		itp->keys[j] = keys[i];
+		itp->ids[j] = ids[i];
+	}
+	STM_FREE(keys);
+	STM_FREE(ids);
+}
+
+/** Returns the id of a clause of the database, marks the proof broken if it
+ *  has none (it was added while not recording). */
+static uint32_t
+itp_id(struct itp *itp, cref_t cref)
+{
+	uint32_t i = itp_hash(cref) & itp->table_mask;
+
+	for (; itp->keys[i] != CREF_UNDEF; i = (i + 1) & itp->table_mask)
+		if (itp->keys[i] == cref)
+			return itp->ids[i];
+	itp->broken = 1;
+	return 0;
+}
+
+static void
+itp_grow(solver_t *s)
+{
+	struct itp *itp = s->itp;
+	uint32_t n_vars = itp->n_vars;
+
+	if (s->n_vars <= n_vars)
+		return;
+	itp->occurs = STM_REALLOC(uint8_t, itp->occurs, s->n_vars);
+	itp->unit_ids = STM_REALLOC(uint32_t, itp->unit_ids, s->n_vars);
+	itp->stamps = STM_REALLOC(uint32_t, itp->stamps, s->n_vars);
+	for (uint32_t var = n_vars; var < s->n_vars; var++) {
+		itp->occurs[var] = 0;
+		itp->unit_ids[var] = UNDEF;
+		itp->stamps[var] = 0;
+	}
+	itp->n_vars = s->n_vars;
+}
+
+static uint32_t
+itp_new_stamp(struct itp *itp)
+{
+	if (++itp->stamp == 0) {
+		memset(itp->stamps, 0, sizeof(uint32_t) * itp->n_vars);
+		itp->stamp = 1;
+	}
+	return itp->stamp;
+}
+
+/** Appends a proof clause, its header then 'size' words, returns its id. */
+static uint32_t
+itp_append(struct itp *itp, uint32_t kind, const uint32_t *data, uint32_t size)
+{
+	if (vec_size(itp->proof) > UINT32_MAX - 1 - size)
+		itp->broken = 1;
+	vec_push_back(itp->offsets, vec_size(itp->proof));
+	vec_push_back(itp->proof, (size << 2) | kind);
+	for (uint32_t i = 0; i < size; i++)
+		vec_push_back(itp->proof, data[i]);
+	return vec_size(itp->offsets) - 1;
+}
+
+/** Commits a chain, a single clause is not worth a new id. */
+static uint32_t
+itp_commit(struct itp *itp, vec_ui32_t *chain)
+{
+	if (vec_size(chain) == 1)
+		return vec_at(chain, 0);
+	return itp_append(itp, ITP_CHAIN, vec_data(chain), vec_size(chain));
+}
+
+/**
+ *  Returns the id of the unit clause of a variable fixed at level zero. They
+ *  are derived in the order of the trail, each one from its reason and the
+ *  units of the other literals of the reason, which come before it.
+ */
+static uint32_t
+itp_unit(solver_t *s, uint32_t var)
+{
+	struct itp *itp = s->itp;
+	uint32_t end = solver_dlevel(s) ? vec_at(s->trail_lim, 0) : vec_size(s->trail);
+
+	itp_grow(s);
+	while (itp->unit_ids[var] == UNDEF && itp->n_units < end) {
+		uint32_t lit = vec_at(s->trail, itp->n_units++);
+		cref_t reason = lit_reason(s, lit);
+		struct clause *clause;
+
+		if (itp->unit_ids[lit2var(lit)] != UNDEF || reason == CREF_UNDEF)
+			continue;
+		clause = clause_read(s, reason);
+		vec_clear(itp->unit_chain);
+		vec_push_back(itp->unit_chain, itp_id(itp, reason));
+		for (uint32_t i = 0; i < clause->size; i++) {
+			uint32_t other = lit2var(clause->lits[i]);
+
+			if (other == lit2var(lit))
+				continue;
+			if (itp->unit_ids[other] == UNDEF)
+				itp->broken = 1;
+			vec_push_back(itp->unit_chain, other);
+			vec_push_back(itp->unit_chain, itp->unit_ids[other]);
+		}
+		itp->unit_ids[lit2var(lit)] = itp_commit(itp, itp->unit_chain);
+	}
+	if (itp->unit_ids[var] == UNDEF) {
+		itp->broken = 1;
+		return 0;
+	}
+	return itp->unit_ids[var];
+}
+
+static inline uint32_t
+itp_or(struct aig *aig, uint32_t a, uint32_t b)
+{
+	return aig_and(aig, a ^ 1, b ^ 1) ^ 1;
+}
+
+//===------------------------------------------------------------------------===
+// Interpolation external functions
+//===------------------------------------------------------------------------===
+struct itp *
+itp_alloc(void)
+{
+	struct itp *itp = STM_CALLOC(struct itp, 1);
+
+	itp->proof = vec_ui32_alloc(0);
+	itp->offsets = vec_ui32_alloc(0);
+	itp->partition = ITP_LEAF_A;
+	itp->empty = UNDEF;
+	itp->added = UNDEF;
+	itp->table_mask = 1023;
+	itp->keys = STM_ALLOC(cref_t, itp->table_mask + 1);
+	itp->ids = STM_ALLOC(uint32_t, itp->table_mask + 1);
+	for (uint32_t i = 0; i <= itp->table_mask; i++)
+		itp->keys[i] = CREF_UNDEF;
+	itp->chain = vec_ui32_alloc(0);
+	itp->unit_chain = vec_ui32_alloc(0);
+	itp->level0 = vec_ui32_alloc(0);
+	return itp;
+}
+
+void
+itp_free(struct itp *itp)
+{
+	vec_free(itp->proof);
+	vec_free(itp->offsets);
+	STM_FREE(itp->keys);
+	STM_FREE(itp->ids);
+	STM_FREE(itp->occurs);
+	STM_FREE(itp->unit_ids);
+	STM_FREE(itp->stamps);
+	vec_free(itp->chain);
+	vec_free(itp->unit_chain);
+	vec_free(itp->level0);
+	STM_FREE(itp);
+}
+
+/**
+ *  Records an original clause of the current partition, before the solver drops
+ *  its literals false at level zero: the clause it adds is the original one
+ *  resolved with their units. Adding no literal at all, it refutes the formula.
+ */
+void
+itp_add_original(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	struct itp *itp = s->itp;
+	uint32_t n_free = 0;
+	uint32_t stamp;
+
+	itp_grow(s);
+	for (uint32_t i = 0; i < size; i++) {
+		itp->occurs[lit2var(lits[i])] |= itp->partition == ITP_LEAF_A ? ITP_IN_A : ITP_IN_B;
+		if (lit_value(s, lits[i]) == LIT_TRUE)
+			return;
+	}
+	vec_clear(itp->chain);
+	if (itp->partition == ITP_LEAF_A)
+		vec_push_back(itp->chain, itp_append(itp, ITP_LEAF_A, lits, size));
+	else
+		vec_push_back(itp->chain, itp_append(itp, ITP_LEAF_B, NULL, 0));
+	stamp = itp_new_stamp(itp);
+	for (uint32_t i = 0; i < size; i++) {
+		uint32_t var = lit2var(lits[i]);
+
+		if (lit_value(s, lits[i]) != LIT_FALSE)
+			n_free++;
+		if (lit_value(s, lits[i]) != LIT_FALSE || itp->stamps[var] == stamp)
+			continue;
+		itp->stamps[var] = stamp;
+		vec_push_back(itp->chain, var);
+		vec_push_back(itp->chain, itp_unit(s, var));
+	}
+	itp->added = itp_commit(itp, itp->chain);
+	if (n_free == 0 && itp->empty == UNDEF)
+		itp->empty = itp->added;
+}
+
+/** Binds the clause last added or learnt to its reference in the database,
+ *  or to its literal when it is a unit, enqueued at level zero. */
+void
+itp_bind(solver_t *s, cref_t cref, uint32_t lit)
+{
+	struct itp *itp = s->itp;
+	uint32_t i;
+
+	if (cref == CREF_UNDEF) {
+		itp_grow(s);
+		itp->unit_ids[lit2var(lit)] = itp->added;
+		return;
+	}
+	i = itp_hash(cref) & itp->table_mask;
+	while (itp->keys[i] != CREF_UNDEF && itp->keys[i] != cref)
+		i = (i + 1) & itp->table_mask;
+	if (itp->keys[i] == CREF_UNDEF)
+		itp->n_keys++;
+	itp->keys[i] = cref;
+	itp->ids[i] = itp->added;
+	if (2 * itp->n_keys > itp->table_mask)
+		itp_rehash(itp);
+}
+
+/** Starts the chain of a learnt clause with the conflicting clause. */
+void
+itp_analyze_start(solver_t *s, cref_t cref)
+{
+	struct itp *itp = s->itp;
+
+	itp_grow(s);
+	itp_new_stamp(itp);
+	vec_clear(itp->chain);
+	vec_clear(itp->level0);
+	vec_push_back(itp->chain, itp_id(itp, cref));
+}
+
+/** Resolves on 'var' with its reason. */
+void
+itp_analyze_step(solver_t *s, uint32_t var, cref_t cref)
+{
+	struct itp *itp = s->itp;
+
+	vec_push_back(itp->chain, var);
+	vec_push_back(itp->chain, itp_id(itp, cref));
+}
+
+/** Notes a literal fixed at level zero, left out of the learnt clause. */
+void
+itp_analyze_level0(solver_t *s, uint32_t var)
+{
+	struct itp *itp = s->itp;
+
+	if (itp->stamps[var] == itp->stamp)
+		return;
+	itp->stamps[var] = itp->stamp;
+	vec_push_back(itp->level0, var);
+}
+
+/** Ends the chain with the units of the literals fixed at level zero. */
+void
+itp_analyze_end(solver_t *s)
+{
+	struct itp *itp = s->itp;
+
+	for (uint32_t i = 0; i < vec_size(itp->level0); i++) {
+		uint32_t var = vec_at(itp->level0, i);
+
+		vec_push_back(itp->chain, var);
+		vec_push_back(itp->chain, itp_unit(s, var));
+	}
+	itp->added = itp_commit(itp, itp->chain);
+}
+
+/** Derives the empty clause from a clause falsified at level zero. */
+void
+itp_final(solver_t *s, cref_t cref)
+{
+	struct itp *itp = s->itp;
+	struct clause *clause = clause_read(s, cref);
+
+	if (itp->empty != UNDEF)
+		return;
+	vec_clear(itp->chain);
+	vec_push_back(itp->chain, itp_id(itp, cref));
+	for (uint32_t i = 0; i < clause->size; i++) {
+		vec_push_back(itp->chain, lit2var(clause->lits[i]));
+		vec_push_back(itp->chain, itp_unit(s, lit2var(clause->lits[i])));
+	}
+	itp->empty = itp_commit(itp, itp->chain);
+}
+
+/**
+ *  The clauses added from now on belong to A when 'partition' is 0, to B
+ *  otherwise. Needs interpolation to be enabled, clauses start in A.
+ */
+int
+satomi_set_partition(satomi_t *s, int partition)
+{
+	if (s->itp == NULL)
+		return SATOMI_ERR;
+	s->itp->partition = partition ? ITP_LEAF_B : ITP_LEAF_A;
+	return SATOMI_OK;
+}
+
+/**
+ *  Writes in AIGER (binary if the name ends in '.aig') an interpolant of the
+ *  last refutation: a formula I over the variables of both A and B, such that
+ *  A implies I and I and B can't hold together. Input i of the AIG is named
+ *  after its DIMACS variable.
+ *
+ *  This is McMillan's interpolant, built on the proof clauses the refutation
+ *  depends on, in the order they were made: a clause of A gives the disjunction
+ *  of its literals on shared variables, a clause of B gives true, and each
+ *  resolution step of a chain gives the disjunction of the interpolants of its
+ *  clauses if the pivot only occurs in A, their conjunction otherwise. The AIG
+ *  is hashed as it is built, so shared subformulas are built once.
+ *
+ *  Returns SATOMI_ERR if there is no complete refutation to interpolate: the
+ *  formula was not found unsatisfiable, or only under assumptions, or clauses
+ *  were added while not recording (such as imported ones).
+ */
+int
+satomi_write_interpolant(satomi_t *s, const char *fname)
+{
+	struct itp *itp = s->itp;
+	struct aig *aig;
+	uint8_t *mark;
+	uint32_t *inputs, *names, *lits;
+	uint32_t n_inputs = 0;
+	int ret;
+
+	if (itp == NULL || itp->empty == UNDEF || itp->broken) {
+		fprintf(stdout, "[satomi] There is no refutation to interpolate.\n");
+		return SATOMI_ERR;
+	}
+	itp_grow(s);
+	inputs = STM_ALLOC(uint32_t, itp->n_vars);
+	names = STM_ALLOC(uint32_t, itp->n_vars + 1);
+	for (uint32_t var = 0; var < itp->n_vars; var++)
+		if (itp->occurs[var] == (ITP_IN_A | ITP_IN_B)) {
+			names[n_inputs] = var + 1;
+			inputs[var] = n_inputs++;
+		}
+	aig = aig_alloc(n_inputs, 0);
+
+	/* Chains only refer to clauses made before them */
+	mark = STM_CALLOC(uint8_t, itp->empty + 1);
+	lits = STM_ALLOC(uint32_t, itp->empty + 1);
+	mark[itp->empty] = 1;
+	for (uint32_t id = itp->empty + 1; id-- > 0; ) {
+		const uint32_t *data = vec_data(itp->proof) + vec_at(itp->offsets, id);
+		uint32_t size = data[0] >> 2;
+
+		if (!mark[id] || (data[0] & 3) != ITP_CHAIN)
+			continue;
+		mark[data[1]] = 1;
+		for (uint32_t i = 2; i <= size; i += 2)
+			mark[data[i + 1]] = 1;
+	}
+	for (uint32_t id = 0; id <= itp->empty; id++) {
+		const uint32_t *data = vec_data(itp->proof) + vec_at(itp->offsets, id);
+		uint32_t size = data[0] >> 2;
+
+		if (!mark[id])
+			continue;
+		if ((data[0] & 3) == ITP_LEAF_B) {
+			lits[id] = 1;
+		} else if ((data[0] & 3) == ITP_LEAF_A) {
+			lits[id] = 0;
+			for (uint32_t i = 1; i <= size; i++) {
+				uint32_t var = lit2var(data[i]);
+
+				if (itp->occurs[var] == (ITP_IN_A | ITP_IN_B))
+					lits[id] = itp_or(aig, lits[id], 2 * (1 + inputs[var])
+					                  + lit_polarity(data[i]));
+			}
+		} else {
+			lits[id] = lits[data[1]];
+			for (uint32_t i = 2; i <= size; i += 2)
+				if (itp->occurs[data[i]] == ITP_IN_A)
+					lits[id] = itp_or(aig, lits[id], lits[data[i + 1]]);
+				else
+					lits[id] = aig_and(aig, lits[id], lits[data[i + 1]]);
+		}
+	}
+	vec_push_back(aig->outputs, lits[itp->empty]);
+	ret = aig_write(aig, fname, names);
+	aig_free(aig);
+	STM_FREE(mark);
+	STM_FREE(lits);
+	STM_FREE(inputs);
+	STM_FREE(names);
+	return ret;
+}
@@ -0,0 +1,80 @@
+//===--- interpolant.h ------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__INTERPOLANT_H
+#define SATOMI__INTERPOLANT_H
+
+#include <stdint.h>
+
+#include "cdb.h"
+#include "solver.h"
+#include "utils/vec/vec.h"
+
+/* Kinds of proof clauses, in the low bits of their header */
+enum {
+	ITP_LEAF_A = 0,
+	ITP_LEAF_B = 1,
+	ITP_CHAIN  = 2
+};
+
+/* Where each variable occurs */
+enum {
+	ITP_IN_A = 1,
+	ITP_IN_B = 2
+};
+
+/**
+ *  Resolution proof of the search, recorded for interpolation. Every clause of
+ *  the proof has an id, in the order they are made, and an entry in 'proof':
+ *  a header (size << 2 | kind) followed by the literals of an original clause
+ *  of A (nothing for one of B), or by the resolution chain of a derived clause:
+ *  the id of its first clause, then a (pivot variable, id) pair per step.
+ *
+ *  Clauses of the database are found by their reference, and the literals
+ *  fixed at level zero by the id of their unit clause, made when needed.
+ */
+struct itp {
+	vec_ui32_t *proof;
+	vec_ui32_t *offsets; /* per id, where it starts in 'proof' */
+	uint8_t partition;   /* of the original clauses being added */
+	uint8_t broken;      /* a clause without proof was used */
+	uint32_t empty;      /* id of the empty clause, UNDEF until found */
+	uint32_t added;      /* id of the last clause added or learnt */
+
+	/* Hash table from clause references to ids */
+	cref_t *keys;
+	uint32_t *ids;
+	uint32_t table_mask;
+	uint32_t n_keys;
+
+	/* Per variable */
+	uint8_t *occurs;
+	uint32_t *unit_ids;
+	uint32_t *stamps;
+	uint32_t n_vars;
+	uint32_t stamp;
+	uint32_t n_units;    /* level zero literals with a unit id */
+
+	/* Chains being made */
+	vec_ui32_t *chain;
+	vec_ui32_t *unit_chain;
+	vec_ui32_t *level0;
+};
+
+//===------------------------------------------------------------------------===
+extern struct itp *itp_alloc(void);
+extern void itp_free(struct itp *);
+extern void itp_add_original(solver_t *, const uint32_t *, uint32_t);
+extern void itp_bind(solver_t *, cref_t, uint32_t);
+extern void itp_analyze_start(solver_t *, cref_t);
+extern void itp_analyze_step(solver_t *, uint32_t, cref_t);
+extern void itp_analyze_level0(solver_t *, uint32_t);
+extern void itp_analyze_end(solver_t *);
+extern void itp_final(solver_t *, cref_t);
+
+#endif /* SATOMI__INTERPOLANT_H */
@@ -6,6 +6,8 @@
 // See LICENSE for details.
 //
 //===------------------------------------------------------------------------===
+#include <getopt.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,8 +16,6 @@
 
 #include "satomi.h"
 
-static satomi_t *solver;
-
 static void satomi_usage(int status) __attribute__((noreturn));
 static void exit_SIGINT(int sig_num) __attribute__((noreturn));
 
@@ -25,13 +25,295 @@ satomi_usage(int status)
 	if (status == EXIT_FAILURE)
 		fprintf(stdout, "Try 'satomi -h' for more information\n");
 	else
-		fprintf(stdout, "Usage: satomi [-v] [-h] <input_file>\n\n" \
+		fprintf(stdout, "Usage: satomi [-v] [-h] [-w] [--check[=sync]] " \
+		        "[--checkpoint=<file>] [--checkpoint-every=<n>]\n" \
+		        "              [--branching=<modes|static|lrb|chb>] " \
+		        "[--mode-ticks=<n>]\n" \
+		        "              [--tick-limit=<n>]\n" \
+		        "              [--trace=<file>] [--trace-every=<n>] " \
+		        "[--trace-range=<first>:<last>]\n" \
+		        "              [--event-log=<file>] [--share=<name>:<peer>]\n" \
+		        "              [--all[=<file>] | --backbone] [--project=<vars>]\n" \
+		        "              [--core[=<file>] | --mus[=<file>]] " \
+		        "[--outputs=<list>]\n" \
+		        "              [--bmc[=<depth>] [--budget=<seconds>]] <input_file>\n" \
+		        "       satomi [options] --restore=<file>\n" \
+		        "       satomi [options] --interpolant=<file> <a.cnf> <b.cnf>\n" \
+		        "       satomi convert <input.cnf> <output.bcnf>\n" \
+		        "       satomi replay <event_log>\n\n" \
+		        "Input files are DIMACS (.cnf), binary CNF (.bcnf), weighted " \
+		        "DIMACS (.wcnf),\nwhose least cost models are looked for, or " \
+		        "AIGER (.aag, .aig), asking whether an\noutput can be true.\n\n" \
 		        "Options:\n"                                   \
 		        "\t-h"     "\t : display available options.\n" \
-		        "\t-v"     "\t : version.\n\n");
+		        "\t-v"     "\t : version.\n"                   \
+		        "\t-w"     "\t : same as --trace=confls.dot.\n"  \
+		        "\t--check[=sync]" "\n\t\t : verify the answer: models "   \
+		        "against the original clauses, UNSAT by\n\t\t   RUP "   \
+		        "checking the learnt clauses on a second thread (or\n" \
+		        "\t\t   after the search with 'sync').\n"          \
+		        "\t--branching=<modes|static|lrb|chb>" "\n\t\t : decisions and " \
+		        "restarts alternating between a focused and\n\t\t   a " \
+		        "stable mode (default), variables in order, or\n\t\t   " \
+		        "learning rate or conflict history scores.\n"      \
+		        "\t--mode-ticks=<n>" "\n\t\t : length of the first mode " \
+		        "in ticks (default: 1048576).\n"                   \
+		        "\t--tick-limit=<n>" "\n\t\t : give up once the search " \
+		        "touched <n> cache lines (ticks),\n\t\t   the same " \
+		        "on any machine.\n"                                \
+		        "\t--checkpoint=<file>" "\n\t\t : periodically save the " \
+		        "solver state to <file>.\n"                          \
+		        "\t--checkpoint-every=<n>" "\n\t\t : conflicts between " \
+		        "checkpoints (default: 100000).\n"                   \
+		        "\t--restore=<file>" "\n\t\t : resume the search from a " \
+		        "checkpoint.\n"                                     \
+		        "\t--trace=<file>" "\n\t\t : append the implication graphs " \
+		        "of conflicts to <file>, in DOT.\n"                 \
+		        "\t--trace-every=<n>" "\n\t\t : trace one conflict out of " \
+		        "<n> (default: 1).\n"                               \
+		        "\t--trace-range=<first>:<last>" "\n\t\t : trace conflicts " \
+		        "numbered from <first> to <last>.\n"               \
+		        "\t--event-log=<file>" "\n\t\t : log the search events "  \
+		        "to <file>, 'satomi replay' prints them.\n"        \
+		        "\t--share=<name>:<peer>" "\n\t\t : share learnt clauses " \
+		        "with the local processes solving the\n\t\t   same "    \
+		        "formula with the same <name>, <peer> is 0 to 7.\n" \
+		        "\t--all[=<file>]" "\n\t\t : enumerate every model, "    \
+		        "written to <file> (default: stdout)\n\t\t   as 'v <lits> 0' " \
+		        "lines.\n"                                         \
+		        "\t--backbone" "\n\t\t : print the literals true in every " \
+		        "model, as a 'b <lits> 0' line.\n" \
+		        "\t--project=<vars>" "\n\t\t : with --all, project the " \
+		        "models onto variables such as '1,4-7',\n\t\t   with " \
+		        "--backbone, only look for these variables.\n" \
+		        "\t--core[=<file>]" "\n\t\t : write the clauses of an UNSAT " \
+		        "core to <file> (default:\n\t\t   stdout), in DIMACS.\n" \
+		        "\t--mus[=<file>]" "\n\t\t : same as --core, with a minimal " \
+		        "unsatisfiable subset.\n" \
+		        "\t--outputs=<list>" "\n\t\t : with AIGER input, only the " \
+		        "outputs such as '1,4-7' (default: all).\n" \
+		        "\t--bmc[=<depth>]" "\n\t\t : with AIGER input, look for a " \
+		        "bad state reachable within\n\t\t   <depth> steps " \
+		        "(default: no bound).\n" \
+		        "\t--budget=<seconds>" "\n\t\t : with --bmc, start no new " \
+		        "depth past this time.\n" \
+		        "\t--interpolant=<file>" "\n\t\t : when the clauses of <a.cnf> " \
+		        "and <b.cnf> can't hold together,\n\t\t   write an " \
+		        "interpolant to <file>, in AIGER.\n\n");
 	exit(status);
 }
 
+/** Converts a DIMACS file to binary CNF. */
+static int
+satomi_convert(char *input, char *output)
+{
+	satomi_t *solver;
+	int ret;
+
+	ret = satomi_parse_dimacs(input, NULL, &solver);
+	if (solver == NULL)
+		return 1;
+	ret = satomi_write_bcnf(solver, output, ret != SATOMI_OK);
+	if (ret == SATOMI_OK)
+		fprintf(stdout, "[satomi] Converted %s to %s\n", input, output);
+	satomi_destroy(solver);
+	return ret == SATOMI_OK ? 0 : 1;
+}
+
+/* Prints the events of a log, one per line */
+static void
+replay_decision(void *data, uint32_t lit, uint32_t level)
+{
+	fprintf(data, "d %s%u %u\n", (lit & 1) ? "-" : "", (lit >> 1) + 1, level);
+}
+
+static void
+replay_conflict(void *data, uint64_t n_conflicts, uint32_t level)
+{
+	fprintf(data, "c %" PRIu64 " %u\n", n_conflicts, level);
+}
+
+static void
+replay_learnt(void *data, const uint32_t *lits, uint32_t size, uint32_t lbd)
+{
+	fprintf(data, "l %u %u", size, lbd);
+	for (uint32_t i = 0; i < size; i++)
+		fprintf(data, " %s%u", (lits[i] & 1) ? "-" : "", (lits[i] >> 1) + 1);
+	fprintf(data, "\n");
+}
+
+static void
+replay_backjump(void *data, uint32_t from_level, uint32_t to_level)
+{
+	fprintf(data, "b %u %u\n", from_level, to_level);
+}
+
+static void
+replay_restart(void *data, uint64_t n_conflicts)
+{
+	fprintf(data, "r %" PRIu64 "\n", n_conflicts);
+}
+
+static void
+replay_reduce(void *data, uint64_t n_kept, uint64_t n_removed)
+{
+	fprintf(data, "x %" PRIu64 " %" PRIu64 "\n", n_kept, n_removed);
+}
+
+static int
+satomi_print_events(char *fname)
+{
+	struct satomi_hooks hooks = {
+		stdout, replay_decision, replay_conflict, replay_learnt,
+		replay_backjump, replay_restart, replay_reduce
+	};
+
+	return satomi_replay(fname, &hooks) == SATOMI_OK ? 0 : 1;
+}
+
+/* Models found by the enumeration, written as DIMACS literals */
+struct model_output {
+	FILE *file;
+	uint64_t n_models;
+};
+
+static int
+write_model(void *data, const uint32_t *lits, uint32_t size)
+{
+	struct model_output *out = data;
+
+	fputc('v', out->file);
+	for (uint32_t i = 0; i < size; i++)
+		fprintf(out->file, " %s%u", (lits[i] & 1) ? "-" : "", (lits[i] >> 1) + 1);
+	fputs(" 0\n", out->file);
+	out->n_models++;
+	return 1;
+}
+
+static void
+write_backbone(void *data, const uint32_t *lits, uint32_t size)
+{
+	(void) data;
+	fputc('b', stdout);
+	for (uint32_t i = 0; i < size; i++)
+		fprintf(stdout, " %s%u", (lits[i] & 1) ? "-" : "", (lits[i] >> 1) + 1);
+	fputs(" 0\n", stdout);
+	fprintf(stdout, "backbone     : %u literals\n", size);
+}
+
+/* Best model of a MaxSAT search, its cost is printed as soon as it is found */
+struct maxsat_output {
+	uint32_t *lits;
+	uint32_t size;
+};
+
+static void
+write_cost(void *data, uint64_t cost, const uint32_t *lits, uint32_t size)
+{
+	struct maxsat_output *out = data;
+
+	out->lits = realloc(out->lits, (size ? size : 1) * sizeof(uint32_t));
+	memcpy(out->lits, lits, size * sizeof(uint32_t));
+	out->size = size;
+	fprintf(stdout, "o %llu\n", (unsigned long long) cost);
+	fflush(stdout);
+}
+
+/* Bounded model checking, the answer of each depth as soon as it is known */
+static void
+write_depth(void *data, uint32_t depth, int status, double seconds)
+{
+	uint32_t *last_depth = data;
+
+	fprintf(stdout, "bmc depth %-4u: %-9s  (%g s)\n", depth,
+	        status == SATOMI_SAT ? "reached" :
+	        status == SATOMI_UNSAT ? "safe" : "undecided", seconds);
+	fflush(stdout);
+	*last_depth = depth;
+}
+
+static void
+write_witness(void *data, const char *line)
+{
+	(void) data;
+	fprintf(stdout, "%s\n", line);
+}
+
+/* Clauses of a core, written in DIMACS */
+struct core_output {
+	FILE *file;
+	satomi_t *solver;
+	uint32_t n_clauses;
+};
+
+static void
+write_core(void *data, const uint32_t *ids, uint32_t n)
+{
+	struct core_output *out = data;
+	const uint32_t *lits;
+	uint32_t n_vars = 0;
+
+	for (uint32_t i = 0; i < n; i++)
+		for (uint32_t j = satomi_core_clause(out->solver, ids[i], &lits); j-- > 0; )
+			if ((lits[j] >> 1) + 1 > n_vars)
+				n_vars = (lits[j] >> 1) + 1;
+	fprintf(out->file, "p cnf %u %u\n", n_vars, n);
+	for (uint32_t i = 0; i < n; i++) {
+		uint32_t size = satomi_core_clause(out->solver, ids[i], &lits);
+
+		for (uint32_t j = 0; j < size; j++)
+			fprintf(out->file, "%s%u ", (lits[j] & 1) ? "-" : "", (lits[j] >> 1) + 1);
+		fputs("0\n", out->file);
+	}
+	out->n_clauses = n;
+}
+
+/** Reads a list of variables, such as '1,4-7', returns false if malformed. */
+static int
+read_projection(char *list, uint32_t **vars, uint32_t *n_vars)
+{
+	uint32_t cap = 0;
+	char *end;
+
+	*n_vars = 0;
+	while (*list) {
+		unsigned long first = strtoul(list, &end, 10), last = first;
+
+		if (end == list || first == 0)
+			return 0;
+		if (*end == '-') {
+			list = end + 1;
+			last = strtoul(list, &end, 10);
+			if (end == list || last < first)
+				return 0;
+		}
+		for (unsigned long var = first; var <= last; var++) {
+			if (*n_vars == cap) {
+				cap = cap ? 2 * cap : 64;
+				*vars = realloc(*vars, cap * sizeof(uint32_t));
+			}
+			(*vars)[(*n_vars)++] = (uint32_t) var - 1;
+		}
+		if (*end == ',')
+			end++;
+		else if (*end != '\0')
+			return 0;
+		list = end;
+	}
+	return 1;
+}
+
+/* Closed at exit, so that the shared memory name is always removed */
+static satomi_share_t *share = NULL;
+
+static void
+share_cleanup(void)
+{
+	if (share)
+		satomi_share_close(share);
+	share = NULL;
+}
+
 static void
 exit_SIGINT(int sig_num)
 {
@@ -45,21 +327,176 @@ int
 main(int argc, char **argv)
 {
 	int status;
+	int ret;
+	satomi_t *solver;
 	char *fname;
 	char *dot;
+	char *restore = NULL;
+	char *share_name = NULL;
+	char *colon;
+	char *all = NULL;
+	int backbone = 0;
+	char *core = NULL;
+	int mus = 0;
+	struct core_output core_out = { NULL, NULL, 0 };
+	uint32_t *proj = NULL;
+	uint32_t n_proj = 0;
+	uint32_t *outputs = NULL;
+	uint32_t n_outputs = 0;
+	uint32_t last_depth = 0;
+	struct satomi_bmc bmc = { UINT32_MAX, 0, &last_depth, write_depth, write_witness };
+	int bmc_mode = 0;
+	struct model_output models = { NULL, 0 };
+	struct maxsat_output best = { NULL, 0 };
+	int maxsat = 0;
+	char *interpolant = NULL;
 	satomi_opts_t options;
 	/* Opts parsing */
 	int opt;
 	extern int optind;
 	extern int optopt;
 	extern char* optarg;
+	static struct option long_opts[] = {
+		{ "check", optional_argument, NULL, 'c' },
+		{ "branching", required_argument, NULL, 'x' },
+		{ "mode-ticks", required_argument, NULL, 'y' },
+		{ "tick-limit", required_argument, NULL, 'z' },
+		{ "checkpoint", required_argument, NULL, 'k' },
+		{ "checkpoint-every", required_argument, NULL, 'e' },
+		{ "restore", required_argument, NULL, 'r' },
+		{ "trace", required_argument, NULL, 't' },
+		{ "trace-every", required_argument, NULL, 'n' },
+		{ "trace-range", required_argument, NULL, 'g' },
+		{ "event-log", required_argument, NULL, 'l' },
+		{ "share", required_argument, NULL, 's' },
+		{ "all", optional_argument, NULL, 'a' },
+		{ "project", required_argument, NULL, 'p' },
+		{ "backbone", no_argument, NULL, 'b' },
+		{ "core", optional_argument, NULL, 'u' },
+		{ "mus", optional_argument, NULL, 'm' },
+		{ "outputs", required_argument, NULL, 'o' },
+		{ "bmc", optional_argument, NULL, 'd' },
+		{ "budget", required_argument, NULL, 'q' },
+		{ "interpolant", required_argument, NULL, 'i' },
+		{ NULL, 0, NULL, 0 }
+	};
 
 	signal(SIGINT, exit_SIGINT);
 	satomi_default_opts(&options);
-	while ((opt = getopt(argc, argv, "wvh")) != -1) {
+	while ((opt = getopt_long(argc, argv, "wvh", long_opts, NULL)) != -1) {
 		switch (opt) {
+		case 'c':
+			if (optarg == NULL || !strcmp(optarg, "thread"))
+				options.check = SATOMI_CHECK_THREAD;
+			else if (!strcmp(optarg, "sync"))
+				options.check = SATOMI_CHECK_SYNC;
+			else
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'x':
+			if (!strcmp(optarg, "modes"))
+				options.branching = SATOMI_BRANCH_MODES;
+			else if (!strcmp(optarg, "static"))
+				options.branching = SATOMI_BRANCH_STATIC;
+			else if (!strcmp(optarg, "lrb"))
+				options.branching = SATOMI_BRANCH_LRB;
+			else if (!strcmp(optarg, "chb"))
+				options.branching = SATOMI_BRANCH_CHB;
+			else
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'y':
+			options.mode_ticks = strtoull(optarg, NULL, 10);
+			if (options.mode_ticks == 0)
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'z':
+			options.tick_limit = strtoull(optarg, NULL, 10);
+			break;
+
+		case 'k':
+			options.checkpoint = optarg;
+			break;
+
+		case 'e':
+			options.checkpoint_interval = strtoull(optarg, NULL, 10);
+			if (options.checkpoint_interval == 0)
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'r':
+			restore = optarg;
+			break;
+
+		case 't':
+			options.trace = optarg;
+			break;
+
+		case 'n':
+			options.trace_every = strtoull(optarg, NULL, 10);
+			if (options.trace_every == 0)
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'g':
+			if (sscanf(optarg, "%" SCNu64 ":%" SCNu64, &options.trace_first,
+			           &options.trace_last) != 2
+			    || options.trace_first > options.trace_last)
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'l':
+			options.event_log = optarg;
+			break;
+
+		case 's':
+			share_name = optarg;
+			break;
+
+		case 'a':
+			all = optarg ? optarg : "-";
+			break;
+
+		case 'b':
+			backbone = 1;
+			break;
+
+		case 'u':
+		case 'm':
+			core = optarg ? optarg : "-";
+			mus = (opt == 'm');
+			options.core = 1;
+			break;
+
+		case 'p':
+			if (!read_projection(optarg, &proj, &n_proj))
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'o':
+			if (!read_projection(optarg, &outputs, &n_outputs))
+				satomi_usage(EXIT_FAILURE);
+			break;
+
+		case 'd':
+			bmc_mode = 1;
+			if (optarg)
+				bmc.max_depth = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'q':
+			bmc.budget = strtod(optarg, NULL);
+			break;
+
+		case 'i':
+			interpolant = optarg;
+			break;
+
 		case 'w':
-			options.verbose = 2;
+			options.trace = "confls.dot";
 			break;
 
 		case 'v':
@@ -73,31 +510,153 @@ main(int argc, char **argv)
 			break;
 		}
 	}
-	if (optind == argc)
+	if (optind == argc && restore == NULL)
 		satomi_usage(EXIT_FAILURE);
 
+	/* Events are printed alone, to be piped to other tools */
+	if (restore == NULL && !strcmp(argv[optind], "replay")) {
+		if (argc - optind != 2)
+			satomi_usage(EXIT_FAILURE);
+		return satomi_print_events(argv[optind + 1]);
+	}
+
 	fprintf(stdout, "[satomi] Version: 2.0\n");
+	if (share_name) {
+		if ((colon = strrchr(share_name, ':')) == NULL)
+			satomi_usage(EXIT_FAILURE);
+		*colon = '\0';
+		share = satomi_share_open(share_name, strtoul(colon + 1, NULL, 10));
+		if (share == NULL)
+			return 1;
+		atexit(share_cleanup);
+		satomi_share_attach(share, &options);
+	}
+	if (restore) {
+		solver = satomi_restore(restore);
+		if (solver == NULL)
+			return 1;
+		options.check = SATOMI_CHECK_NONE;
+		satomi_configure(solver, &options);
+		status = satomi_solve(solver);
+		goto report;
+	}
+
+	if (!strcmp(argv[optind], "convert")) {
+		if (argc - optind != 3)
+			satomi_usage(EXIT_FAILURE);
+		return satomi_convert(argv[optind + 1], argv[optind + 2]);
+	}
+
+	if (interpolant) {
+		if (argc - optind != 2)
+			satomi_usage(EXIT_FAILURE);
+		ret = satomi_parse_partition(argv[optind], argv[optind + 1], &options, &solver);
+		if (solver == NULL)
+			return 1;
+		if (ret == SATOMI_OK)
+			status = satomi_solve(solver);
+		else if (options.check && satomi_check(solver, SATOMI_UNSAT) != SATOMI_OK) {
+			fprintf(stdout, "[satomi] The answer failed the check!\n");
+			status = SATOMI_UNDEC;
+		} else
+			status = SATOMI_UNSAT;
+		if (status == SATOMI_UNSAT && satomi_write_interpolant(solver, interpolant))
+			fprintf(stdout, "interpolant  : %s\n", interpolant);
+		goto report;
+	}
 
 	fname = strdup(argv[optind]);
 	if ((dot = strrchr(fname, '.')) == NULL) {
 		fprintf(stderr, "[satomi] Unrecognized file format.\n");
 		return 1;
 	}
-	if (strcmp(dot, ".cnf")) {
+	if (strcmp(dot, ".cnf") && strcmp(dot, ".bcnf") && strcmp(dot, ".wcnf")
+	    && strcmp(dot, ".aag") && strcmp(dot, ".aig")) {
 		fprintf(stderr, "[satomi] Unsupported file format: %s\n", dot);
 		return 1;
 	}
 
-	satomi_parse_dimacs(fname, &solver);
-	satomi_configure(solver, &options);
-	status = satomi_solve(solver);
+	if (bmc_mode && strcmp(dot, ".aag") && strcmp(dot, ".aig")) {
+		fprintf(stderr, "[satomi] BMC needs an AIGER file.\n");
+		return 1;
+	}
+	if (bmc_mode) {
+		status = satomi_bmc(fname, &options, &bmc, &solver);
+		if (solver == NULL)
+			return 1;
+		fprintf(stdout, "bmc          : depth %u\n", last_depth);
+		goto report;
+	}
+
+	if (!strcmp(dot, ".bcnf"))
+		ret = satomi_parse_bcnf(fname, &options, &solver);
+	else if ((maxsat = !strcmp(dot, ".wcnf")))
+		ret = satomi_parse_wcnf(fname, &options, &solver);
+	else if (!strcmp(dot, ".aag") || !strcmp(dot, ".aig"))
+		ret = satomi_parse_aiger(fname, &options, outputs, n_outputs, &solver);
+	else
+		ret = satomi_parse_dimacs(fname, &options, &solver);
+	if (all) {
+		models.file = strcmp(all, "-") ? fopen(all, "w") : stdout;
+		if (models.file == NULL) {
+			fprintf(stdout, "Couldn't open file: %s\n", all);
+			return 1;
+		}
+		setvbuf(models.file, NULL, _IOFBF, 1 << 20);
+	}
+	if (ret == SATOMI_OK && all) {
+		status = satomi_enumerate(solver, proj, n_proj, write_model, &models);
+		if (status == SATOMI_UNSAT && models.n_models)
+			status = SATOMI_SAT;
+	} else if (ret == SATOMI_OK && core) {
+		core_out.file = strcmp(core, "-") ? fopen(core, "w") : stdout;
+		if (core_out.file == NULL) {
+			fprintf(stdout, "Couldn't open file: %s\n", core);
+			return 1;
+		}
+		core_out.solver = solver;
+		if (mus)
+			status = satomi_mus(solver, write_core, &core_out);
+		else
+			status = satomi_core(solver, write_core, &core_out);
+		if (status == SATOMI_UNSAT)
+			fprintf(stdout, "%s         : %u clauses\n", mus ? "mus " : "core",
+			        core_out.n_clauses);
+	} else if (ret == SATOMI_OK && maxsat) {
+		status = satomi_maxsat(solver, write_cost, &best);
+		if (best.lits) {
+			models.file = stdout;
+			write_model(&models, best.lits, best.size);
+			models.file = NULL;
+			free(best.lits);
+		}
+	} else if (ret == SATOMI_OK && backbone)
+		status = satomi_backbone(solver, proj, n_proj, write_backbone, NULL);
+	else if (ret == SATOMI_OK)
+		status = satomi_solve(solver);
+	else if (solver == NULL)
+		return 1;
+	else {
+		status = SATOMI_UNSAT;
+		if (options.check && satomi_check(solver, status) != SATOMI_OK) {
+			fprintf(stdout, "[satomi] The answer failed the check!\n");
+			status = SATOMI_UNDEC;
+		}
+	}
+report:
 	if (1)
 		satomi_print_stats(solver);
 	if (status == SATOMI_UNDEC)
 		fprintf(stdout, "UNDECIDED    \n");
+	else if (status == SATOMI_SAT && maxsat)
+		fprintf(stdout, "OPTIMUM FOUND\n");
 	else if (status == SATOMI_SAT)
 		fprintf(stdout, "SATISFIABLE  \n");
 	else
 		fprintf(stdout, "UNSATISFIABLE\n");
+	if (models.file && models.file != stdout)
+		fclose(models.file);
+	if (core_out.file && core_out.file != stdout)
+		fclose(core_out.file);
 	satomi_destroy(solver);
 }
@@ -0,0 +1,459 @@
+//===--- maxsat.c -----------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+
+#include "maxsat.h"
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/misc.h"
+#include "utils/vec/vec.h"
+
+//===------------------------------------------------------------------------===
+// MaxSAT internal functions
+//===------------------------------------------------------------------------===
+/** Adds a clause at level zero, the checker takes it as given. */
+static void
+maxsat_add_clause(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	solver_backjump(s, 0);
+	if (s->checker)
+		checker_add_axiom(s->checker, lits, size);
+	solver_attach_clause(s, lits, size);
+}
+
+static uint32_t
+maxsat_new_lit(solver_t *s)
+{
+	satomi_add_variable(s);
+	return var2lit(s->n_vars - 1, 0);
+}
+
+/** Adds a soft, or adds the weight to the soft with the same literal. */
+static void
+maxsat_add_soft(struct maxsat *m, uint32_t lit, uint32_t node, uint32_t bound,
+                uint64_t weight)
+{
+	struct maxsat_soft *soft;
+
+	while (vec_size(m->soft_of) <= lit)
+		vec_push_back(m->soft_of, UNDEF);
+	if (vec_at(m->soft_of, lit) != UNDEF) {
+		m->softs[vec_at(m->soft_of, lit)].weight += weight;
+		return;
+	}
+	if (m->n_softs == m->cap_softs) {
+		m->cap_softs = m->cap_softs ? 2 * m->cap_softs : 64;
+		m->softs = STM_REALLOC(struct maxsat_soft, m->softs, m->cap_softs);
+	}
+	vec_data(m->soft_of)[lit] = m->n_softs;
+	soft = m->softs + m->n_softs++;
+	soft->lit = lit;
+	soft->node = node;
+	soft->bound = bound;
+	soft->weight = weight;
+}
+
+/** Gives the soft clauses to the solver, a selector for each longer one. */
+static void
+maxsat_attach(solver_t *s, struct maxsat *m)
+{
+	uint32_t *data = vec_data(m->clauses);
+	vec_ui32_t *lits = vec_ui32_alloc(0);
+
+	m->attached = 1;
+	m->n_vars = s->n_vars;
+	for (uint32_t i = 0, k = 0; i < vec_size(m->clauses); k++) {
+		uint32_t size = data[i];
+		uint32_t lit;
+
+		if (size == 1) {
+			maxsat_add_soft(m, data[i + 1], UNDEF, 0, vec_at(m->weights, k));
+			i += 1 + size;
+			continue;
+		}
+		lit = maxsat_new_lit(s);
+		vec_clear(lits);
+		for (uint32_t j = 0; j < size; j++)
+			vec_push_back(lits, data[i + 1 + j]);
+		vec_push_back(lits, lit_neg(lit));
+		if (s->checker)
+			checker_add_original(s->checker, vec_data(lits), vec_size(lits));
+		solver_attach_clause(s, vec_data(lits), vec_size(lits));
+		maxsat_add_soft(m, lit, UNDEF, 0, vec_at(m->weights, k));
+		i += 1 + size;
+	}
+	vec_free(lits);
+}
+
+static uint32_t
+maxsat_new_node(struct maxsat *m, uint32_t left, uint32_t right, uint32_t n_inputs)
+{
+	struct maxsat_node *node;
+
+	if (m->n_nodes == m->cap_nodes) {
+		m->cap_nodes = m->cap_nodes ? 2 * m->cap_nodes : 64;
+		m->nodes = STM_REALLOC(struct maxsat_node, m->nodes, m->cap_nodes);
+	}
+	node = m->nodes + m->n_nodes;
+	node->left = left;
+	node->right = right;
+	node->n_inputs = n_inputs;
+	node->outputs = vec_ui32_alloc(0);
+	return m->n_nodes++;
+}
+
+/** Builds a balanced totalizer tree over the inputs, without outputs yet. */
+static uint32_t
+maxsat_totalizer(struct maxsat *m, const uint32_t *inputs, uint32_t n)
+{
+	uint32_t left, right, node;
+
+	if (n == 1) {
+		node = maxsat_new_node(m, UNDEF, UNDEF, 1);
+		vec_push_back(m->nodes[node].outputs, inputs[0]);
+		return node;
+	}
+	left = maxsat_totalizer(m, inputs, n / 2);
+	right = maxsat_totalizer(m, inputs + n / 2, n - n / 2);
+	return maxsat_new_node(m, left, right, n);
+}
+
+/**
+ *  Makes the outputs of a node up to 'bound', and those of its children first.
+ *  Output t gets the clauses (l_i & r_j -> o_t) for i + j = t, l_0 and r_0
+ *  standing for true. This is the lazy extension of the totalizer: a bound is
+ *  only raised when a core needs it.
+ */
+static void
+maxsat_extend(solver_t *s, struct maxsat *m, uint32_t id, uint32_t bound)
+{
+	uint32_t clause[3];
+	uint32_t left = m->nodes[id].left;
+	uint32_t right = m->nodes[id].right;
+
+	if (bound > m->nodes[id].n_inputs)
+		bound = m->nodes[id].n_inputs;
+	if (left == UNDEF || vec_size(m->nodes[id].outputs) >= bound)
+		return;
+	maxsat_extend(s, m, left, bound);
+	maxsat_extend(s, m, right, bound);
+	for (uint32_t t = vec_size(m->nodes[id].outputs) + 1; t <= bound; t++) {
+		uint32_t output = maxsat_new_lit(s);
+
+		vec_push_back(m->nodes[id].outputs, output);
+		for (uint32_t i = 0; i <= t; i++) {
+			uint32_t j = t - i;
+			uint32_t size = 0;
+
+			if (i > m->nodes[left].n_inputs || j > m->nodes[right].n_inputs)
+				continue;
+			if (i)
+				clause[size++] = lit_neg(vec_at(m->nodes[left].outputs, i - 1));
+			if (j)
+				clause[size++] = lit_neg(vec_at(m->nodes[right].outputs, j - 1));
+			clause[size++] = output;
+			maxsat_add_clause(s, clause, size);
+		}
+	}
+}
+
+/** Adds the soft limiting a totalizer to fewer than 'bound' true inputs. */
+static void
+maxsat_bound_soft(solver_t *s, struct maxsat *m, uint32_t node, uint32_t bound,
+                  uint64_t weight)
+{
+	if (bound > m->nodes[node].n_inputs)
+		return;
+	maxsat_extend(s, m, node, bound);
+	maxsat_add_soft(m, lit_neg(vec_at(m->nodes[node].outputs, bound - 1)),
+	                node, bound, weight);
+}
+
+/** Cost of the last model: the weight of the soft clauses it falsifies. */
+static uint64_t
+maxsat_cost(solver_t *s, struct maxsat *m)
+{
+	uint32_t *data = vec_data(m->clauses);
+	uint64_t cost = m->cost_offset;
+
+	for (uint32_t i = 0, k = 0; i < vec_size(m->clauses); k++) {
+		uint32_t size = data[i];
+		uint32_t j;
+
+		for (j = 0; j < size && !satomi_value(s, data[i + 1 + j]); j++);
+		if (j == size)
+			cost += vec_at(m->weights, k);
+		i += 1 + size;
+	}
+	return cost;
+}
+
+/**
+ *  Shrinks the core left in 'failed': solving again under it alone gives a
+ *  core at most as big (trimming), and small cores are made minimal by
+ *  leaving out each literal in turn. Returns SATOMI_UNDEC if a call fails.
+ */
+static int
+maxsat_minimize(solver_t *s, vec_ui32_t *core)
+{
+	int status;
+
+	vec_clear(core);
+	for (uint32_t i = 0; i < vec_size(s->failed); i++)
+		vec_push_back(core, vec_at(s->failed, i));
+	for (uint32_t round = 0; round < MAXSAT_TRIM_ROUNDS; round++) {
+		uint32_t size = vec_size(core);
+
+		status = solver_solve(s, vec_data(core), size);
+		if (status != SATOMI_UNSAT)
+			return SATOMI_UNDEC;
+		vec_clear(core);
+		for (uint32_t i = 0; i < vec_size(s->failed); i++)
+			vec_push_back(core, vec_at(s->failed, i));
+		if (vec_size(core) == size || vec_size(core) == 0)
+			break;
+	}
+	if (vec_size(core) > MAXSAT_MINIMIZE_SIZE)
+		return SATOMI_UNSAT;
+	for (uint32_t i = 0; i < vec_size(core) && vec_size(core) > 1; ) {
+		uint32_t lit = vec_at(core, i);
+
+		vec_data(core)[i] = vec_at(core, vec_size(core) - 1);
+		vec_shrink(core, vec_size(core) - 1);
+		status = solver_solve(s, vec_data(core), vec_size(core));
+		if (status == SATOMI_SAT) {
+			/* Needed: put it back in place */
+			vec_push_back(core, lit);
+			vec_data(core)[vec_size(core) - 1] = vec_at(core, i);
+			vec_data(core)[i++] = lit;
+		} else if (status == SATOMI_UNSAT) {
+			/* Without failed assumptions, the hard clauses are the core */
+			vec_clear(core);
+			for (uint32_t j = 0; j < vec_size(s->failed); j++)
+				vec_push_back(core, vec_at(s->failed, j));
+			i = 0;
+		} else
+			return SATOMI_UNDEC;
+	}
+	return SATOMI_UNSAT;
+}
+
+/**
+ *  Relaxes a core: its softs lose its minimum weight, which the lower bound
+ *  gains, and a totalizer over their violations takes over with the soft
+ *  "at most one violated" of that weight. Exhaustion then raises the bound of
+ *  the new totalizer as long as it alone can't be met. Outputs of older
+ *  totalizers in the core have their bound raised by one. Returns false if
+ *  the hard clauses are unsatisfiable.
+ */
+static int
+maxsat_relax(solver_t *s, struct maxsat *m, vec_ui32_t *core)
+{
+	uint64_t weight = UINT64_MAX;
+	vec_ui32_t *inputs = vec_ui32_alloc(vec_size(core));
+	uint32_t node, bound, lit;
+	int status;
+
+	for (uint32_t i = 0; i < vec_size(core); i++) {
+		struct maxsat_soft *soft = m->softs + vec_at(m->soft_of, vec_at(core, i));
+
+		if (soft->weight < weight)
+			weight = soft->weight;
+	}
+	m->lower_bound += weight;
+	m->n_cores++;
+	for (uint32_t i = 0; i < vec_size(core); i++) {
+		uint32_t id = vec_at(m->soft_of, vec_at(core, i));
+
+		m->softs[id].weight -= weight;
+		vec_push_back(inputs, lit_neg(m->softs[id].lit));
+		if (m->softs[id].node != UNDEF)
+			maxsat_bound_soft(s, m, m->softs[id].node,
+			                  m->softs[id].bound + 1, weight);
+	}
+	if (vec_size(inputs) == 1) {
+		/* The soft can't be met: it is hard violated */
+		maxsat_add_clause(s, vec_data(inputs), 1);
+		vec_free(inputs);
+		return SATOMI_OK;
+	}
+	node = maxsat_totalizer(m, vec_data(inputs), vec_size(inputs));
+	vec_free(inputs);
+	for (bound = 2; bound <= m->nodes[node].n_inputs; bound++) {
+		maxsat_extend(s, m, node, bound);
+		lit = lit_neg(vec_at(m->nodes[node].outputs, bound - 1));
+		status = solver_solve(s, &lit, 1);
+		if (status != SATOMI_UNSAT)
+			break;
+		if (vec_size(s->failed) == 0)
+			return SATOMI_ERR;
+		m->lower_bound += weight;
+	}
+	maxsat_bound_soft(s, m, node, bound, weight);
+	return SATOMI_OK;
+}
+
+/** Returns the largest weight of a soft below 'below', zero if there is none. */
+static uint64_t
+maxsat_next_stratum(struct maxsat *m, uint64_t below)
+{
+	uint64_t weight = 0;
+
+	for (uint32_t i = 0; i < m->n_softs; i++)
+		if (m->softs[i].weight < below && m->softs[i].weight > weight)
+			weight = m->softs[i].weight;
+	return weight;
+}
+
+//===------------------------------------------------------------------------===
+// MaxSAT external functions
+//===------------------------------------------------------------------------===
+struct maxsat *
+maxsat_alloc(void)
+{
+	struct maxsat *m = STM_CALLOC(struct maxsat, 1);
+
+	m->clauses = vec_ui32_alloc(0);
+	m->weights = vec_ui64_alloc(0);
+	m->soft_of = vec_ui32_alloc(0);
+	return m;
+}
+
+void
+maxsat_free(struct maxsat *m)
+{
+	for (uint32_t i = 0; i < m->n_nodes; i++)
+		vec_free(m->nodes[i].outputs);
+	vec_free(m->clauses);
+	vec_free(m->weights);
+	vec_free(m->soft_of);
+	STM_FREE(m->softs);
+	STM_FREE(m->nodes);
+	STM_FREE(m);
+}
+
+/**
+ *  Adds a soft clause, whose weight is paid by the models falsifying it. Soft
+ *  clauses reach the solver on the first call, so they, and the hard clauses
+ *  with new variables, must all be added before. Returns false afterwards.
+ */
+int
+satomi_add_soft(solver_t *s, const uint32_t *lits, uint32_t size, uint64_t weight)
+{
+	struct maxsat *m;
+	uint32_t stamp;
+
+	if (s->maxsat == NULL)
+		s->maxsat = maxsat_alloc();
+	m = s->maxsat;
+	if (m->attached || s->core)
+		return SATOMI_ERR;
+	if (weight == 0)
+		return SATOMI_OK;
+	if (size == 0) {
+		m->cost_offset += weight;
+		return SATOMI_OK;
+	}
+	for (uint32_t i = 0; i < size; i++)
+		while (lit2var(lits[i]) >= s->n_vars)
+			satomi_add_variable(s);
+	stamp = solver_new_stamp(s);
+	for (uint32_t i = 0; i < size; i++)
+		if (s->stamps[lit_neg(lits[i])] == stamp)
+			return SATOMI_OK;
+		else
+			s->stamps[lits[i]] = stamp;
+	vec_push_back(m->clauses, 0);
+	for (uint32_t i = 0, head = vec_size(m->clauses) - 1; i < size; i++) {
+		if (s->stamps[lits[i]] != stamp)
+			continue;
+		s->stamps[lits[i]] = 0;
+		vec_push_back(m->clauses, lits[i]);
+		vec_data(m->clauses)[head]++;
+	}
+	vec_push_back(m->weights, weight);
+	return SATOMI_OK;
+}
+
+/**
+ *  Finds a model of the hard clauses of least cost with OLL: cores of the
+ *  softs raise a lower bound, and are relaxed by totalizers over their
+ *  violations, whose outputs become softs in turn. Everything goes through
+ *  assumptions on the same solver, so learnt clauses carry over.
+ *
+ *  The search is stratified: only softs of weight at least the current one are
+ *  assumed, the weight going down to the next one when they are all met. Each
+ *  model better than the previous ones is given to 'solution_fn' with its cost,
+ *  as the literals of the variables of the formula, so the search can be used
+ *  anytime.
+ *
+ *  Returns SATOMI_SAT once the last model given is optimal, SATOMI_UNSAT if the
+ *  hard clauses are unsatisfiable, and SATOMI_UNDEC if the search failed.
+ */
+int
+satomi_maxsat(solver_t *s, void (*solution_fn)(void *, uint64_t, const uint32_t *,
+                                                uint32_t),
+              void *data)
+{
+	struct maxsat *m;
+	vec_ui32_t *assumptions = vec_ui32_alloc(0);
+	vec_ui32_t *model = vec_ui32_alloc(0);
+	uint64_t best = UINT64_MAX;
+	uint64_t stratum;
+	int status;
+
+	if (s->maxsat == NULL)
+		s->maxsat = maxsat_alloc();
+	m = s->maxsat;
+	s->stats.init_time = stm_clock();
+	if (!m->attached)
+		maxsat_attach(s, m);
+	m->lower_bound = m->cost_offset;
+	stratum = maxsat_next_stratum(m, UINT64_MAX);
+	while (1) {
+		vec_clear(assumptions);
+		for (uint32_t i = 0; i < m->n_softs; i++)
+			if (m->softs[i].weight && m->softs[i].weight >= stratum)
+				vec_push_back(assumptions, m->softs[i].lit);
+		status = solver_solve(s, vec_data(assumptions), vec_size(assumptions));
+		if (status == SATOMI_SAT) {
+			uint64_t cost = maxsat_cost(s, m);
+
+			if (cost < best) {
+				best = cost;
+				vec_clear(model);
+				for (uint32_t var = 0; var < m->n_vars; var++)
+					vec_push_back(model, var2lit(var, !vec_at(s->model, var)));
+				solution_fn(data, cost, vec_data(model), vec_size(model));
+			}
+			if (best == m->lower_bound || stratum == 0)
+				break;
+			stratum = maxsat_next_stratum(m, stratum);
+			continue;
+		}
+		if (status == SATOMI_UNSAT && vec_size(s->failed) == 0)
+			break;
+		if (status == SATOMI_UNSAT)
+			status = maxsat_minimize(s, assumptions);
+		if (status == SATOMI_UNDEC)
+			break;
+		if (vec_size(assumptions) == 0 || !maxsat_relax(s, m, assumptions)) {
+			status = SATOMI_UNSAT;
+			break;
+		}
+	}
+	if (status == SATOMI_SAT && best != m->lower_bound)
+		status = SATOMI_UNDEC;
+	if (status == SATOMI_UNSAT && best != UINT64_MAX)
+		status = SATOMI_UNDEC;
+	vec_free(assumptions);
+	vec_free(model);
+	return status;
+}
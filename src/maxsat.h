@@ -0,0 +1,70 @@
+//===--- maxsat.h -----------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__MAXSAT_H
+#define SATOMI__MAXSAT_H
+
+#include <stdint.h>
+
+#include "solver.h"
+
+/* Cores up to this size are minimized by deletion, after trimming */
+#define MAXSAT_TRIM_ROUNDS 3
+#define MAXSAT_MINIMIZE_SIZE 16
+
+/**
+ *  A soft constraint of the search, satisfied when its literal is true: the
+ *  literal of a soft unit clause, the selector of a longer soft clause, or the
+ *  negation of a totalizer output (at most 'bound' - 1 of its inputs true).
+ */
+struct maxsat_soft {
+	uint32_t lit;
+	uint32_t node;  /* totalizer root, UNDEF for a soft clause */
+	uint32_t bound;
+	uint64_t weight; /* what is left of it, reduced by the cores */
+};
+
+/**
+ *  A node of a totalizer counting how many of its inputs are true: output 'k'
+ *  (at index k - 1) is implied when at least k inputs are. Outputs are made
+ *  on demand, up to the bound the search needs.
+ */
+struct maxsat_node {
+	uint32_t left;
+	uint32_t right; /* UNDEF for a leaf, whose single output is the input */
+	uint32_t n_inputs;
+	vec_ui32_t *outputs;
+};
+
+struct maxsat {
+	/* Original soft clauses: each one stored as its size followed by its
+	 * literals, reaching the solver on the first call */
+	vec_ui32_t *clauses;
+	vec_ui64_t *weights;
+	uint64_t cost_offset; /* weight of the empty soft clauses */
+	uint32_t n_vars;      /* variables of the formula */
+	uint8_t attached;
+
+	struct maxsat_soft *softs;
+	uint32_t n_softs;
+	uint32_t cap_softs;
+	vec_ui32_t *soft_of; /* per literal, index of its soft or UNDEF */
+
+	struct maxsat_node *nodes;
+	uint32_t n_nodes;
+	uint32_t cap_nodes;
+
+	uint64_t lower_bound;
+	uint64_t n_cores;
+};
+
+//===------------------------------------------------------------------------===
+extern struct maxsat *maxsat_alloc(void);
+extern void maxsat_free(struct maxsat *);
+
+#endif /* SATOMI__MAXSAT_H */
@@ -0,0 +1,191 @@
+//===--- share.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "satomi.h"
+#include "utils/mem.h"
+#include "utils/vec/vec.h"
+
+#define SHARE_MAX_PEERS 8
+/* Words of the ring of each peer, clauses are written as their size then
+ * their literals */
+#define SHARE_RING_WORDS (1 << 20)
+/* A clause takes at most half of the ring, so a write in flight spans at most
+ * that many words past the head: only the words behind the head by up to the
+ * rest of the ring can be read without being overwritten meanwhile */
+#define SHARE_MAX_WRITE (SHARE_RING_WORDS / 2 + 1)
+#define SHARE_SAFE_WORDS (SHARE_RING_WORDS - SHARE_MAX_WRITE)
+
+/**
+ *  A shared memory segment holds one ring per peer. Each process writes the
+ *  clauses it exports to its own ring, and reads the rings of the others from
+ *  where it stopped. The writer does not wait for the readers, which only
+ *  trust the last SHARE_SAFE_WORDS words before the head: a write in flight
+ *  may be overwriting the others. A reader that falls behind skips to the
+ *  head, and a clause that fell behind while it was being read is dropped.
+ *
+ *  Peers must solve the same formula. A process only reads what is written
+ *  after it opens the segment, so that clauses left by a previous run over the
+ *  same name are not imported.
+ */
+struct share_ring {
+	_Atomic uint64_t head; /* words written so far */
+	uint64_t pad[7];       /* one cache line per ring */
+};
+
+struct share_segment {
+	struct share_ring rings[SHARE_MAX_PEERS];
+	uint32_t words[SHARE_MAX_PEERS][SHARE_RING_WORDS];
+};
+
+struct satomi_share {
+	char *name;
+	struct share_segment *seg;
+	uint32_t peer;
+	uint64_t pos[SHARE_MAX_PEERS];
+	vec_ui32_t *lits;
+};
+
+//===------------------------------------------------------------------------===
+// Share internal functions
+//===------------------------------------------------------------------------===
+static void
+share_export(void *data, const uint32_t *lits, uint32_t size, uint32_t lbd)
+{
+	struct satomi_share *p = data;
+	struct share_ring *ring = p->seg->rings + p->peer;
+	uint32_t *words = p->seg->words[p->peer];
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	(void) lbd;
+	if (size + 1 >= SHARE_MAX_WRITE)
+		return;
+	/* The words never become visible before the head written last */
+	atomic_thread_fence(memory_order_release);
+	words[head % SHARE_RING_WORDS] = size;
+	for (uint32_t i = 0; i < size; i++)
+		words[(head + 1 + i) % SHARE_RING_WORDS] = lits[i];
+	atomic_store_explicit(&ring->head, head + 1 + size, memory_order_release);
+}
+
+static void
+share_import_ring(struct satomi_share *p, uint32_t peer, satomi_t *s)
+{
+	struct share_ring *ring = p->seg->rings + peer;
+	const uint32_t *words = p->seg->words[peer];
+	uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	uint64_t pos = p->pos[peer];
+
+	if (head - pos > SHARE_SAFE_WORDS)
+		pos = head;
+	while (pos < head) {
+		uint32_t size = words[pos % SHARE_RING_WORDS];
+
+		if (size == 0 || size + 1 >= SHARE_MAX_WRITE || pos + 1 + size > head) {
+			pos = head;
+			break;
+		}
+		vec_clear(p->lits);
+		for (uint32_t i = 0; i < size; i++)
+			vec_push_back(p->lits, words[(pos + 1 + i) % SHARE_RING_WORDS]);
+		/* The clause is only valid if it is still within reach of the
+		 * writes in flight */
+		atomic_thread_fence(memory_order_acquire);
+		head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		if (head - pos > SHARE_SAFE_WORDS) {
+			pos = head;
+			break;
+		}
+		satomi_import_clause(s, vec_data(p->lits), size);
+		pos += 1 + size;
+	}
+	p->pos[peer] = pos;
+}
+
+static void
+share_import(void *data, satomi_t *s)
+{
+	struct satomi_share *p = data;
+
+	for (uint32_t peer = 0; peer < SHARE_MAX_PEERS; peer++)
+		if (peer != p->peer)
+			share_import_ring(p, peer, s);
+}
+
+//===------------------------------------------------------------------------===
+// Share external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Opens (creating it if needed) the segment '/satomi-<name>', to share
+ *  clauses as peer 'peer', which must be below 8 and used by a single process.
+ */
+satomi_share_t *
+satomi_share_open(const char *name, uint32_t peer)
+{
+	size_t len = strlen(name) + 16;
+	struct satomi_share *p;
+	int fd;
+
+	if (peer >= SHARE_MAX_PEERS) {
+		fprintf(stdout, "[satomi] The sharing peer must be below %d.\n",
+		        SHARE_MAX_PEERS);
+		return NULL;
+	}
+	p = STM_CALLOC(struct satomi_share, 1);
+	p->name = STM_ALLOC(char, len);
+	snprintf(p->name, len, "/satomi-%s", name);
+	fd = shm_open(p->name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0 || ftruncate(fd, sizeof(struct share_segment)) != 0) {
+		fprintf(stdout, "Couldn't open shared memory: %s\n", p->name);
+		if (fd >= 0)
+			close(fd);
+		STM_FREE(p->name);
+		STM_FREE(p);
+		return NULL;
+	}
+	p->seg = mmap(NULL, sizeof(struct share_segment), PROT_READ | PROT_WRITE,
+	              MAP_SHARED, fd, 0);
+	close(fd);
+	if (p->seg == MAP_FAILED) {
+		fprintf(stdout, "Couldn't map shared memory: %s\n", p->name);
+		STM_FREE(p->name);
+		STM_FREE(p);
+		return NULL;
+	}
+	p->peer = peer;
+	for (uint32_t i = 0; i < SHARE_MAX_PEERS; i++)
+		p->pos[i] = atomic_load(&p->seg->rings[i].head);
+	p->lits = vec_ui32_alloc(0);
+	return p;
+}
+
+/** Sets the sharing callbacks of 'opts', keeping its filters. */
+void
+satomi_share_attach(satomi_share_t *p, satomi_opts_t *opts)
+{
+	opts->sharing.data = p;
+	opts->sharing.export_clause = share_export;
+	opts->sharing.import_clauses = share_import;
+}
+
+/** Unmaps the segment and removes its name, peers still mapping it keep it. */
+void
+satomi_share_close(satomi_share_t *p)
+{
+	munmap(p->seg, sizeof(struct share_segment));
+	shm_unlink(p->name);
+	vec_free(p->lits);
+	STM_FREE(p->name);
+	STM_FREE(p);
+}
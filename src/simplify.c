@@ -0,0 +1,125 @@
+//===--- simplify.c ---------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <assert.h>
+#include <string.h>
+
+#include "clause.h"
+#include "simplify.h"
+#include "solver.h"
+#include "watch_list.h"
+#include "utils/vec/vec.h"
+
+//===------------------------------------------------------------------------===
+// Simplify internal functions
+//===------------------------------------------------------------------------===
+/**
+ *  Moves the clauses down in the database, in their order, which leaves it
+ *  without holes, and builds the watches again in one sweep over the clauses:
+ *  every list gets back some of the watchers it had, within its capacity.
+ *  Returns the ticks it took.
+ */
+static uint64_t
+simplify_compact(solver_t *s)
+{
+	cref_t *crefs = vec_data(s->clauses);
+	uint32_t *data = s->clause_db->data;
+	uint64_t ticks = solver_ticks(sizeof(uint32_t) * (uint64_t) cdb_size(s->clause_db))
+	                 + solver_ticks(sizeof(struct watcher) * s->watches->arena_size);
+	cref_t dest = 0;
+	uint32_t i;
+
+	for (i = 0; i < vec_size(s->clauses); i++) {
+		uint32_t size = 1 + clause_read(s, crefs[i])->size;
+
+		assert(i == 0 || crefs[i] > crefs[i - 1]);
+		memmove(data + dest, data + crefs[i], sizeof(uint32_t) * size);
+		crefs[i] = dest;
+		dest += size;
+	}
+	s->clause_db->size = dest;
+	s->clause_db->wasted = 0;
+
+	for (i = 0; i < s->watches->size; i++) {
+		s->watches->watch_lists[i].size = 0;
+		s->watches->watch_lists[i].n_bin = 0;
+	}
+	for (i = 0; i < vec_size(s->clauses); i++)
+		clause_watch(s, crefs[i]);
+	s->n_garbage = 0;
+	return ticks;
+}
+
+//===------------------------------------------------------------------------===
+// Simplify external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Deletes the clauses satisfied at level zero and strips the false literals
+ *  of the others, with the trail fully propagated. A clause left is then free
+ *  on its two watched literals, so it keeps them, in place, and its watchers
+ *  stay valid.
+ *
+ *  Once half of the database is wasted it is compacted. Otherwise the watchers
+ *  of the deleted clauses are left to propagation, until they make up a third
+ *  of the lists, which are then collected in one pass.
+ *
+ *  Level zero assignments lose their reasons, which only interpolation reads.
+ */
+void
+simplify_level0(solver_t *s)
+{
+	cref_t *crefs = vec_data(s->clauses);
+	uint64_t ticks = solver_ticks(sizeof(uint32_t) * (uint64_t) cdb_size(s->clause_db));
+	uint32_t i, j, lit;
+
+	assert(solver_dlevel(s) == 0 && s->i_qhead == vec_size(s->trail));
+	vec_ui32_foreach(s->trail, lit, i)
+		s->vars[lit2var(lit)].reason = CREF_UNDEF;
+
+	for (i = j = 0; i < vec_size(s->clauses); i++) {
+		struct clause *clause = clause_read(s, crefs[i]);
+		uint32_t size = clause->size;
+		uint32_t n = 2;
+		uint32_t k;
+
+		for (k = 0; k < size; k++)
+			if (lit_value(s, clause->lits[k]) == LIT_TRUE)
+				break;
+		if (k < size) {
+			clause_delete(s, crefs[i]);
+			s->stats.n_removed_clauses++;
+			continue;
+		}
+		assert(lit_value(s, clause->lits[0]) != LIT_FALSE
+		       && lit_value(s, clause->lits[1]) != LIT_FALSE);
+		for (k = 2; k < size; k++)
+			if (lit_value(s, clause->lits[k]) != LIT_FALSE)
+				clause->lits[n++] = clause->lits[k];
+		s->stats.n_removed_lits += size - n;
+		s->clause_db->wasted += size - n;
+		clause->size = n;
+		crefs[j++] = crefs[i];
+	}
+	vec_shrink(s->clauses, j);
+
+	if ((uint64_t) cdb_wasted(s->clause_db) * 2 >= cdb_size(s->clause_db))
+		ticks += simplify_compact(s);
+	else if (s->n_garbage >= vec_size(s->clauses)) {
+		uint64_t n_watchers = 2 * (uint64_t) vec_size(s->clauses) + s->n_garbage;
+
+		/* The watchers, and the first line of each clause */
+		ticks += solver_ticks(sizeof(struct watcher) * n_watchers) + n_watchers;
+		s->n_garbage -= vec_wl_collect(s->watches, s->clause_db);
+		assert(s->n_garbage == 0);
+	}
+
+	s->stats.n_simplify++;
+	s->stats.n_ticks += ticks;
+	s->simp_units = vec_size(s->trail);
+	s->simp_next = s->stats.n_ticks + ticks;
+}
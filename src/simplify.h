@@ -0,0 +1,32 @@
+//===--- simplify.h ---------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__SIMPLIFY_H
+#define SATOMI__SIMPLIFY_H
+
+#include <stdint.h>
+
+#include "solver.h"
+
+/**
+ *  Level zero simplification: once new units are found, and the search spent
+ *  since the last pass at least the ticks that pass took. The proof recorded
+ *  for interpolants refers to the clauses as they are, so it turns the pass
+ *  off.
+ */
+static inline int
+simplify_due(solver_t *s)
+{
+	return s->itp == NULL && vec_size(s->trail) > s->simp_units
+	       && s->stats.n_ticks >= s->simp_next;
+}
+
+//===------------------------------------------------------------------------===
+extern void simplify_level0(solver_t *);
+
+#endif /* SATOMI__SIMPLIFY_H */
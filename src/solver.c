@@ -11,8 +11,13 @@
 #include <string.h>
 #include <math.h>
 
+#include "checkpoint.h"
 #include "clause.h"
+#include "heuristic.h"
+#include "interpolant.h"
+#include "simplify.h"
 #include "solver.h"
+#include "trace.h"
 #include "watch_list.h"
 #include "utils/mem.h"
 
@@ -24,6 +29,8 @@ solver_decide(solver_t *s)
 {
 	uint32_t next_var = UNDEF;
 
+	if (s->opts.branching != SATOMI_BRANCH_STATIC)
+		return heur_decide(s);
 	while (next_var == UNDEF || var_value(s, next_var) != VAR_UNASSING) {
 		if (vec_size(s->var_order) == 0) {
 			next_var = UNDEF;
@@ -32,36 +39,58 @@ solver_decide(solver_t *s)
 		next_var = vec_at(s->var_order, 0);
 		vec_drop(s->var_order, 0);
 	}
-	return var2lit(next_var, LIT_FALSE);
+	return var2lit(next_var, 1);
 }
 
-static inline void
+void
 solver_new_decision(solver_t *s, uint32_t lit)
 {
 	assert(var_value(s, lit2var(lit)) == VAR_UNASSING);
 	vec_push_back(s->trail_lim, vec_size(s->trail));
-	solver_enqueue(s, lit, UNDEF);
+	solver_enqueue(s, lit, CREF_UNDEF);
+	solver_hook(s, decision, lit, solver_dlevel(s));
 }
 
 /** 
  *
  */
-static inline void 
+void
 solver_backjump(solver_t *s, uint32_t level)
 {
+	uint32_t *order;
+	uint32_t i, j;
+
 	if (solver_dlevel(s) <= level)
 		return;
-	for (uint32_t i = vec_size(s->trail); i-- > vec_at(s->trail_lim, level); ) {
-		uint32_t var = lit2var(vec_at(s->trail, i));
+	solver_hook(s, backjump, solver_dlevel(s), level);
+	for (i = vec_size(s->trail); i-- > vec_at(s->trail_lim, level); ) {
+		uint32_t lit = vec_at(s->trail, i);
+		uint32_t var = lit2var(lit);
 
-		vec_assign(s->assigns, var, VAR_UNASSING);
-		vec_assign(s->reasons, var, UNDEF);
-		vec_push_back(s->var_order, var);
+		s->values[lit] = VAR_UNASSING;
+		s->values[lit_neg(lit)] = VAR_UNASSING;
+		s->vars[var].reason = CREF_UNDEF;
+		if (s->opts.branching == SATOMI_BRANCH_STATIC)
+			vec_push_back(s->var_order, var);
+		else {
+			vec_data(s->polarity)[var] = lit_polarity(lit);
+			heur_unassign(s, var);
+		}
+	}
+	if (s->opts.branching == SATOMI_BRANCH_STATIC) {
+		vec_sort(s->var_order, 1);
+		/* Implied variables were never taken out of the order, drop the
+		 * duplicates so that it does not keep growing. */
+		order = vec_data(s->var_order);
+		for (i = j = 1; i < vec_size(s->var_order); i++)
+			if (order[i] != order[j - 1])
+				order[j++] = order[i];
+		vec_shrink(s->var_order, j);
 	}
-	vec_sort(s->var_order, 1);
 	s->i_qhead = vec_at(s->trail_lim, level);
 	vec_shrink(s->trail, vec_at(s->trail_lim, level));
 	vec_shrink(s->trail_lim, level);
+	heur_backjump(s->heur, vec_size(s->trail));
 }
 
 /* Calculate Backtrack Level from the learnt clause */
@@ -71,10 +100,11 @@ solver_calc_bt_level(solver_t *s, vec_ui32_t *learnt)
 	uint32_t i, tmp;
         uint32_t i_max = 1;
 	uint32_t *lits = vec_data(learnt);
-        uint32_t max = lit_dlevel(s, lits[1]);
+        uint32_t max;
 
 	if (vec_size(learnt) == 1)
 		return 0;
+	max = lit_dlevel(s, lits[1]);
 	for (i = 2; i < vec_size(learnt); i++) {
 		if (lit_dlevel(s, lits[i]) > max) {
 			max   = lit_dlevel(s, lits[i]);
@@ -108,15 +138,16 @@ solver_calc_bt_level(solver_t *s, vec_ui32_t *learnt)
  *  variable.
  *
  */
-static inline void
-solver_analyze(solver_t *s, uint32_t cref, vec_ui32_t *learnt, uint32_t *bt_level)
+void
+solver_analyze(solver_t *s, cref_t cref, vec_ui32_t *learnt, uint32_t *bt_level)
 {
 	uint32_t i;
 	uint32_t *trail = vec_data(s->trail);
 	uint32_t idx = vec_size(s->trail) - 1;
 	uint32_t n_paths = 0;
 	uint32_t p = UNDEF;
-	uint32_t lit, var;
+	uint32_t lit;
+	uint64_t ticks = 0;
 
 	vec_push_back(learnt, UNDEF);
 	do {
@@ -124,9 +155,14 @@ solver_analyze(solver_t *s, uint32_t cref, vec_ui32_t *learnt, uint32_t *bt_leve
 		uint32_t *lits;
 		uint32_t j;
 
-		assert(cref != UNDEF);
+		assert(cref != CREF_UNDEF);
 		clause = clause_read(s, cref);
 		lits = &(clause->lits[0]);
+		ticks += solver_ticks(clause->size * sizeof(uint32_t));
+		if (s->itp && p == UNDEF)
+			itp_analyze_start(s, cref);
+		else if (s->itp)
+			itp_analyze_step(s, lit2var(p), cref);
 
 		if (p != UNDEF && clause->size == 2 && lit_value(s, lits[0]) == LIT_FALSE) {
 			assert(lit_value(s, lits[1]) == LIT_TRUE);
@@ -134,179 +170,227 @@ solver_analyze(solver_t *s, uint32_t cref, vec_ui32_t *learnt, uint32_t *bt_leve
 		}
 
 		for (j = (p == UNDEF ? 0 : 1); j < clause->size; j++) {
-			var = lit2var(lits[j]);
-			if (vec_at(s->seen, var) || var_dlevel(s, var) == 0)
+			struct var_data *vd = s->vars + lit2var(lits[j]);
+
+			if (vd->seen)
+				continue;
+			if (vd->level == 0) {
+				if (s->itp)
+					itp_analyze_level0(s, lit2var(lits[j]));
 				continue;
-			vec_assign(s->seen, var, 1);
-			if (var_dlevel(s, var) == solver_dlevel(s)) {
+			}
+			vd->seen = 1;
+			if (s->opts.branching != SATOMI_BRANCH_STATIC)
+				vec_push_back(s->heur->bumped, lit2var(lits[j]));
+			if (vd->level == solver_dlevel(s)) {
 				n_paths++;
 			} else
 				vec_push_back(learnt, lits[j]);
 		}
 
-		while (!vec_at(s->seen, lit2var(trail[idx--])));
+		while (!s->vars[lit2var(trail[idx--])].seen);
 
 		p = trail[idx + 1];
 		cref = lit_reason(s, p);
-		vec_assign(s->seen, lit2var(p), 0);
+		s->vars[lit2var(p)].seen = 0;
 		n_paths--;
 	} while (n_paths > 0);
 
 	vec_data(learnt)[0] = lit_neg(p);
+	/* The trail was walked back from its end */
+	ticks += solver_ticks((vec_size(s->trail) - idx) * sizeof(uint32_t));
+	s->stats.n_ticks += ticks;
+	if (s->itp)
+		itp_analyze_end(s);
+	if (s->opts.branching != SATOMI_BRANCH_STATIC)
+		heur_bump(s, learnt);
 	*bt_level = solver_calc_bt_level(s, learnt);
 	vec_ui32_foreach(learnt, lit, i)
-		vec_assign(s->seen, lit2var(lit), 0);
+		s->vars[lit2var(lit)].seen = 0;
 }
 
-//===------------------------------------------------------------------------===
-// Functions used to create the implication graph using graphviz.
-// This is based on CryptoMinisat
-//===------------------------------------------------------------------------===
-static inline void
-solver_create_graph_mark_vars(solver_t *s)
+/**
+ *  Gathers in 'failed' the assumptions responsible for the assumption 'lit'
+ *  being false: the ones reached by walking the reasons back from it, 'lit'
+ *  included. Together they can't hold, so their negations form a clause
+ *  implied by the formula.
+ */
+static void
+solver_analyze_final(solver_t *s, uint32_t lit)
 {
-	while (vec_size(s->stack)) {
-		uint32_t var = lit2var(vec_pop_back(s->stack));
-		
-		if (var_reason(s, var) == UNDEF)
-			continue;
-		
-		struct clause *c = clause_read(s, var_reason(s, var));
-		uint32_t *lits = &(c->lits[0]);
-		for (uint32_t i = 0; i < c->size; i++) {
-			var = lit2var(c->lits[i]);
-			if (var_dlevel(s, var) == 0)
-				continue;
-			if (vec_at(s->seen, var))
-				continue;
-
-			vec_push_back(s->stack, c->lits[i]);
-			vec_assign(s->seen, var, 1);
-		}
-	}
-}
+	uint32_t *trail = vec_data(s->trail);
 
-static inline void
-solver_create_graph_edges(solver_t *s, FILE *file)
-{
-	uint32_t i, lit;
-	vec_ui32_foreach(s->trail, lit, i) {
-		uint32_t var = lit2var(lit);
+	vec_clear(s->failed);
+	vec_push_back(s->failed, lit);
+	if (lit_dlevel(s, lit) == 0)
+		return;
+	s->vars[lit2var(lit)].seen = 1;
+	for (uint32_t i = vec_size(s->trail); i-- > vec_at(s->trail_lim, 0); ) {
+		uint32_t var = lit2var(trail[i]);
+		struct clause *clause;
 
-		if (var_dlevel(s, var) == 0)
+		if (!s->vars[var].seen)
 			continue;
-		if (vec_at(s->seen, var) == 0)
+		s->vars[var].seen = 0;
+		if (var_reason(s, var) == CREF_UNDEF) {
+			vec_push_back(s->failed, trail[i]);
 			continue;
-		if (var_reason(s, var) == UNDEF)
-			continue;
-
-		struct clause *c = clause_read(s, var_reason(s, var));
-		uint32_t *lits = &(c->lits[0]);
-		for (uint32_t j = 0; j < c->size; j++) {
-			if (lits[j] == lit || var_dlevel(s, lit2var(lits[j])) == 0)
-				continue;
+		}
+		clause = clause_read(s, var_reason(s, var));
+		s->stats.n_ticks += solver_ticks(clause->size * sizeof(uint32_t));
+		for (uint32_t j = 0; j < clause->size; j++) {
+			uint32_t other = lit2var(clause->lits[j]);
 
-			fprintf(file, "x%d -> x%d", lit2var(lits[j]), lit2var(lit));
-			fprintf(file, "[ label=\"");
-			for (uint32_t k = 0; k < c->size; k++) {
-				if (var_dlevel(s, lit2var(lits[k])) == 0)
-					continue;
-				fprintf(file, "%s%d ", 
-				        lit_polarity(lits[k]) ? "-" : "", 
-					lit2var(lits[k]));
-			}
-			fprintf(file, "\", fontsize=8 ];\n");
+			if (other != var && var_dlevel(s, other) > 0)
+				s->vars[other].seen = 1;
 		}
 	}
 }
 
 static inline void
-solver_create_graph_nodes(solver_t *s, FILE *file)
+solver_export(solver_t *s, vec_ui32_t *learnt, uint32_t lbd)
 {
-	uint32_t i, lit;
-	vec_ui32_foreach(s->trail, lit, i) {
-		uint32_t var = lit2var(lit);
+	if (vec_size(learnt) > s->opts.sharing.max_size)
+		return;
+	if (lbd > s->opts.sharing.max_lbd)
+		return;
+	s->opts.sharing.export_clause(s->opts.sharing.data, vec_data(learnt),
+	                              vec_size(learnt), lbd);
+	s->stats.n_exported++;
+}
 
-		if (vec_at(s->seen, var) == 0)
-			continue;
-		vec_assign(s->seen, var, 0);
+/** Imports happen at level zero and every 'import_interval' conflicts. */
+static inline int
+solver_import_due(solver_t *s)
+{
+	uint32_t interval = s->opts.sharing.import_interval;
 
-		fprintf(file, "x%d [ shape=\"box\", style=\"filled\"", var);
-		if (var_reason(s, var) == UNDEF)
-			fprintf(file, ", color=\"#b3cde3\"");
-		else
-			fprintf(file, ", color=\"#ccebc5\"");
+	if (s->opts.sharing.import_clauses == NULL && vec_size(s->imports) == 0)
+		return 0;
+	return solver_dlevel(s) == 0 || (interval && s->stats.n_conflicts % interval == 0);
+}
 
-		fprintf(file, ", label=\"%sx%d @ %d\" ];\n",  
-		        (lit_polarity(lit) ? "-" : ""), var, var_dlevel(s, var));
-	}
+/** Returns true if 'a' should be watched rather than 'b'. */
+static inline int
+solver_watch_before(solver_t *s, uint32_t a, uint32_t b)
+{
+	if (lit_value(s, b) != LIT_FALSE)
+		return 0;
+	return lit_value(s, a) != LIT_FALSE || lit_dlevel(s, a) > lit_dlevel(s, b);
 }
 
-static inline void
-solver_create_graph(solver_t *s, uint32_t cref, vec_ui32_t *learnt, uint32_t *bt_level)
+/**
+ *  Adds a clause in the middle of the search. The literals that can be watched
+ *  under the current trail come first: the non-false ones, then the false ones
+ *  by decreasing level. If the clause is unit or falsified by the trail, the
+ *  solver backjumps to where it becomes unit and asserts its first literal
+ *  (or, when its two deepest literals share a level, to where both are free).
+ *  Returns false if the clause is falsified at level zero.
+ */
+int
+solver_attach_clause(solver_t *s, const uint32_t *lits, uint32_t size)
 {
-	uint32_t i, lit;
-	char path[PATH_MAX];
-	char fname[1024];
-	FILE *file;
-
-	sprintf(path, "confls/%s", s->fname);
-	mkdir_p(path);
-	sprintf(fname, "%s/confl_%d.dot", path, s->stats.n_conflicts);
-	file = fopen(fname, "w");
-	if (file == NULL) {
-		fprintf(stdout, "Couldn't open file: %s\n", fname);
-		exit(EXIT_FAILURE);
+	uint32_t stamp = solver_new_stamp(s);
+	uint32_t asserting = 1;
+	uint32_t *data;
+	cref_t cref;
+
+	vec_clear(s->temp_lits);
+	for (uint32_t i = 0; i < size; i++) {
+		uint32_t lit = lits[i];
+
+		if (lit2var(lit) >= s->n_vars || s->stamps[lit_neg(lit)] == stamp)
+			return SATOMI_OK;
+		if (s->stamps[lit] == stamp)
+			continue;
+		s->stamps[lit] = stamp;
+		if (lit_value(s, lit) != VAR_UNASSING && lit_dlevel(s, lit) == 0) {
+			if (lit_value(s, lit) == LIT_TRUE)
+				return SATOMI_OK;
+			continue;
+		}
+		vec_push_back(s->temp_lits, lit);
 	}
-	solver_analyze(s, cref, s->temp_lits, bt_level);
-
-	fprintf(file, "digraph G {\n");
-	fprintf(file, "vertK -> dummy [style=invis];\n");
-	fprintf(file, " dummy [ shape=record, label=\"{");
-	fprintf(file, " Learnt Clause: ");
-	vec_ui32_foreach(learnt, lit, i) 
-		fprintf(file, "%s%d ", lit_polarity(lit) ? "-" : "", lit2var(lit));		
-	fprintf(file, "| Backtrack Level: %d", *bt_level);
-	// fprintf(file, " | {resol: | " << res << " }");
-	fprintf(file, "}\"");
-	fprintf(file, " , fontsize=8");
-	fprintf(file, " ];\n");
-
-	struct clause *clause = clause_read(s, cref);
-	uint32_t *lits = &(clause->lits[0]);
-	vec_clear(s->stack);
-	for (uint32_t j = 0; j < clause->size; j++) {
-		vec_assign(s->seen, lit2var(lits[j]), 1);
-		vec_push_back(s->stack, lits[j]);
+	if (vec_size(s->temp_lits) == 0)
+		return SATOMI_ERR;
+	if (vec_size(s->temp_lits) == 1) {
+		solver_backjump(s, 0);
+		solver_enqueue(s, vec_at(s->temp_lits, 0), CREF_UNDEF);
+		return SATOMI_OK;
 	}
 
-	for (uint32_t j = 0; j < clause->size; j++) {
-	        fprintf(file, "x%d  -> vertK", lit2var(lits[j]));
-		fprintf(file, "[ label=\"");
-		vec_ui32_foreach(s->stack, lit, i) 
-			fprintf(file, "%s%d ", 
-			        lit_polarity(lit) ? "-" : "", lit2var(lit));
-		fprintf(file, "\", fontsize=8 ];\n");
+	data = vec_data(s->temp_lits);
+	for (uint32_t w = 0; w < 2; w++)
+		for (uint32_t i = w + 1; i < vec_size(s->temp_lits); i++)
+			if (solver_watch_before(s, data[i], data[w]))
+				STM_SWAP(uint32_t, data[i], data[w]);
+
+	if (lit_value(s, data[1]) != LIT_FALSE
+	    || (lit_value(s, data[0]) == LIT_TRUE
+	        && lit_dlevel(s, data[0]) <= lit_dlevel(s, data[1])))
+		asserting = 0;
+	else if (lit_value(s, data[0]) == LIT_FALSE
+	         && lit_dlevel(s, data[0]) == lit_dlevel(s, data[1])) {
+		solver_backjump(s, lit_dlevel(s, data[0]) - 1);
+		asserting = 0;
+	} else
+		solver_backjump(s, lit_dlevel(s, data[1]));
+	/* Running out of memory for watches is caught by the search */
+	cref = solver_clause_create(s, s->temp_lits);
+	if (clause_watch(s, cref) && asserting)
+		solver_enqueue(s, data[0], cref);
+	return SATOMI_OK;
+}
+
+//===------------------------------------------------------------------------===
+// Solver external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Adds the clauses imported since the last call, after asking for more.
+ *  Returns false if one of them is falsified at level zero.
+ */
+int
+solver_import(solver_t *s)
+{
+	uint32_t *data, *end;
+
+	if (s->opts.sharing.import_clauses)
+		s->opts.sharing.import_clauses(s->opts.sharing.data, s);
+	data = vec_data(s->imports);
+	end = data + vec_size(s->imports);
+	while (data < end) {
+		uint32_t size = *data++;
+
+		if (!solver_attach_clause(s, data, size)) {
+			vec_clear(s->imports);
+			return SATOMI_ERR;
+		}
+		s->stats.n_imported++;
+		s->stats.n_ticks += solver_ticks(size * sizeof(uint32_t));
+		data += size;
 	}
+	vec_clear(s->imports);
+	return SATOMI_OK;
+}
 
-	/* Special conflict node */
-	fprintf(file, "vertK [ shape=\"box\", style=\"filled\", ");
-	fprintf(file, "color=\"#fbb4ae\", label=\"C : ");
-	vec_ui32_foreach(s->stack, lit, i) 
-		fprintf(file, "%s%d ", 
-		        lit_polarity(lit) ? "-" : "", lit2var(lit));
-	fprintf(file, "\"];\n");
+/** Returns the number of distinct decision levels among the literals. */
+uint32_t
+solver_lbd(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	uint32_t stamp = solver_new_stamp(s);
+	uint32_t lbd = 0;
 
-	solver_create_graph_mark_vars(s);
-	solver_create_graph_edges(s, file);
-	solver_create_graph_nodes(s, file);
+	for (uint32_t i = 0; i < size; i++) {
+		uint32_t level = lit_dlevel(s, lits[i]);
 
-	fprintf(file, "}\n");
-	fclose(file);
+		if (s->stamps[level] != stamp) {
+			s->stamps[level] = stamp;
+			lbd++;
+		}
+	}
+	return lbd;
 }
-//===------------------------------------------------------------------------===
-// Solver external functions
-//===------------------------------------------------------------------------===
+
 /** 
  *  Creating a clause involves: calculating its size as a number of 32-bits
  *  words (n_words) and asking the clause database to make space for it. The
@@ -316,11 +400,11 @@ solver_create_graph(solver_t *s, uint32_t cref, vec_ui32_t *learnt, uint32_t *bt
  *  As we add literals to the clause, we must also add the clause to the
  *  ocurrence list of the literals. 
  */
-uint32_t
+cref_t
 solver_clause_create(solver_t *s, vec_ui32_t *lits)
 {
 	struct clause *clause;
-	uint32_t cref;
+	cref_t cref;
 	uint32_t n_words;
 
 	assert(vec_size(lits) > 1);
@@ -336,11 +420,12 @@ solver_clause_create(solver_t *s, vec_ui32_t *lits)
 	return cref;
 }
 
-uint32_t
+cref_t
 solver_propagate(solver_t *s)
 {
-	uint32_t conf_cref = UNDEF;
+	cref_t conf_cref = CREF_UNDEF;
 	uint32_t n_propagations = 0;
+	uint64_t ticks = 0;
 
 	while (s->i_qhead < vec_size(s->trail)) {
 		uint32_t lit = vec_at(s->trail, s->i_qhead++);
@@ -355,12 +440,17 @@ solver_propagate(solver_t *s)
 		watch_list_foreach_bin(s->watches, i, lit) {
 			if (var_value(s, lit2var(i->blocker)) == VAR_UNASSING)
 				solver_enqueue(s, i->blocker, i->cref);
-			else if (lit_value(s, i->blocker) == LIT_FALSE)
+			else if (lit_value(s, i->blocker) == LIT_FALSE) {
+				s->stats.n_ticks += ticks + 1;
 				return i->cref;
+			}
 		}
 
 		ws = vec_wl_at(s->watches, lit);
-		begin = watch_list_array(ws);
+		/* Ticks: the watchers, the first line of each clause visited, and
+		 * the rest of it when looking for a new watch */
+		ticks += solver_ticks(watch_list_size(ws) * sizeof(struct watcher));
+		begin = watch_list_array(s->watches, ws);
 		end = begin + watch_list_size(ws);
 		for (i = j = begin + ws->n_bin; i < end;) {
 			struct clause *clause;
@@ -373,6 +463,14 @@ solver_propagate(solver_t *s)
 
 			clause = clause_read(s, i->cref);
 			lits = &(clause->lits[0]);
+			ticks++;
+
+			/* Deleted: the watcher goes */
+			if (clause_is_garbage(clause)) {
+				s->n_garbage--;
+				i++;
+				continue;
+			}
 
 			// Make sure the false literal is data[1]:
 			neg_lit = lit_neg(lit);
@@ -388,11 +486,27 @@ solver_propagate(solver_t *s)
 				*j++ = w;
 			else {
 				/* Look for new watch */
+				ticks += clause->size * sizeof(uint32_t) / 64;
 				for (uint32_t k = 2; k < clause->size; k++) {
 					if (lit_value(s, lits[k]) != LIT_FALSE) {
+						struct watch_list *new_ws = vec_wl_at(s->watches, lit_neg(lits[k]));
+						struct watcher *base;
+
+						/* Out of memory: keep the watch, the search stops */
+						if (!watch_list_push(s->watches, new_ws, w, 0)) {
+							*j++ = w;
+							goto next;
+						}
 						lits[1] = lits[k];
 						lits[k] = neg_lit;
-						watch_list_push(vec_wl_at(s->watches, lit_neg(lits[1])), w, 0);
+						/* The arena may have been moved by the push */
+						base = watch_list_array(s->watches, ws);
+						if (base != begin) {
+							i = base + (i - begin);
+							j = base + (j - begin);
+							end = base + (end - begin);
+							begin = base;
+						}
 						goto next;
 					}
 				}
@@ -414,10 +528,11 @@ solver_propagate(solver_t *s)
 			i++;
 		}
 
-		s->stats.n_inspects += j - watch_list_array(ws);
-		watch_list_shrink(ws, j - watch_list_array(ws));
+		s->stats.n_inspects += j - begin;
+		watch_list_shrink(ws, j - begin);
 	}
 	s->stats.n_propagations += n_propagations;
+	s->stats.n_ticks += ticks;
 	return conf_cref;
 }
 
@@ -427,28 +542,79 @@ solver_propagate(solver_t *s)
 int
 solver_search(solver_t *s)
 {
+	if (!solver_import(s))
+		return SATOMI_UNSAT;
 	while (1) {
-		uint32_t confl_cref = solver_propagate(s);
+		cref_t confl_cref = solver_propagate(s);
 		uint32_t next_lit;
-		if (confl_cref != UNDEF) {
-			uint32_t bt_level;
-			uint32_t cref = UNDEF;
+		if (s->opts.branching >= SATOMI_BRANCH_LRB)
+			heur_propagated(s, confl_cref != CREF_UNDEF);
+		if (vec_wl_failed(s->watches))
+			return SATOMI_UNDEC;
+		if (confl_cref != CREF_UNDEF) {
+			uint32_t bt_level, lbd;
+			cref_t cref = CREF_UNDEF;
 			s->stats.n_conflicts++;
-			if (solver_dlevel(s) == 0)
+			solver_hook(s, conflict, s->stats.n_conflicts, solver_dlevel(s));
+			if (solver_dlevel(s) == 0) {
+				if (s->itp)
+					itp_final(s, confl_cref);
 				return SATOMI_UNSAT;
+			}
 
 			vec_clear(s->temp_lits);
-			if (s->opts.verbose & 2)
-				solver_create_graph(s, confl_cref, s->temp_lits, &bt_level);
-			else
-				solver_analyze(s, confl_cref, s->temp_lits, &bt_level);
-
+			solver_analyze(s, confl_cref, s->temp_lits, &bt_level);
+			lbd = solver_lbd(s, vec_data(s->temp_lits), vec_size(s->temp_lits));
+			solver_hook(s, learnt, vec_data(s->temp_lits), vec_size(s->temp_lits), lbd);
+			if (s->opts.sharing.export_clause)
+				solver_export(s, s->temp_lits, lbd);
+			if (trace_sampled(s))
+				trace_conflict(s, confl_cref, s->temp_lits, bt_level);
+
+			if (s->checker)
+				checker_add_learnt(s->checker, vec_data(s->temp_lits),
+				                   vec_size(s->temp_lits));
 			solver_backjump(s, bt_level);
 			if (vec_size(s->temp_lits) > 1) {
 				cref = solver_clause_create(s, s->temp_lits);
-				clause_watch(s, cref);
+				if (!clause_watch(s, cref))
+					return SATOMI_UNDEC;
 			}
 			solver_enqueue(s, vec_at(s->temp_lits, 0), cref);
+			if (s->itp)
+				itp_bind(s, cref, vec_at(s->temp_lits, 0));
+			if (s->opts.branching != SATOMI_BRANCH_STATIC)
+				s->heur->restart |= heur_restart_due(s, lbd);
+			if (vec_wl_fragmented(s->watches)) {
+				s->stats.n_ticks += solver_ticks(s->watches->arena_size
+				                                 * sizeof(struct watcher));
+				vec_wl_compact(s->watches);
+			}
+			if (s->opts.checkpoint)
+				checkpoint_periodic(s);
+			if (solver_import_due(s) && !solver_import(s))
+				return SATOMI_UNSAT;
+			if (s->opts.tick_limit && s->stats.n_ticks >= s->opts.tick_limit)
+				return SATOMI_UNDEC;
+		} else if (solver_dlevel(s) == 0 && simplify_due(s)) {
+			simplify_level0(s);
+		} else if (solver_dlevel(s) < vec_size(s->assumptions)) {
+			next_lit = vec_at(s->assumptions, solver_dlevel(s));
+			if (lit_value(s, next_lit) == LIT_FALSE) {
+				solver_analyze_final(s, next_lit);
+				return SATOMI_UNSAT;
+			}
+			/* An assumption already true gets an empty level */
+			if (lit_value(s, next_lit) == LIT_TRUE)
+				vec_push_back(s->trail_lim, vec_size(s->trail));
+			else
+				solver_new_decision(s, next_lit);
+		} else if (s->opts.branching != SATOMI_BRANCH_STATIC && s->heur->restart) {
+			/* Restarts wait for the trail to be propagated */
+			s->heur->restart = 0;
+			heur_restart(s);
+			if (solver_import_due(s) && !solver_import(s))
+				return SATOMI_UNSAT;
 		} else {
 			s->stats.n_decisions++;
 			next_lit = solver_decide(s);
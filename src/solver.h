@@ -15,6 +15,7 @@
 #include <assert.h>
 
 #include "cdb.h"
+#include "checker.h"
 #include "clause.h"
 #include "satomi.h"
 #include "watch_list.h"
@@ -22,51 +23,126 @@
 #include "utils/misc.h"
 #include "utils/vec/vec.h"
 
+/* Values, as stored per literal */
 enum {
-	LIT_FALSE = 1,
-	LIT_TRUE = 0,
-	VAR_UNASSING = 3
+	LIT_FALSE = -1,
+	LIT_TRUE = 1,
+	VAR_UNASSING = 0
 };
 
 #define UNDEF 0xFFFFFFFF
 
+/* Calls a hook of the options when it is set, HOOKS=0 builds drop the calls */
+#ifdef SATOMI_NO_HOOKS
+#define solver_hook(s, name, ...) ((void) 0)
+#else
+#define solver_hook(s, name, ...)                                     \
+	do {                                                           \
+		if (__builtin_expect((s)->opts.hooks.name != NULL, 0)) \
+			(s)->opts.hooks.name((s)->opts.hooks.data,     \
+			                     __VA_ARGS__);             \
+	} while (0)
+#endif
+
+/**
+ *  Per variable record, gathering what conflict analysis reads for each
+ *  variable it visits, so that a visit touches a single cache line.
+ */
+struct var_data {
+	cref_t reason;
+	uint32_t level;
+	uint8_t seen;
+};
+
 typedef struct solver_t_ solver_t;
 struct solver_t_ {
 	/* Input info */
 	char *fname; 
 	
 	/* Clauses Database */
-	vec_ui32_t *clauses;
+	vec_cref_t *clauses;
 	struct cdb *clause_db;
 	vec_wl_t *watches;
 
 	/* Variable Information */
-	vec_ui32_t *var_order;
-	vec_ui32_t *levels;
-	vec_ui32_t *reasons;
-	vec_ui8_t *assigns;
-	vec_ui8_t *polarity;
+	uint32_t n_vars;
+	uint32_t cap_vars;
+	struct var_data *vars;
+	int8_t *values;
+	uint32_t *stamps; /* per literal, marks literals (or levels) of a clause */
+	uint32_t stamp;
+	vec_ui32_t *var_order; /* static order, see SATOMI_BRANCH_STATIC */
+	vec_ui8_t *polarity;   /* saved phases */
+	struct heur *heur;
 
 	/* Assignments */
 	vec_ui32_t *trail;
 	vec_ui32_t *trail_lim;
 	uint32_t i_qhead;
 
+	/* Incremental solving: the assumptions of the current call, the ones
+	 * among them found to be failing and the last model (one value per
+	 * variable, true or false) */
+	vec_ui32_t *assumptions;
+	vec_ui32_t *failed;
+	vec_ui8_t *model;
+
 	/* Temporary data */
 	vec_ui32_t *temp_lits;
-	vec_ui8_t *seen;
 	vec_ui32_t *tagged;
 	vec_ui32_t *stack;
 	vec_ui32_t *last_dlevel;
 
+	/* Answer checking */
+	struct checker *checker;
+
+	/* Original clauses tagged with selectors, for cores */
+	struct core *core;
+
+	/* Soft clauses and totalizers, for MaxSAT */
+	struct maxsat *maxsat;
+
+	/* Resolution proof, for interpolants */
+	struct itp *itp;
+
+	/* Level zero simplification: the units it saw, and the ticks it waits */
+	uint32_t simp_units;
+	uint64_t simp_next;
+
+	/* Watchers of deleted clauses still in the lists */
+	uint64_t n_garbage;
+
+	/* Checkpoints */
+	uint64_t ckpt_next;
+	struct ckpt_writer *ckpt_writer;
+
+	/* Clause sharing: imported clauses, each one as its size then its
+	 * literals, waiting to be added to the search */
+	vec_ui32_t *imports;
+
+	/* Conflict traces */
+	FILE *trace_file;
+	uint64_t trace_next;
+	struct event_log *event_log;
+
 	struct satomi_stats stats;
 	struct satomi_opts opts;
 };
 
 //===------------------------------------------------------------------------===
-extern uint32_t solver_clause_create(solver_t *, vec_ui32_t *);
+extern cref_t solver_clause_create(solver_t *, vec_ui32_t *);
 extern int solver_search(solver_t *);
-extern uint32_t solver_propagate(solver_t *);
+extern int solver_solve(solver_t *, const uint32_t *, uint32_t);
+extern cref_t solver_propagate(solver_t *);
+extern void solver_new_decision(solver_t *, uint32_t);
+extern void solver_backjump(solver_t *, uint32_t);
+extern void solver_analyze(solver_t *, cref_t, vec_ui32_t *, uint32_t *);
+extern int solver_add_clause_sorted(solver_t *, const uint32_t *, uint32_t);
+extern int solver_add_clause_unsorted(solver_t *, const uint32_t *, uint32_t);
+extern uint32_t solver_lbd(solver_t *, const uint32_t *, uint32_t);
+extern int solver_attach_clause(solver_t *, const uint32_t *, uint32_t);
+extern int solver_import(solver_t *);
+extern void solver_reserve_vars(solver_t *, uint32_t);
 
 //===------------------------------------------------------------------------===
 // Inline var/lit functions
@@ -79,14 +155,15 @@ lit2var(uint32_t lit) { return lit >> 1; }
 //===------------------------------------------------------------------------===
 // Inline var functions
 //===------------------------------------------------------------------------===
-static inline uint8_t
-var_value(solver_t *s, uint32_t var) { return vec_at(s->assigns, var); }
+/* Value of the variable's positive literal */
+static inline int8_t
+var_value(solver_t *s, uint32_t var) { return s->values[var + var]; }
 
 static inline uint32_t
-var_dlevel(solver_t *s, uint32_t var) { return vec_at(s->levels, var); }
+var_dlevel(solver_t *s, uint32_t var) { return s->vars[var].level; }
 
-static inline uint32_t
-var_reason(solver_t *s, uint32_t var) { return vec_at(s->reasons, var); }
+static inline cref_t
+var_reason(solver_t *s, uint32_t var) { return s->vars[var].reason; }
 //===------------------------------------------------------------------------===
 // Inline lit functions
 //===------------------------------------------------------------------------===
@@ -96,23 +173,28 @@ lit_neg(uint32_t lit) { return lit ^ 1; }
 static inline uint8_t
 lit_polarity(uint32_t lit) { return (uint8_t)(lit & 1); }
 
-static inline uint8_t
-lit_value(solver_t *s, uint32_t lit)
-{
-	return lit_polarity(lit) ^ vec_at(s->assigns, lit2var(lit));
-}
+static inline int8_t
+lit_value(solver_t *s, uint32_t lit) { return s->values[lit]; }
 
 static inline uint32_t
-lit_dlevel(solver_t *s, uint32_t lit) { return vec_at(s->levels, lit2var(lit)); }
+lit_dlevel(solver_t *s, uint32_t lit) { return s->vars[lit2var(lit)].level; }
 
-static inline uint32_t
-lit_reason(solver_t *s, uint32_t lit) { return vec_at(s->reasons, lit2var(lit)); }
+static inline cref_t
+lit_reason(solver_t *s, uint32_t lit) { return s->vars[lit2var(lit)].reason; }
 //===------------------------------------------------------------------------===
 // Inline solver minor functions
 //===------------------------------------------------------------------------===
 static inline uint32_t 
 solver_dlevel(solver_t *s) { return vec_size(s->trail_lim); }
 
+/**
+ *  Ticks count the search effort in cache lines touched, so that limits and
+ *  schedules give the same search on any machine: one for 'bytes' of memory
+ *  read in a row.
+ */
+static inline uint64_t
+solver_ticks(uint64_t bytes) { return 1 + bytes / 64; }
+
 static inline uint32_t 
 solver_last_decision(solver_t *s)
 {
@@ -120,28 +202,42 @@ solver_last_decision(solver_t *s)
 }
 
 static inline int
-solver_enqueue(solver_t *s, uint32_t lit, uint32_t reason)
+solver_enqueue(solver_t *s, uint32_t lit, cref_t reason)
 {
-	uint32_t var = lit2var(lit);
+	struct var_data *vd = s->vars + lit2var(lit);
 
-	vec_assign(s->assigns, var, lit_polarity(lit));
-	vec_assign(s->levels, var, solver_dlevel(s));
-	vec_assign(s->reasons, var, reason);
+	assert(lit2var(lit) < s->n_vars);
+	s->values[lit] = LIT_TRUE;
+	s->values[lit_neg(lit)] = LIT_FALSE;
+	vd->level = solver_dlevel(s);
+	vd->reason = reason;
 	vec_push_back(s->trail, lit);
 	return SATOMI_OK;
 }
 
+/** Starts a new marking with the stamps, which are cleared when they wrap. */
+static inline uint32_t
+solver_new_stamp(solver_t *s)
+{
+	if (++s->stamp == 0) {
+		memset(s->stamps, 0, sizeof(uint32_t) * 2 * s->cap_vars);
+		s->stamp = 1;
+	}
+	return s->stamp;
+}
+
 //===------------------------------------------------------------------------===
 // Inline clause functions
 //===------------------------------------------------------------------------===
 static inline struct clause *
-clause_read(solver_t *s, uint32_t cref)
+clause_read(solver_t *s, cref_t cref)
 {
 	return cdb_handler(s->clause_db, cref);
 }
 
-static inline void
-clause_watch(solver_t *s, uint32_t cref)
+/** Returns SATOMI_ERR if the watch lists ran out of memory. */
+static inline int
+clause_watch(solver_t *s, cref_t cref)
 {
 	struct clause *clause = cdb_handler(s->clause_db, cref);
 	struct watcher w1;
@@ -151,16 +247,32 @@ clause_watch(solver_t *s, uint32_t cref)
 	w2.cref = cref;
 	w1.blocker = clause->lits[1];
 	w2.blocker = clause->lits[0];
-	watch_list_push(vec_wl_at(s->watches, lit_neg(clause->lits[0])), w1, (clause->size == 2));
-	watch_list_push(vec_wl_at(s->watches, lit_neg(clause->lits[1])), w2, (clause->size == 2));
+	if (!watch_list_push(s->watches, vec_wl_at(s->watches, lit_neg(clause->lits[0])), w1, (clause->size == 2)))
+		return SATOMI_ERR;
+	if (!watch_list_push(s->watches, vec_wl_at(s->watches, lit_neg(clause->lits[1])), w2, (clause->size == 2))) {
+		watch_list_remove(s->watches, vec_wl_at(s->watches, lit_neg(clause->lits[0])), cref, (clause->size == 2));
+		return SATOMI_ERR;
+	}
+	return SATOMI_OK;
 }
 
+/**
+ *  Marks a clause as deleted, the caller takes it out of s->clauses. Its
+ *  watchers stay in the lists until propagation meets them or the lists are
+ *  collected (vec_wl_collect). Propagation doesn't read binary clauses, so
+ *  these are only deleted once satisfied at level zero. A deleted clause must
+ *  not be the reason of an assignment.
+ */
 static inline void
-clause_unwatch(solver_t *s, uint32_t cref)
+clause_delete(solver_t *s, cref_t cref)
 {
 	struct clause *clause = cdb_handler(s->clause_db, cref);
-	watch_list_remove(vec_wl_at(s->watches, lit_neg(clause->lits[0])), cref, (clause->size == 2));
-	watch_list_remove(vec_wl_at(s->watches, lit_neg(clause->lits[1])), cref, (clause->size == 2));
+
+	assert(clause->size > 2 || lit_value(s, clause->lits[0]) == LIT_TRUE
+	       || lit_value(s, clause->lits[1]) == LIT_TRUE);
+	cdb_remove(s->clause_db, clause);
+	clause->size = 0;
+	s->n_garbage += 2;
 }
 
 #endif /* SATOMI__SOLVER_H */
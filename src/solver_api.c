@@ -11,8 +11,15 @@
 #include <string.h>
 #include <math.h>
 
+#include "checkpoint.h"
 #include "clause.h"
+#include "core.h"
+#include "event_log.h"
+#include "heuristic.h"
+#include "interpolant.h"
+#include "maxsat.h"
 #include "solver.h" 
+#include "trace.h"
 #include "utils/mem.h"
 #include "utils/misc.h" 
 #include "utils/vec/vec.h"
@@ -21,30 +28,34 @@
 // Satoko external functions
 //===------------------------------------------------------------------------===
 solver_t *
-satomi_create(char *fname)
+satomi_create(const char *fname)
 {
 	solver_t *s = STM_CALLOC(solver_t, 1);
 
 	satomi_default_opts(&s->opts);
 	/* Input info */
-	s->fname = fname; 
+	s->fname = strdup(fname ? fname : "satomi");
 	/* Clauses Database */
-	s->clauses = vec_ui32_alloc(0);
+	s->clauses = vec_cref_alloc(0);
 	s->clause_db = cdb_alloc(0);
 	s->watches = vec_wl_alloc(0);
 	/* Variable Information */
 	s->var_order = vec_ui32_alloc(0);
-	s->levels = vec_ui32_alloc(0);
-	s->reasons = vec_ui32_alloc(0);
-	s->assigns = vec_ui8_alloc(0);
+	s->polarity = vec_ui8_alloc(0);
+	s->heur = heur_alloc(s->opts.mode_ticks);
 	/* Assignments */
 	s->trail = vec_ui32_alloc(0);
 	s->trail_lim = vec_ui32_alloc(0);
+	/* Incremental solving */
+	s->assumptions = vec_ui32_alloc(0);
+	s->failed = vec_ui32_alloc(0);
+	s->model = vec_ui8_alloc(0);
 	/* Temporary data */
 	s->temp_lits = vec_ui32_alloc(0);
-	s->seen = vec_ui8_alloc(0);
 	s->tagged = vec_ui32_alloc(0);
 	s->stack = vec_ui32_alloc(0);
+	/* Clause sharing */
+	s->imports = vec_ui32_alloc(0);
 	return s;
 }
 
@@ -55,15 +66,33 @@ satomi_destroy(solver_t *s)
 	cdb_free(s->clause_db);
 	vec_wl_free(s->watches);
 	vec_free(s->var_order);
-	vec_free(s->levels);
-	vec_free(s->reasons);
-	vec_free(s->assigns);
+	vec_free(s->polarity);
+	heur_free(s->heur);
+	checkpoint_wait(s);
+	trace_close(s);
+	if (s->event_log)
+		event_log_close(s->event_log);
+	STM_FREE(s->fname);
+	STM_FREE(s->vars);
+	STM_FREE(s->values);
+	STM_FREE(s->stamps);
 	vec_free(s->trail);
 	vec_free(s->trail_lim);
+	vec_free(s->assumptions);
+	vec_free(s->failed);
+	vec_free(s->model);
 	vec_free(s->temp_lits);
-	vec_free(s->seen);
 	vec_free(s->tagged);
 	vec_free(s->stack);
+	vec_free(s->imports);
+	if (s->checker)
+		checker_free(s->checker);
+	if (s->core)
+		core_free(s->core);
+	if (s->maxsat)
+		maxsat_free(s->maxsat);
+	if (s->itp)
+		itp_free(s->itp);
 	STM_FREE(s);
 }
 
@@ -71,6 +100,24 @@ void
 satomi_default_opts(satomi_opts_t *opts)
 {
 	opts->verbose = 1;
+	opts->check = SATOMI_CHECK_NONE;
+	opts->branching = SATOMI_BRANCH_MODES;
+	opts->mode_ticks = 1 << 20;
+	opts->tick_limit = 0;
+	opts->core = 0;
+	opts->interpolate = 0;
+	opts->checkpoint = NULL;
+	opts->checkpoint_interval = 100000;
+	opts->trace = NULL;
+	opts->trace_every = 1;
+	opts->trace_first = 1;
+	opts->trace_last = UINT64_MAX;
+	memset(&opts->hooks, 0, sizeof(struct satomi_hooks));
+	opts->event_log = NULL;
+	memset(&opts->sharing, 0, sizeof(struct satomi_sharing));
+	opts->sharing.max_size = 16;
+	opts->sharing.max_lbd = 4;
+	opts->sharing.import_interval = 256;
 }
 
 /**
@@ -81,34 +128,141 @@ satomi_configure(satomi_t *s, satomi_opts_t *user_opts)
 {
 	assert(user_opts);
 	memcpy(&s->opts, user_opts, sizeof(satomi_opts_t));
+	/* The order of the other heuristics was not kept up to date */
+	if (s->opts.branching == SATOMI_BRANCH_STATIC) {
+		vec_clear(s->var_order);
+		for (uint32_t var = 0; var < s->n_vars; var++)
+			if (var_value(s, var) == VAR_UNASSING)
+				vec_push_back(s->var_order, var);
+	} else
+		heur_configure(s);
+	if (s->opts.event_log) {
+		if (s->event_log == NULL)
+			s->event_log = event_log_open(s->opts.event_log);
+		if (s->event_log)
+			event_log_hooks(s->event_log, &s->opts.hooks);
+		else
+			s->opts.event_log = NULL;
+	}
+	if (s->opts.check && s->checker == NULL) {
+		/* The checker needs to see every original clause */
+		if (s->n_vars > 0) {
+			fprintf(stdout, "[satomi] Checking must be enabled before "
+			        "adding clauses.\n");
+			s->opts.check = SATOMI_CHECK_NONE;
+			return;
+		}
+		s->checker = checker_alloc(s->opts.check == SATOMI_CHECK_THREAD);
+	}
+	if (s->opts.core && s->core == NULL) {
+		if (s->n_vars > 0) {
+			fprintf(stdout, "[satomi] Cores must be enabled before "
+			        "adding clauses.\n");
+			s->opts.core = 0;
+			return;
+		}
+		s->core = core_alloc();
+	}
+	if (s->opts.interpolate && s->itp == NULL) {
+		/* The proof starts from the original clauses */
+		if (s->n_vars > 0) {
+			fprintf(stdout, "[satomi] Interpolation must be enabled before "
+			        "adding clauses.\n");
+			s->opts.interpolate = 0;
+			return;
+		}
+		s->itp = itp_alloc();
+	}
+}
+
+static inline void
+solver_vars_reserve(solver_t *s, uint32_t new_cap)
+{
+	struct var_data *vars;
+	int8_t *values;
+	uint32_t *stamps;
+
+	if (s->cap_vars >= new_cap)
+		return;
+	vars = STM_REALLOC(struct var_data, s->vars, new_cap);
+	if (vars != NULL)
+		s->vars = vars;
+	values = STM_REALLOC(int8_t, s->values, 2 * (size_t) new_cap);
+	if (values != NULL)
+		s->values = values;
+	stamps = STM_REALLOC(uint32_t, s->stamps, 2 * (size_t) new_cap);
+	if (stamps != NULL)
+		s->stamps = stamps;
+	if (vars == NULL || values == NULL || stamps == NULL) {
+		printf("Failed to realloc memory for %u variables.\n", new_cap);
+		fflush(stdout);
+		exit(EXIT_FAILURE);
+	}
+	s->cap_vars = new_cap;
 }
 
 void
 satomi_add_variable(solver_t *s) 
 {
-	uint32_t var = vec_size(s->var_order);
+	uint32_t var = s->n_vars;
+
+	if (s->n_vars == s->cap_vars)
+		solver_vars_reserve(s, (s->cap_vars < 4) ? 4 : (s->cap_vars / 2) * 3);
 	vec_wl_push(s->watches);
 	vec_wl_push(s->watches);
-	vec_push_back(s->levels, 0);
-	vec_push_back(s->assigns, VAR_UNASSING);
-	vec_push_back(s->reasons, UNDEF);
-	vec_push_back(s->seen, 0);
+	s->vars[var].reason = CREF_UNDEF;
+	s->vars[var].level = 0;
+	s->vars[var].seen = 0;
+	s->values[var + var] = VAR_UNASSING;
+	s->values[var + var + 1] = VAR_UNASSING;
+	s->stamps[var + var] = 0;
+	s->stamps[var + var + 1] = 0;
 	vec_push_back(s->var_order, var);
+	vec_push_back(s->polarity, 1);
+	heur_add_variable(s, var);
+	s->n_vars++;
+}
+
+/** Adds the clause left in 'temp_lits' once filtered. */
+static inline int
+solver_add_temp_lits(solver_t *s)
+{
+	cref_t cref;
+
+	if (vec_size(s->temp_lits) == 0)
+		return SATOMI_ERR;
+	if (vec_size(s->temp_lits) == 1) {
+		solver_enqueue(s, vec_at(s->temp_lits, 0), CREF_UNDEF);
+		if (s->itp)
+			itp_bind(s, CREF_UNDEF, vec_at(s->temp_lits, 0));
+		cref = solver_propagate(s);
+		if (cref != CREF_UNDEF && s->itp)
+			itp_final(s, cref);
+		return (cref == CREF_UNDEF);
+	}
+	cref = solver_clause_create(s, s->temp_lits);
+	if (s->itp)
+		itp_bind(s, cref, UNDEF);
+	return clause_watch(s, cref);
 }
 
+/**
+ *  Adds a clause whose literals are sorted in descending order, so that
+ *  duplicated and complementary literals are next to each other.
+ */
 int
-satomi_add_clause(solver_t *s, uint32_t *lits, uint32_t size)
+solver_add_clause_sorted(solver_t *s, const uint32_t *lits, uint32_t size)
 {
-	uint32_t max_var;
+	uint32_t prev_lit = UNDEF;
 
-	qsort((void *) lits, size, sizeof(uint32_t), stm_ui32_comp_desc);
-	max_var = lit2var(lits[0]);
-	while (max_var >= vec_size(s->var_order))
+	if (size == 0)
+		return SATOMI_ERR;
+	while (lit2var(lits[0]) >= s->n_vars)
 		satomi_add_variable(s);
+	if (s->itp)
+		itp_add_original(s, lits, size);
 
 	vec_clear(s->temp_lits);
-	uint32_t cref;
-	uint32_t prev_lit = UNDEF;
 	for (uint32_t i = 0; i < size; i++) {
 		if (lits[i] == lit_neg(prev_lit) || lit_value(s, lits[i]) == LIT_TRUE)
 			return SATOMI_OK;
@@ -117,30 +271,251 @@ satomi_add_clause(solver_t *s, uint32_t *lits, uint32_t size)
 			vec_push_back(s->temp_lits, lits[i]);
 		}
 	}
+	return solver_add_temp_lits(s);
+}
 
-	if (vec_size(s->temp_lits) == 0)
+/**
+ *  Adds a clause in any order, its variables must exist. Duplicated and
+ *  complementary literals are found by stamping the literals of the clause,
+ *  unless the literals come already sorted.
+ */
+int
+solver_add_clause_unsorted(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	uint32_t i;
+
+	for (i = 1; i < size && lits[i] < lits[i - 1]; i++);
+	if (i == size)
+		return solver_add_clause_sorted(s, lits, size);
+	if (s->itp)
+		itp_add_original(s, lits, size);
+
+	solver_new_stamp(s);
+	vec_clear(s->temp_lits);
+	for (i = 0; i < size; i++) {
+		if (s->stamps[lit_neg(lits[i])] == s->stamp
+		    || lit_value(s, lits[i]) == LIT_TRUE)
+			return SATOMI_OK;
+		if (s->stamps[lits[i]] == s->stamp || lit_value(s, lits[i]) == LIT_FALSE)
+			continue;
+		s->stamps[lits[i]] = s->stamp;
+		vec_push_back(s->temp_lits, lits[i]);
+	}
+	return solver_add_temp_lits(s);
+}
+
+/** Adds variables up to 'n_vars', reserving their storage at once. */
+void
+solver_reserve_vars(solver_t *s, uint32_t n_vars)
+{
+	if (n_vars <= s->n_vars)
+		return;
+	solver_vars_reserve(s, n_vars);
+	vec_wl_reserve(s->watches, 2 * n_vars);
+	vec_reserve(s->var_order, n_vars);
+	vec_reserve(s->polarity, n_vars);
+	while (s->n_vars < n_vars)
+		satomi_add_variable(s);
+}
+
+int
+satomi_add_clause(solver_t *s, uint32_t *lits, uint32_t size)
+{
+	uint32_t max_lit = 0;
+
+	if (s->core)
+		return core_add_clause(s, lits, size);
+	if (s->checker)
+		checker_add_original(s->checker, lits, size);
+	if (size == 0)
 		return SATOMI_ERR;
-	if (vec_size(s->temp_lits) == 1) {
-		solver_enqueue(s, vec_at(s->temp_lits, 0), UNDEF);
-		return (solver_propagate(s) == UNDEF);
+	solver_backjump(s, 0);
+	for (uint32_t i = 0; i < size; i++)
+		if (lits[i] > max_lit)
+			max_lit = lits[i];
+	solver_reserve_vars(s, lit2var(max_lit) + 1);
+	return solver_add_clause_unsorted(s, lits, size);
+}
+
+/**
+ *  Adds 'n' clauses, the i-th one being the literals from 'offsets[i]' up to
+ *  'offsets[i + 1]' in 'lits' ('offsets' holds n + 1 entries). Variables and
+ *  clause storage are reserved once for the whole batch. Stops at the first
+ *  clause that is empty or in conflict, returning false.
+ */
+int
+satomi_add_clauses(solver_t *s, const uint32_t *lits, const uint32_t *offsets,
+                   uint32_t n)
+{
+	uint64_t n_lits = offsets[n] - offsets[0];
+	uint32_t max_lit = 0;
+
+	if (n == 0)
+		return SATOMI_OK;
+	if (s->core) {
+		for (uint32_t i = 0; i < n; i++)
+			if (!core_add_clause(s, lits + offsets[i], offsets[i + 1] - offsets[i]))
+				return SATOMI_ERR;
+		return SATOMI_OK;
 	}
+	solver_backjump(s, 0);
+	for (uint64_t i = offsets[0]; i < offsets[n]; i++)
+		if (lits[i] > max_lit)
+			max_lit = lits[i];
+	if (n_lits)
+		solver_reserve_vars(s, lit2var(max_lit) + 1);
+	vec_reserve(s->clauses, vec_size(s->clauses) + n);
+	cdb_grow(s->clause_db, (uint64_t) cdb_size(s->clause_db) + n_lits + n);
+	vec_wl_arena_reserve(s->watches, s->watches->arena_size + 2 * (uint64_t) n);
 
-	cref = solver_clause_create(s, s->temp_lits);
-	clause_watch(s, cref);
+	for (uint32_t i = 0; i < n; i++) {
+		const uint32_t *clause = lits + offsets[i];
+		uint32_t size = offsets[i + 1] - offsets[i];
+
+		if (s->checker)
+			checker_add_original(s->checker, clause, size);
+		if (size == 0 || !solver_add_clause_unsorted(s, clause, size))
+			return SATOMI_ERR;
+	}
 	return SATOMI_OK;
 }
 
+/**
+ *  Queues a clause learnt by another solver of the same formula, to be added
+ *  at the next import point of the search. Clauses over unknown variables are
+ *  dropped then. Not available with answer checking, which could not justify
+ *  the clause.
+ */
 int
-satomi_solve(solver_t *s)
+satomi_import_clause(solver_t *s, const uint32_t *lits, uint32_t size)
+{
+	if (s->checker || size == 0)
+		return SATOMI_ERR;
+	vec_push_back(s->imports, size);
+	for (uint32_t i = 0; i < size; i++)
+		vec_push_back(s->imports, lits[i]);
+	return SATOMI_OK;
+}
+
+/**
+ *  Solves under the assumptions, starting over from level zero. A model is
+ *  kept for satomi_value, and when an UNSAT answer is due to the assumptions,
+ *  the failing ones are kept for satomi_failed_assumptions.
+ */
+int
+solver_solve(solver_t *s, const uint32_t *lits, uint32_t n)
 {
 	int status = SATOMI_UNDEC;
+	uint32_t stamp;
 
-	assert(s);
-	s->stats.init_time = stm_clock();
+	solver_backjump(s, 0);
+	vec_clear(s->assumptions);
+	vec_clear(s->failed);
+	for (uint32_t i = 0; i < n; i++)
+		solver_reserve_vars(s, lit2var(lits[i]) + 1);
+	/* Each assumption takes a level, so repeated ones are dropped: the levels
+	 * stay bounded by the number of variables, as the stamps of the LBD
+	 * need them to be */
+	stamp = solver_new_stamp(s);
+	for (uint32_t i = 0; i < n; i++) {
+		if (s->stamps[lits[i]] == stamp)
+			continue;
+		s->stamps[lits[i]] = stamp;
+		vec_push_back(s->assumptions, lits[i]);
+	}
+	s->stats.n_solves++;
+	if (vec_wl_failed(s->watches))
+		return SATOMI_UNDEC;
+	if (s->checker)
+		checker_start(s->checker);
 	status = solver_search(s);
+	if (status == SATOMI_SAT) {
+		vec_resize(s->model, s->n_vars);
+		for (uint32_t var = 0; var < s->n_vars; var++)
+			vec_data(s->model)[var] = (var_value(s, var) == LIT_TRUE);
+	}
+	if (s->checker && satomi_check(s, status) != SATOMI_OK) {
+		fprintf(stdout, "[satomi] The answer failed the check!\n");
+		status = SATOMI_UNDEC;
+	}
+	vec_clear(s->assumptions);
 	return status;
 }
 
+int
+satomi_solve(solver_t *s)
+{
+	assert(s);
+	s->stats.init_time = stm_clock();
+	if (s->core)
+		return core_solve(s, NULL, 0);
+	return solver_solve(s, NULL, 0);
+}
+
+/**
+ *  Solves with the 'n' literals of 'lits' assumed true for this call only.
+ *  Clauses can be added between calls, learnt clauses are kept.
+ */
+int
+satomi_solve_assumptions(solver_t *s, const uint32_t *lits, uint32_t n)
+{
+	assert(s);
+	s->stats.init_time = stm_clock();
+	return solver_solve(s, lits, n);
+}
+
+/**
+ *  Returns the number of assumptions the last UNSAT answer is due to, pointing
+ *  'lits' to them. There are none when the formula itself is unsatisfiable.
+ */
+uint32_t
+satomi_failed_assumptions(solver_t *s, const uint32_t **lits)
+{
+	*lits = vec_data(s->failed);
+	return vec_size(s->failed);
+}
+
+/** Returns true if the literal is true in the last model. */
+int
+satomi_value(solver_t *s, uint32_t lit)
+{
+	if (lit2var(lit) >= vec_size(s->model))
+		return 0;
+	return vec_at(s->model, lit2var(lit)) != lit_polarity(lit);
+}
+
+/**
+ *  Verifies an answer of the solver: a SAT answer by evaluating the original
+ *  clauses under the model, and an UNSAT one by checking the learnt clauses.
+ *  Returns SATOMI_OK when the answer is verified, which needs the checking to
+ *  have been enabled before adding clauses.
+ */
+int
+satomi_check(solver_t *s, int status)
+{
+	int ret = SATOMI_OK;
+
+	if (s->checker == NULL)
+		return SATOMI_ERR;
+	if (status == SATOMI_SAT) {
+		uint32_t n_lits = 2 * s->n_vars;
+		uint8_t *lit_true = STM_ALLOC(uint8_t, n_lits);
+
+		for (uint32_t lit = 0; lit < n_lits; lit++)
+			lit_true[lit] = (lit_value(s, lit) == LIT_TRUE);
+		ret = checker_check_model(s->checker, lit_true, n_lits);
+		STM_FREE(lit_true);
+	} else if (status == SATOMI_UNSAT && vec_size(s->failed)) {
+		vec_clear(s->temp_lits);
+		for (uint32_t i = 0; i < vec_size(s->failed); i++)
+			vec_push_back(s->temp_lits, lit_neg(vec_at(s->failed, i)));
+		ret = checker_check_implied(s->checker, vec_data(s->temp_lits),
+		                            vec_size(s->temp_lits));
+	} else if (status == SATOMI_UNSAT)
+		ret = checker_check_unsat(s->checker);
+	return ret;
+}
+
 void
 satomi_print_stats(solver_t *s)
 {
@@ -150,6 +525,40 @@ satomi_print_stats(solver_t *s)
 	        s->stats.n_decisions, (s->stats.n_decisions/ elapsed_time));
 	fprintf(stdout, "propagations : %-12lld  (%.0f /sec)\n",
 	        s->stats.n_propagations, (s->stats.n_propagations/ elapsed_time));
+	fprintf(stdout, "ticks        : %-12llu  (%.0f /sec)\n",
+	        (unsigned long long) s->stats.n_ticks, s->stats.n_ticks / elapsed_time);
+	if (s->opts.branching == SATOMI_BRANCH_MODES)
+		fprintf(stdout, "restarts     : %-12llu  (%u mode switches)\n",
+		        (unsigned long long) s->stats.n_restarts,
+		        s->heur->state.n_switches);
+	else if (s->opts.branching != SATOMI_BRANCH_STATIC)
+		fprintf(stdout, "restarts     : %-12llu\n",
+		        (unsigned long long) s->stats.n_restarts);
+	if (s->checker)
+		fprintf(stdout, "check        : %-12llu  (%llu failed, %g s)\n",
+		        (unsigned long long) s->checker->n_checked,
+		        (unsigned long long) s->checker->n_failed,
+		        s->checker->check_time);
+	if (s->stats.n_simplify)
+		fprintf(stdout, "simplify     : %-12llu  (%llu clauses, %llu literals removed)\n",
+		        (unsigned long long) s->stats.n_simplify,
+		        (unsigned long long) s->stats.n_removed_clauses,
+		        (unsigned long long) s->stats.n_removed_lits);
+	if (s->stats.n_solves > 1)
+		fprintf(stdout, "sat calls    : %-12llu\n",
+		        (unsigned long long) s->stats.n_solves);
+	if (s->stats.n_models)
+		fprintf(stdout, "models       : %-12llu  (%.0f /sec)\n",
+		        (unsigned long long) s->stats.n_models,
+		        s->stats.n_models / elapsed_time);
+	if (s->maxsat)
+		fprintf(stdout, "cores        : %-12llu  (lower bound %llu)\n",
+		        (unsigned long long) s->maxsat->n_cores,
+		        (unsigned long long) s->maxsat->lower_bound);
+	if (s->opts.sharing.export_clause || s->opts.sharing.import_clauses)
+		fprintf(stdout, "shared       : %-12llu  (%llu imported)\n",
+		        (unsigned long long) s->stats.n_exported,
+		        (unsigned long long) s->stats.n_imported);
 	fprintf(stdout, "cpu time     : %g s\n", elapsed_time);
 }
 
@@ -160,9 +569,9 @@ void
 satomi_print_clauses(solver_t *s)
 {
 	uint32_t i;
-	uint32_t cref;
+	cref_t cref;
 	fprintf(stdout, "Print Clauses :\n");
-	vec_ui32_foreach(s->clauses, cref, i) {
+	vec_cref_foreach(s->clauses, cref, i) {
 		struct clause *c = clause_read(s, cref);
 		clause_print(c);
 	}
@@ -0,0 +1,180 @@
+//===--- trace.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+#include <stdint.h>
+
+#include "clause.h"
+#include "solver.h"
+#include "trace.h"
+#include "utils/mem.h"
+
+//===------------------------------------------------------------------------===
+// Functions used to create the implication graph using graphviz.
+// This is based on CryptoMinisat
+//===------------------------------------------------------------------------===
+static inline void
+trace_print_lits(FILE *file, const uint32_t *lits, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+		fprintf(file, "%s%u ", lit_polarity(lits[i]) ? "-" : "", lit2var(lits[i]));
+}
+
+/** Marks the variables, above level zero, the conflict depends upon. */
+static inline void
+trace_mark_vars(solver_t *s)
+{
+	while (vec_size(s->stack)) {
+		uint32_t var = lit2var(vec_pop_back(s->stack));
+		struct clause *c;
+
+		if (var_reason(s, var) == CREF_UNDEF)
+			continue;
+		c = clause_read(s, var_reason(s, var));
+		for (uint32_t i = 0; i < c->size; i++) {
+			var = lit2var(c->lits[i]);
+			if (var_dlevel(s, var) == 0 || s->vars[var].seen)
+				continue;
+			vec_push_back(s->stack, c->lits[i]);
+			s->vars[var].seen = 1;
+		}
+	}
+}
+
+static inline void
+trace_edges(solver_t *s, FILE *file)
+{
+	uint32_t i, lit;
+
+	vec_ui32_foreach(s->trail, lit, i) {
+		uint32_t var = lit2var(lit);
+		struct clause *c;
+
+		if (var_dlevel(s, var) == 0 || s->vars[var].seen == 0
+		    || var_reason(s, var) == CREF_UNDEF)
+			continue;
+		c = clause_read(s, var_reason(s, var));
+		for (uint32_t j = 0; j < c->size; j++) {
+			if (c->lits[j] == lit || var_dlevel(s, lit2var(c->lits[j])) == 0)
+				continue;
+			fprintf(file, "x%u -> x%u [ label=\"", lit2var(c->lits[j]), var);
+			for (uint32_t k = 0; k < c->size; k++)
+				if (var_dlevel(s, lit2var(c->lits[k])) != 0)
+					trace_print_lits(file, c->lits + k, 1);
+			fputs("\", fontsize=8 ];\n", file);
+		}
+	}
+}
+
+/** Prints the marked variables, and unmarks them. */
+static inline void
+trace_nodes(solver_t *s, FILE *file)
+{
+	uint32_t i, lit;
+
+	vec_ui32_foreach(s->trail, lit, i) {
+		uint32_t var = lit2var(lit);
+
+		if (s->vars[var].seen == 0)
+			continue;
+		s->vars[var].seen = 0;
+		fprintf(file, "x%u [ shape=\"box\", style=\"filled\", color=\"%s\", "
+		        "label=\"%sx%u @ %u\" ];\n", var,
+		        var_reason(s, var) == CREF_UNDEF ? "#b3cde3" : "#ccebc5",
+		        lit_polarity(lit) ? "-" : "", var, var_dlevel(s, var));
+	}
+}
+
+static int
+trace_open(solver_t *s)
+{
+	s->trace_file = fopen(s->opts.trace, "a");
+	if (s->trace_file == NULL) {
+		fprintf(stdout, "Couldn't open file: %s\n", s->opts.trace);
+		s->opts.trace = NULL;
+		return SATOMI_ERR;
+	}
+	setvbuf(s->trace_file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+	return SATOMI_OK;
+}
+
+static inline uint64_t
+trace_every(solver_t *s) { return s->opts.trace_every ? s->opts.trace_every : 1; }
+
+/** Returns the number of the first conflict to trace after the current one. */
+static inline uint64_t
+trace_next(solver_t *s)
+{
+	uint64_t n = s->stats.n_conflicts;
+	uint64_t every = trace_every(s);
+
+	if (n < s->opts.trace_first)
+		return s->opts.trace_first;
+	n = s->opts.trace_first + ((n - s->opts.trace_first) / every + 1) * every;
+	return n > s->opts.trace_last ? UINT64_MAX : n;
+}
+
+//===------------------------------------------------------------------------===
+// Trace external functions
+//===------------------------------------------------------------------------===
+/**
+ *  Appends the implication graph of the current conflict, whose clause is
+ *  'cref', along with its learnt clause. Called after analysis and before
+ *  backjumping, while the trail still holds the conflict.
+ */
+void
+trace_conflict(solver_t *s, cref_t cref, vec_ui32_t *learnt, uint32_t bt_level)
+{
+	struct clause *clause = clause_read(s, cref);
+	uint64_t n = s->stats.n_conflicts;
+	FILE *file;
+
+	/* The search may start between two samples, e.g. from a checkpoint */
+	s->trace_next = trace_next(s);
+	if (n < s->opts.trace_first || n > s->opts.trace_last
+	    || (n - s->opts.trace_first) % trace_every(s))
+		return;
+	if (s->trace_file == NULL && !trace_open(s))
+		return;
+	file = s->trace_file;
+
+	fprintf(file, "digraph confl_%llu {\n", (unsigned long long) n);
+	fputs("vertK -> dummy [style=invis];\n", file);
+	fputs(" dummy [ shape=record, label=\"{ Learnt Clause: ", file);
+	trace_print_lits(file, vec_data(learnt), vec_size(learnt));
+	fprintf(file, "| Backtrack Level: %u}\" , fontsize=8 ];\n", bt_level);
+
+	vec_clear(s->stack);
+	for (uint32_t j = 0; j < clause->size; j++) {
+		s->vars[lit2var(clause->lits[j])].seen = 1;
+		vec_push_back(s->stack, clause->lits[j]);
+	}
+	for (uint32_t j = 0; j < clause->size; j++) {
+		fprintf(file, "x%u -> vertK [ label=\"", lit2var(clause->lits[j]));
+		trace_print_lits(file, clause->lits, clause->size);
+		fputs("\", fontsize=8 ];\n", file);
+	}
+	/* Special conflict node */
+	fputs("vertK [ shape=\"box\", style=\"filled\", color=\"#fbb4ae\", "
+	      "label=\"C : ", file);
+	trace_print_lits(file, clause->lits, clause->size);
+	fputs("\"];\n", file);
+
+	trace_mark_vars(s);
+	trace_edges(s, file);
+	trace_nodes(s, file);
+	fputs("}\n", file);
+}
+
+void
+trace_close(solver_t *s)
+{
+	if (s->trace_file)
+		fclose(s->trace_file);
+	s->trace_file = NULL;
+}
@@ -0,0 +1,34 @@
+//===--- trace.h ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__TRACE_H
+#define SATOMI__TRACE_H
+
+#include <stdint.h>
+
+#include "solver.h"
+
+/* Size of the write buffer of the trace file */
+#define TRACE_BUFFER_SIZE (1 << 20)
+
+/**
+ *  Conflict traces: the implication graph of sampled conflicts, the ones
+ *  numbered 'trace_first' + k * 'trace_every' up to 'trace_last', appended as
+ *  DOT graphs to a single file.
+ */
+static inline int
+trace_sampled(solver_t *s)
+{
+	return s->opts.trace != NULL && s->stats.n_conflicts >= s->trace_next;
+}
+
+//===------------------------------------------------------------------------===
+extern void trace_conflict(solver_t *, cref_t, vec_ui32_t *, uint32_t);
+extern void trace_close(solver_t *);
+
+#endif /* SATOMI__TRACE_H */
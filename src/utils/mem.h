@@ -10,10 +10,111 @@
 #define SATOMI__UTILS__MEM_H
 
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 #define STM_ALLOC(type, n) ((type *) malloc((n) * sizeof(type)))
 #define STM_CALLOC(type, n) ((type *) calloc((n), sizeof(type)))
 #define STM_REALLOC(type, ptr, n) ((type *) realloc(ptr, (n) * sizeof(type)))
 #define STM_FREE(p) do { free(p); p = NULL; } while(0)
 
+//===------------------------------------------------------------------------===
+// Mapped memory
+//
+// Big arenas are mapped straight from the kernel. On Linux, the mapping is
+// backed by huge pages whenever possible, explicitly (MAP_HUGETLB) when the
+// system has reserved some, transparently (MADV_HUGEPAGE) otherwise, and it
+// grows by remapping its pages instead of copying them. Elsewhere, these fall
+// back to malloc and realloc.
+//===------------------------------------------------------------------------===
+#define STM_HUGE_PAGE_SIZE ((size_t) 2 << 20)
+#define STM_PAGE_SIZE ((size_t) 4 << 10)
+
+/** Rounds a size up to the granularity of the mapping that would hold it. */
+static inline size_t
+stm_map_round(size_t bytes)
+{
+	size_t unit = bytes >= STM_HUGE_PAGE_SIZE ? STM_HUGE_PAGE_SIZE : STM_PAGE_SIZE;
+	return (bytes + unit - 1) & ~(unit - 1);
+}
+
+/** Maps 'bytes' (as rounded by stm_map_round), returns NULL on failure. */
+static inline void *
+stm_map_alloc(size_t bytes)
+{
+#if defined(__linux__)
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	void *p = MAP_FAILED;
+
+	/* Huge TLB pages must be reserved up front, otherwise the first touch
+	 * of a page the system can't provide would be fatal. */
+#if defined(MAP_HUGETLB)
+	if (bytes >= STM_HUGE_PAGE_SIZE)
+		p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+#endif
+	if (p == MAP_FAILED) {
+		p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, flags | MAP_NORESERVE, -1, 0);
+		if (p == MAP_FAILED)
+			return NULL;
+#if defined(MADV_HUGEPAGE)
+		madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+	}
+	return p;
+#else
+	return malloc(bytes);
+#endif
+}
+
+static inline void
+stm_map_free(void *p, size_t bytes)
+{
+	if (p == NULL)
+		return;
+#if defined(__linux__)
+	munmap(p, bytes);
+#else
+	(void) bytes;
+	free(p);
+#endif
+}
+
+/**
+ *  Grows a mapping from 'old_bytes' to 'new_bytes', possibly moving it.
+ *  Returns NULL on failure, in which case the old mapping is left untouched.
+ */
+static inline void *
+stm_map_grow(void *p, size_t old_bytes, size_t new_bytes)
+{
+#if defined(__linux__)
+	void *q;
+
+	if (p == NULL)
+		return stm_map_alloc(new_bytes);
+/* ThreadSanitizer does not follow pages moved by mremap */
+#if defined(MREMAP_MAYMOVE) && !defined(__SANITIZE_THREAD__)
+	q = mremap(p, old_bytes, new_bytes, MREMAP_MAYMOVE);
+	if (q != MAP_FAILED) {
+#if defined(MADV_HUGEPAGE)
+		madvise(q, new_bytes, MADV_HUGEPAGE);
+#endif
+		return q;
+	}
+#endif
+	/* Huge TLB mappings can't always be remapped */
+	q = stm_map_alloc(new_bytes);
+	if (q == NULL)
+		return NULL;
+	memcpy(q, p, old_bytes);
+	munmap(p, old_bytes);
+	return q;
+#else
+	(void) old_bytes;
+	return realloc(p, new_bytes);
+#endif
+}
+
 #endif /* SATOMI__UTILS__MEM_H */
@@ -61,29 +61,4 @@ stm_clock()
 	return ret;
 }
 
-static int 
-mkdir_p(const char *path)
-{
-	const size_t len = strlen(path);
-	char _path[PATH_MAX];
-	char *p; 
-
-	strcpy(_path, path);
-	for (p = _path + 1; *p; p++) {
-		if (*p == '/') {
-			*p = '\0';
-			if (mkdir(_path, S_IRWXU) != 0) {
-				if (errno != EEXIST)
-					return -1; 
-			}
-			*p = '/';
-		}
-	}   
-	if (mkdir(_path, S_IRWXU) != 0) {
-		if (errno != EEXIST)
-			return -1; 
-	}   
-	return 0;
-}
-
 #endif /* SATOMI__UTILS__MISC_H */
@@ -0,0 +1,125 @@
+//===--- parse.h ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#ifndef SATOMI__UTILS__PARSE_H
+#define SATOMI__UTILS__PARSE_H
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "mem.h"
+
+/** Read the file into an internal buffer.
+ *
+ * This function will receive a file name. The return data is a string ended
+ * with '\0'. If 'size' is not NULL, it receives the size of the file in bytes.
+ * Returns NULL if the file can't be read.
+ *
+ */
+static inline char *
+file_open(const char *fname, size_t *size)
+{
+	FILE *file = fopen(fname, "rb");
+	char *buffer;
+	size_t sz_file;
+
+	if (file == NULL) {
+		fprintf(stdout, "Couldn't open file: %s\n", fname);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	sz_file = ftell(file);
+	rewind(file);
+	buffer = STM_ALLOC(char, sz_file + 3);
+	if (buffer == NULL || (fread(buffer, sz_file, 1, file) != 1 && sz_file > 0)) {
+		fprintf(stdout, "Couldn't read file: %s\n", fname);
+		fclose(file);
+		free(buffer);
+		return NULL;
+	}
+	fclose(file);
+	buffer[sz_file + 0] = '\n';
+	buffer[sz_file + 1] = '\0';
+	if (size)
+		*size = sz_file;
+	return buffer;
+}
+
+static inline void
+skip_spaces(char **pos)
+{
+	assert(pos != NULL);
+	for (; isspace(**pos); (*pos)++);
+}
+
+static inline void
+skip_line(char **pos)
+{
+	assert(pos != NULL);
+	for(; **pos != '\n' && **pos != '\r' && **pos != EOF; (*pos)++);
+	if (**pos != EOF)
+		(*pos)++;
+	return;
+}
+
+/** Reads a number. On an unexpected char, sets 'error' and returns 0, leaving
+ *  the token on that char. */
+static inline int
+read_int(char **token, int *error)
+{
+	int value = 0;
+	int neg = 0;
+
+	skip_spaces(token);
+	if (**token == '-') {
+		neg = 1;
+		(*token)++;
+	} else if (**token == '+')
+		(*token)++;
+
+	if (!isdigit(**token)) {
+		if (**token == 0)
+			fprintf(stdout, "Parsing error. Unexpected end of file.\n");
+		else
+			fprintf(stdout, "Parsing error. Unexpected char: %c.\n", **token);
+		*error = 1;
+		return 0;
+	}
+	while (isdigit(**token)) {
+		value = (value * 10) + (**token - '0');
+		(*token)++;
+	}
+	return neg ? -value : value;
+}
+
+/** Reads an unsigned number, as read_int. */
+static inline uint64_t
+read_ui64(char **token, int *error)
+{
+	uint64_t value = 0;
+
+	skip_spaces(token);
+	if (!isdigit(**token)) {
+		if (**token == 0)
+			fprintf(stdout, "Parsing error. Unexpected end of file.\n");
+		else
+			fprintf(stdout, "Parsing error. Unexpected char: %c.\n", **token);
+		*error = 1;
+		return 0;
+	}
+	while (isdigit(**token)) {
+		value = (value * 10) + (**token - '0');
+		(*token)++;
+	}
+	return value;
+}
+
+#endif /* SATOMI__UTILS__PARSE_H */
@@ -14,11 +14,18 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "cdb.h"
+#include "satomi.h"
 #include "utils/mem.h"
 #include "utils/misc.h"
 
+/* Watch lists capacities are powers of two, from WL_MIN_CAP on */
+#define WL_MIN_CAP 4
+#define WL_N_CLASSES 30
+#define WL_NONE UINT64_MAX
+
 struct watcher {
-	uint32_t cref;
+	cref_t cref;
 	uint32_t blocker;
 };
 
@@ -26,84 +33,198 @@ struct watch_list {
 	uint32_t cap;
 	uint32_t size;
 	uint32_t n_bin;
-	struct watcher *watchers;
+	uint64_t start;
 };
 
+/**
+ *  The watchers of all lists live in a single arena, carved in blocks whose
+ *  capacities are powers of two (size classes). When a list outgrows its block
+ *  it moves to a block of the next class and the old one goes to the free list
+ *  of its class, to be reused by another list. A list refers to its block by
+ *  index ('start'), so the arena can be remapped when it grows: pointers into
+ *  it are only valid until the next push.
+ *
+ *  Lists loaded as they are (e.g. from a file) may have any capacity: their
+ *  blocks are freed to the biggest class they can hold, and what is left over
+ *  is wasted until compaction.
+ *
+ *  Blocks that are freed and reused scatter the lists, compaction lays them out
+ *  again in literal order.
+ */
 typedef struct vec_wl_t_ vec_wl_t;
 struct vec_wl_t_ {
 	uint32_t cap;
 	uint32_t size;
 	struct watch_list *watch_lists;
+
+	/* Arena */
+	struct watcher *watchers;
+	uint64_t arena_size;
+	uint64_t arena_cap;
+	size_t map_size;
+	uint64_t n_free;
+	uint64_t free_lists[WL_N_CLASSES];
+	uint8_t failed;
 };
 
 //===------------------------------------------------------------------------===
 // Watch list Macros
 //===------------------------------------------------------------------------===
 #define watch_list_foreach(vec, watch, lit) \
-    for (watch = watch_list_array(vec_wl_at(vec, lit)); \
-         watch < watch_list_array(vec_wl_at(vec, lit)) + watch_list_size(vec_wl_at(vec, lit)); \
+    for (watch = watch_list_array(vec, vec_wl_at(vec, lit)); \
+         watch < watch_list_array(vec, vec_wl_at(vec, lit)) + watch_list_size(vec_wl_at(vec, lit)); \
          watch++)
 
 #define watch_list_foreach_bin(vec, watch, lit) \
-    for (watch = watch_list_array(vec_wl_at(vec, lit)); \
-         watch < watch_list_array(vec_wl_at(vec, lit)) + vec_wl_at(vec, lit)->n_bin; \
+    for (watch = watch_list_array(vec, vec_wl_at(vec, lit)); \
+         watch < watch_list_array(vec, vec_wl_at(vec, lit)) + vec_wl_at(vec, lit)->n_bin; \
          watch++)
 //===------------------------------------------------------------------------===
-// Watch list API
+// Arena internal functions
 //===------------------------------------------------------------------------===
+/* Smallest class holding 'cap' watchers */
+static inline uint32_t
+wl_class(uint32_t cap)
+{
+	uint32_t class = 0;
+	while (((uint32_t) WL_MIN_CAP << class) < cap)
+		class++;
+	assert(class < WL_N_CLASSES);
+	return class;
+}
+
+/* Biggest class fitting in 'cap' (at least WL_MIN_CAP) watchers */
+static inline uint32_t
+wl_class_floor(uint32_t cap)
+{
+	uint32_t class = 0;
+	while (class + 1 < WL_N_CLASSES && ((uint32_t) WL_MIN_CAP << (class + 1)) <= cap)
+		class++;
+	return class;
+}
+
 static inline void
-watch_list_free(struct watch_list *wl)
+vec_wl_fail(vec_wl_t *vec_wl, uint64_t n_slots)
+{
+	printf("Failed to allocate memory for watch lists, from %.1f MB to "
+	       "%.1f MB.\n", 1.0 * vec_wl->map_size / (1 << 20),
+	       1.0 * n_slots * sizeof(struct watcher) / (1 << 20));
+	fflush(stdout);
+	vec_wl->failed = 1;
+}
+
+static inline int
+vec_wl_arena_reserve(vec_wl_t *vec_wl, uint64_t n_slots)
 {
-	if (wl->watchers)
-		STM_FREE(wl->watchers);
+	uint64_t new_cap = vec_wl->arena_cap;
+	size_t map_size;
+	struct watcher *watchers;
+
+	if (vec_wl->arena_cap >= n_slots)
+		return SATOMI_OK;
+	while (new_cap < n_slots)
+		new_cap += (new_cap >> 1) + 1024;
+	map_size = stm_map_round(new_cap * sizeof(struct watcher));
+	watchers = stm_map_grow(vec_wl->watchers, vec_wl->map_size, map_size);
+	if (watchers == NULL) {
+		vec_wl_fail(vec_wl, new_cap);
+		return SATOMI_ERR;
+	}
+	vec_wl->watchers = watchers;
+	vec_wl->map_size = map_size;
+	vec_wl->arena_cap = map_size / sizeof(struct watcher);
+	return SATOMI_OK;
 }
 
+/** Returns the start of a block of 'cap' slots, or WL_NONE on failure. */
+static inline uint64_t
+vec_wl_block_alloc(vec_wl_t *vec_wl, uint32_t cap)
+{
+	uint32_t class = wl_class(cap);
+	uint64_t start = vec_wl->free_lists[class];
+
+	if (start != WL_NONE) {
+		/* Free blocks keep the index of the next one in their first slot */
+		memcpy(&vec_wl->free_lists[class], vec_wl->watchers + start, sizeof(uint64_t));
+		vec_wl->n_free -= cap;
+		return start;
+	}
+	if (!vec_wl_arena_reserve(vec_wl, vec_wl->arena_size + cap))
+		return WL_NONE;
+	start = vec_wl->arena_size;
+	vec_wl->arena_size += cap;
+	return start;
+}
+
+static inline void
+vec_wl_block_free(vec_wl_t *vec_wl, uint64_t start, uint32_t cap)
+{
+	uint32_t class;
+
+	vec_wl->n_free += cap;
+	if (cap < WL_MIN_CAP)
+		return;
+	class = wl_class_floor(cap);
+	memcpy(vec_wl->watchers + start, &vec_wl->free_lists[class], sizeof(uint64_t));
+	vec_wl->free_lists[class] = start;
+}
+
+//===------------------------------------------------------------------------===
+// Watch list API
+//===------------------------------------------------------------------------===
 static inline uint32_t
 watch_list_size(struct watch_list *wl) { return wl->size; }
 
-static inline void 
+static inline void
 watch_list_shrink(struct watch_list *wl, uint32_t size)
 {
 	assert(size <= wl->size);
 	wl->size = size;
 }
 
-static inline void
-watch_list_push(struct watch_list *wl, struct watcher w, uint32_t is_bin)
+static inline struct watcher *
+watch_list_array(vec_wl_t *vec_wl, struct watch_list *wl)
 {
+	return vec_wl->watchers + wl->start;
+}
+
+/**
+ *  Returns SATOMI_ERR, leaving the list untouched, when the arena can't grow.
+ *  The failure is also recorded in the vector of watch lists.
+ */
+static inline int
+watch_list_push(vec_wl_t *vec_wl, struct watch_list *wl, struct watcher w, uint32_t is_bin)
+{
+	struct watcher *watchers;
+
 	assert(wl);
 	if (wl->size == wl->cap) {
-		uint32_t new_size = (wl->cap < 4) ? 4 : (wl->cap / 2) * 3;
-		struct watcher *watchers =
-		    STM_REALLOC(struct watcher, wl->watchers, new_size);
-		if (watchers == NULL) {
-			printf("Failed to realloc memory from %.1f MB to %.1f "
-			       "MB.\n",
-			       1.0 * wl->cap / (1 << 20),
-			       1.0 * new_size / (1 << 20));
-			fflush(stdout);
-			return;
+		uint32_t new_cap = WL_MIN_CAP << wl_class(wl->cap + 1);
+		uint64_t start = vec_wl_block_alloc(vec_wl, new_cap);
+
+		if (start == WL_NONE)
+			return SATOMI_ERR;
+		if (wl->cap) {
+			memcpy(vec_wl->watchers + start, vec_wl->watchers + wl->start,
+			       sizeof(struct watcher) * wl->size);
+			vec_wl_block_free(vec_wl, wl->start, wl->cap);
 		}
-		wl->watchers = watchers;
-		wl->cap = new_size;
+		wl->start = start;
+		wl->cap = new_cap;
 	}
-	wl->watchers[wl->size++] = w;
+	watchers = watch_list_array(vec_wl, wl);
+	watchers[wl->size++] = w;
 	if (is_bin && wl->size > wl->n_bin) {
-		STM_SWAP(struct watcher, wl->watchers[wl->n_bin], wl->watchers[wl->size - 1]);
+		STM_SWAP(struct watcher, watchers[wl->n_bin], watchers[wl->size - 1]);
 		wl->n_bin++;
 	}
-}
-
-static inline struct watcher *
-watch_list_array(struct watch_list *wl)
-{
-	return wl->watchers;
+	return SATOMI_OK;
 }
 
 static inline void
-watch_list_remove(struct watch_list *wl, uint32_t cref, uint32_t is_bin)
+watch_list_remove(vec_wl_t *vec_wl, struct watch_list *wl, cref_t cref, uint32_t is_bin)
 {
-	struct watcher *watchers = watch_list_array(wl);
+	struct watcher *watchers = watch_list_array(vec_wl, wl);
 	uint32_t i;
 	if (is_bin) {
 		for (i = 0; watchers[i].cref != cref; i++);
@@ -111,55 +232,103 @@ watch_list_remove(struct watch_list *wl, uint32_t cref, uint32_t is_bin)
 	} else
 		for (i = wl->n_bin; watchers[i].cref != cref; i++);
 	assert(i < watch_list_size(wl));
-	memmove((wl->watchers + i), (wl->watchers + i + 1),
+	memmove((watchers + i), (watchers + i + 1),
 	        (wl->size - i - 1) * sizeof(struct watcher));
 	wl->size -= 1;
 }
 
+/**
+ *  Drops the watchers of deleted clauses from all lists, in one pass, and moves
+ *  those of clauses left with two literals to the binary part of their lists,
+ *  blocked by their other literal (the list of a literal watches its negation).
+ *  Returns the number of watchers dropped.
+ */
+static inline uint64_t
+vec_wl_collect(vec_wl_t *vec_wl, struct cdb *cdb)
+{
+	uint64_t n_dropped = 0;
+	uint32_t lit;
+
+	for (lit = 0; lit < vec_wl->size; lit++) {
+		struct watch_list *wl = vec_wl->watch_lists + lit;
+		struct watcher *watchers = watch_list_array(vec_wl, wl);
+		uint32_t n_bin = 0;
+		uint32_t i, j;
+
+		for (i = j = 0; i < wl->size; i++) {
+			struct clause *clause = cdb_handler(cdb, watchers[i].cref);
+
+			if (clause_is_garbage(clause)) {
+				n_dropped++;
+				continue;
+			}
+			watchers[j] = watchers[i];
+			if (clause->size == 2) {
+				watchers[j].blocker = clause->lits[clause->lits[0] == (lit ^ 1)];
+				STM_SWAP(struct watcher, watchers[n_bin], watchers[j]);
+				n_bin++;
+			}
+			j++;
+		}
+		wl->size = j;
+		wl->n_bin = n_bin;
+	}
+	return n_dropped;
+}
+
 static inline vec_wl_t *
 vec_wl_alloc(uint32_t cap)
 {
-	vec_wl_t *vec_wl = STM_ALLOC(vec_wl_t, 1);
+	vec_wl_t *vec_wl = STM_CALLOC(vec_wl_t, 1);
 
 	if (cap == 0)
 		vec_wl->cap = 4;
 	else
 		vec_wl->cap = cap;
 	vec_wl->size = 0;
-	vec_wl->watch_lists = STM_CALLOC(
-	    struct watch_list, sizeof(struct watch_list) * vec_wl->cap);
+	vec_wl->watch_lists = STM_CALLOC(struct watch_list, vec_wl->cap);
+	for (uint32_t i = 0; i < WL_N_CLASSES; i++)
+		vec_wl->free_lists[i] = WL_NONE;
 	return vec_wl;
 }
 
 static inline void
 vec_wl_free(vec_wl_t *vec_wl)
 {
-	uint32_t i;
-	for (i = 0; i < vec_wl->size; i++)
-		watch_list_free(vec_wl->watch_lists + i);
+	stm_map_free(vec_wl->watchers, vec_wl->map_size);
 	STM_FREE(vec_wl->watch_lists);
 	STM_FREE(vec_wl);
 }
 
+static inline void
+vec_wl_reserve(vec_wl_t *vec_wl, uint32_t new_cap)
+{
+	struct watch_list *watch_lists;
+
+	if (vec_wl->cap >= new_cap)
+		return;
+	watch_lists = STM_REALLOC(struct watch_list, vec_wl->watch_lists, new_cap);
+	if (watch_lists == NULL) {
+		printf("failed to realloc memory from %.1f mb to %.1f mb.\n",
+		       1.0 * vec_wl->cap / (1 << 20), 1.0 * new_cap / (1 << 20));
+		fflush(stdout);
+		vec_wl->failed = 1;
+		return;
+	}
+	memset(watch_lists + vec_wl->cap, 0,
+	       sizeof(struct watch_list) * (new_cap - vec_wl->cap));
+	vec_wl->watch_lists = watch_lists;
+	vec_wl->cap = new_cap;
+}
+
 static inline void
 vec_wl_push(vec_wl_t *vec_wl)
 {
 	if (vec_wl->size == vec_wl->cap) {
-		uint32_t new_size =
-		    (vec_wl->cap < 4) ? vec_wl->cap * 2 : (vec_wl->cap / 2) * 3;
-
-		vec_wl->watch_lists = STM_REALLOC(
-		    struct watch_list, vec_wl->watch_lists, new_size);
-		memset(vec_wl->watch_lists + vec_wl->cap, 0,
-		       sizeof(struct watch_list) * (new_size - vec_wl->cap));
-		if (vec_wl->watch_lists == NULL) {
-			printf("failed to realloc memory from %.1f mb to %.1f "
-			       "mb.\n",
-			       1.0 * vec_wl->cap / (1 << 20),
-			       1.0 * new_size / (1 << 20));
-			fflush(stdout);
-		}
-		vec_wl->cap = new_size;
+		vec_wl_reserve(vec_wl, (vec_wl->cap < 4) ? vec_wl->cap * 2
+		                                         : (vec_wl->cap / 2) * 3);
+		if (vec_wl->size == vec_wl->cap)
+			return;
 	}
 	vec_wl->size++;
 }
@@ -172,4 +341,63 @@ vec_wl_at(vec_wl_t *vec_wl, uint32_t idx)
 	return vec_wl->watch_lists + idx;
 }
 
+static inline int
+vec_wl_failed(vec_wl_t *vec_wl) { return vec_wl->failed; }
+
+/** Compaction pays off once at least half of the arena sits in free blocks. */
+static inline int
+vec_wl_fragmented(vec_wl_t *vec_wl)
+{
+	return vec_wl->arena_size >= (1 << 16) && vec_wl->n_free * 2 >= vec_wl->arena_size;
+}
+
+/**
+ *  Copies all lists to a new arena, back to back in literal order, each one in
+ *  the smallest block with room to grow. Returns SATOMI_ERR, keeping the old
+ *  arena, if the new one can't be mapped.
+ */
+static inline int
+vec_wl_compact(vec_wl_t *vec_wl)
+{
+	struct watcher *watchers;
+	uint64_t n_slots = 0;
+	size_t map_size;
+	uint32_t i;
+
+	for (i = 0; i < vec_wl->size; i++) {
+		struct watch_list *wl = vec_wl->watch_lists + i;
+		if (wl->size)
+			n_slots += (uint64_t) WL_MIN_CAP << wl_class(wl->size + 1);
+	}
+	map_size = stm_map_round((n_slots ? n_slots : 1) * sizeof(struct watcher));
+	watchers = stm_map_alloc(map_size);
+	if (watchers == NULL)
+		return SATOMI_ERR;
+	n_slots = 0;
+	for (i = 0; i < vec_wl->size; i++) {
+		struct watch_list *wl = vec_wl->watch_lists + i;
+
+		if (wl->size == 0) {
+			wl->cap = 0;
+			wl->n_bin = 0;
+			wl->start = 0;
+			continue;
+		}
+		memcpy(watchers + n_slots, watch_list_array(vec_wl, wl),
+		       sizeof(struct watcher) * wl->size);
+		wl->start = n_slots;
+		wl->cap = WL_MIN_CAP << wl_class(wl->size + 1);
+		n_slots += wl->cap;
+	}
+	stm_map_free(vec_wl->watchers, vec_wl->map_size);
+	vec_wl->watchers = watchers;
+	vec_wl->map_size = map_size;
+	vec_wl->arena_size = n_slots;
+	vec_wl->arena_cap = map_size / sizeof(struct watcher);
+	vec_wl->n_free = 0;
+	for (i = 0; i < WL_N_CLASSES; i++)
+		vec_wl->free_lists[i] = WL_NONE;
+	return SATOMI_OK;
+}
+
 #endif /* SATOMI__WATCH_LIST_H */
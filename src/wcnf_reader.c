@@ -0,0 +1,139 @@
+//===--- wcnf_reader.c ------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "satomi.h"
+#include "solver.h"
+#include "utils/mem.h"
+#include "utils/parse.h"
+#include "utils/vec/vec.h"
+
+/** Returns SATOMI_ERR on a format error. */
+static int
+read_clause(char **token, vec_ui32_t *lits)
+{
+	int error = 0;
+	int var;
+	uint32_t sign;
+
+	vec_clear(lits);
+	while (1) {
+		var = read_int(token, &error);
+		if (error)
+			return SATOMI_ERR;
+		if (var == 0)
+			return SATOMI_OK;
+		sign = (var > 0);
+		var = abs(var) - 1;
+		vec_push_back(lits, var2lit((uint32_t) var, !sign));
+	}
+}
+
+/** Start the solver and reads the weighted DIMACS file.
+ *
+ * Both formats are read: the old one, whose parameter line 'p wcnf <vars>
+ * <clauses> [<top>]' is followed by clauses prefixed with their weight (those
+ * weighing at least 'top' being hard), and the new one, without parameter line,
+ * whose clauses are prefixed with 'h' when hard and with their weight when soft.
+ *
+ * The solver is configured with 'opts', when given, before any clause is added.
+ * Returns false upon immediate conflict among the hard clauses, in which case
+ * the solver is still returned. On a read or format error, no solver is
+ * returned.
+ */
+int
+satomi_parse_wcnf(char *fname, satomi_opts_t *opts, satomi_t **solver)
+{
+	satomi_t *p = NULL;
+	vec_ui32_t *lits;
+	uint64_t top = UINT64_MAX;
+	uint64_t weight;
+	int error = 0;
+	int ret = SATOMI_OK;
+	char *buffer = file_open(fname, NULL);
+	char *token = buffer;
+	char *name = strrchr(fname, '/');
+
+	*solver = NULL;
+	if (buffer == NULL)
+		return SATOMI_ERR;
+	name = name ? name + 1 : fname;
+
+	/* Header: comments and the parameter line, if any */
+	while (1) {
+		skip_spaces(&token);
+		if (*token == 'c')
+			skip_line(&token);
+		else
+			break;
+	}
+	if (*token == 'p') {
+		token++;
+		skip_spaces(&token);
+		if (strncmp(token, "wcnf", 4) != 0) {
+			fprintf(stdout, "There is no wcnf parameter line.\n");
+			STM_FREE(buffer);
+			return SATOMI_ERR;
+		}
+		token += 4;
+		read_int(&token, &error); /* variables */
+		read_int(&token, &error); /* clauses */
+		skip_spaces(&token);
+		if (isdigit(*token))
+			top = read_ui64(&token, &error);
+		if (error) {
+			STM_FREE(buffer);
+			return SATOMI_ERR;
+		}
+		skip_line(&token);
+	}
+	p = satomi_create(name);
+	if (opts)
+		satomi_configure(p, opts);
+
+	/* Clauses */
+	lits = vec_ui32_alloc(0);
+	while (1) {
+		skip_spaces(&token);
+		if (*token == 0)
+			break;
+		if (*token == 'c') {
+			skip_line(&token);
+			continue;
+		}
+		if (*token == 'h') {
+			token++;
+			weight = UINT64_MAX;
+		} else
+			weight = read_ui64(&token, &error);
+		if (error || !read_clause(&token, lits)) {
+			satomi_destroy(p);
+			p = NULL;
+			ret = SATOMI_ERR;
+			break;
+		}
+		if (weight < top) {
+			if (!satomi_add_soft(p, vec_data(lits), vec_size(lits), weight)) {
+				fprintf(stdout, "Soft clauses can't be used in core mode.\n");
+				satomi_destroy(p);
+				p = NULL;
+				ret = SATOMI_ERR;
+				break;
+			}
+		} else if (ret)
+			ret = satomi_add_clause(p, vec_data(lits), vec_size(lits));
+	}
+	vec_free(lits);
+	STM_FREE(buffer);
+	*solver = p;
+	return ret;
+}
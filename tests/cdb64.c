@@ -0,0 +1,80 @@
+//===--- cdb64.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+//
+// Grows a clause database built with 64-bit references (SATOMI_CREF64) past
+// 4G words, and reads back the clauses stored before and beyond that offset.
+// The words in between are never written, so the arena, mapped without
+// reserving memory, only takes the pages of the two clauses. The test is
+// skipped if the system can't map that much address space.
+//
+//===------------------------------------------------------------------------===
+#include "../src/cdb.h"
+
+#ifndef SATOMI_CREF64
+#error "The test needs 64-bit clause references"
+#endif
+
+#define FAR_WORDS ((uint64_t) 1 << 32)
+
+static cref_t
+store(struct cdb *p, uint32_t size, uint32_t first_lit)
+{
+	cref_t cref = cdb_append(p, size + 1);
+	struct clause *clause = cdb_handler(p, cref);
+
+	clause->size = size;
+	for (uint32_t i = 0; i < size; i++)
+		clause->lits[i] = first_lit + i;
+	return cref;
+}
+
+static int
+check(struct cdb *p, cref_t cref, uint32_t size, uint32_t first_lit)
+{
+	struct clause *clause = cdb_handler(p, cref);
+
+	if (clause->size != size || cdb_cref(p, (uint32_t *) clause) != cref)
+		return 0;
+	for (uint32_t i = 0; i < size; i++)
+		if (clause->lits[i] != first_lit + i)
+			return 0;
+	return 1;
+}
+
+int
+main(void)
+{
+	/* The database grows by 1.625 at most, past the first clause beyond */
+	size_t probe = stm_map_round(2 * FAR_WORDS * sizeof(uint32_t));
+	void *space = stm_map_alloc(probe);
+	struct cdb *p;
+	cref_t near, far;
+	int ok;
+
+	if (space == NULL) {
+		fprintf(stdout, "cdb64: skipped, %.0f GB can't be mapped\n",
+		        1.0 * probe / (1 << 30));
+		return 0;
+	}
+	stm_map_free(space, probe);
+	p = cdb_alloc(0);
+	near = store(p, 2, 10);
+	while (cdb_size(p) < FAR_WORDS) {
+		uint64_t gap = FAR_WORDS - cdb_size(p);
+
+		cdb_append(p, (uint32_t) (gap < (1u << 31) ? gap : (1u << 31)));
+	}
+	far = store(p, 3, 20);
+	ok = far >= FAR_WORDS && check(p, near, 2, 10) && check(p, far, 3, 20);
+	fprintf(stdout, "cdb64: clause at word %llu of %llu, %s\n",
+	        (unsigned long long) far, (unsigned long long) cdb_capacity(p),
+	        ok ? "read back" : "FAILED");
+	cdb_free(p);
+	return !ok;
+}
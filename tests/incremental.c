@@ -0,0 +1,108 @@
+//===--- incremental.c ------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+//
+// Solves one formula many times over, under assumptions and with clauses added
+// between the calls, and checks the answers:
+//
+// * thousands of repeated assumptions, each of which would take a decision
+//   level of its own, ahead of the ones the formula conflicts with;
+// * clauses added between solves with answer checking, in both modes, which
+//   make the formula unsatisfiable after a first answer was checked.
+//
+//===------------------------------------------------------------------------===
+#include <stdio.h>
+
+#include "satomi.h"
+
+#define N_REPEATS 5000
+
+static int n_failed;
+
+static uint32_t
+lit(uint32_t var, int neg)
+{
+	return 2 * var + (neg != 0);
+}
+
+static void
+expect(const char *name, int status, int expected)
+{
+	if (status == expected)
+		return;
+	fprintf(stdout, "FAILED %s: %d instead of %d\n", name, status, expected);
+	n_failed++;
+}
+
+/**
+ *  Adds (~b | c | d), (~b | c | ~d), (~b | ~c | d) and (~b | ~c | ~d), with
+ *  a = 0 to d = 3, or the same clauses with b instead of ~b: b can't hold, or
+ *  must, and either one is only found after a decision.
+ */
+static void
+add_b(satomi_t *s, int neg)
+{
+	for (int k = 0; k < 4; k++) {
+		uint32_t lits[3] = { lit(1, neg), lit(2, k & 2), lit(3, k & 1) };
+
+		satomi_add_clause(s, lits, 3);
+	}
+}
+
+static void
+repeated_assumptions(void)
+{
+	static uint32_t lits[N_REPEATS + 1];
+	satomi_t *s = satomi_create(NULL);
+	satomi_opts_t opts;
+	const uint32_t *failed;
+
+	satomi_default_opts(&opts);
+	opts.verbose = 0;
+	satomi_configure(s, &opts);
+	add_b(s, 1);
+	for (uint32_t i = 0; i < N_REPEATS; i++)
+		lits[i] = lit(0, 0);
+	lits[N_REPEATS] = lit(1, 0);
+	expect("repeated assumptions",
+	       satomi_solve_assumptions(s, lits, N_REPEATS + 1), SATOMI_UNSAT);
+	if (satomi_failed_assumptions(s, &failed) != 1 || failed[0] != lit(1, 0))
+		expect("repeated assumptions, failed", 0, 1);
+	expect("repeated assumptions, a alone",
+	       satomi_solve_assumptions(s, lits, N_REPEATS), SATOMI_SAT);
+	satomi_destroy(s);
+}
+
+static void
+checked_additions(const char *name, char check)
+{
+	satomi_t *s = satomi_create(NULL);
+	satomi_opts_t opts;
+	uint32_t b = lit(1, 0);
+
+	satomi_default_opts(&opts);
+	opts.verbose = 0;
+	opts.check = check;
+	satomi_configure(s, &opts);
+	add_b(s, 1);
+	expect(name, satomi_solve_assumptions(s, &b, 1), SATOMI_UNSAT);
+	expect(name, satomi_solve(s), SATOMI_SAT);
+	add_b(s, 0);
+	expect(name, satomi_solve(s), SATOMI_UNSAT);
+	satomi_destroy(s);
+}
+
+int
+main(void)
+{
+	repeated_assumptions();
+	checked_additions("added clauses, checked at the end", SATOMI_CHECK_SYNC);
+	checked_additions("added clauses, checked on a thread", SATOMI_CHECK_THREAD);
+	fprintf(stdout, "incremental: %d failed\n", n_failed);
+	return n_failed != 0;
+}
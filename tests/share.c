@@ -0,0 +1,158 @@
+//===--- share.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+//
+// Checks that a reader never imports a clause mixing the words of two writes:
+//
+// * a writer stopped in the middle of a write, which already overwrote the
+//   first words of the oldest clause not read yet, is set up by hand;
+// * a child process exports clauses, many of them close to half of the ring,
+//   as fast as it can, lapping its reader over and over, while the parent
+//   imports them.
+//
+// Each clause starts with its number, and its other literals depend on that
+// number, their position and the size of the clause. The sharing code is
+// included as it is, with its own satomi_import_clause, so that no solver is
+// involved.
+//
+//===------------------------------------------------------------------------===
+#include <sched.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include "../src/share.c"
+
+#define N_SECONDS 2
+
+static uint64_t n_imported;
+static uint64_t n_torn;
+
+static uint32_t
+clause_lit(uint32_t k, uint32_t i, uint32_t size)
+{
+	return i ? (k * 2654435761u) ^ (i * 40503u) ^ (size * 2246822519u) : k;
+}
+
+static void
+export(satomi_opts_t *opts, uint32_t *lits, uint32_t k, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+		lits[i] = clause_lit(k, i, size);
+	opts->sharing.export_clause(opts->sharing.data, lits, size, 0);
+}
+
+int
+satomi_import_clause(satomi_t *s, const uint32_t *lits, uint32_t size)
+{
+	(void) s;
+	n_imported++;
+	for (uint32_t i = 1; i < size; i++)
+		if (lits[i] != clause_lit(lits[0], i, size)) {
+			n_torn++;
+			break;
+		}
+	return SATOMI_OK;
+}
+
+/**
+ *  Fills the ring with clause 1, of two literals, then with clauses up to the
+ *  end of the ring. The next write, of clause 2, starts over clause 1: its
+ *  size, the same, and its first literal are written but not published.
+ */
+static int
+stalled_writer(const char *name)
+{
+	satomi_share_t *reader = satomi_share_open(name, 0);
+	satomi_share_t *writer = satomi_share_open(name, 1);
+	uint32_t *lits = STM_ALLOC(uint32_t, SHARE_MAX_WRITE);
+	uint32_t *words;
+	satomi_opts_t reader_opts;
+	satomi_opts_t writer_opts;
+
+	if (reader == NULL || writer == NULL)
+		return 1;
+	satomi_share_attach(reader, &reader_opts);
+	satomi_share_attach(writer, &writer_opts);
+	export(&writer_opts, lits, 1, 2);
+	export(&writer_opts, lits, 3, SHARE_RING_WORDS / 2 - 1);
+	export(&writer_opts, lits, 4, SHARE_RING_WORDS / 2 - 4);
+	words = writer->seg->words[1];
+	assert(atomic_load(&writer->seg->rings[1].head) == SHARE_RING_WORDS);
+	words[0] = 2;
+	words[1] = clause_lit(2, 0, 2);
+	reader_opts.sharing.import_clauses(reader_opts.sharing.data, NULL);
+	STM_FREE(lits);
+	satomi_share_close(writer);
+	satomi_share_close(reader);
+	return 0;
+}
+
+static void
+writer(const char *name)
+{
+	satomi_share_t *p = satomi_share_open(name, 1);
+	uint32_t *lits = STM_ALLOC(uint32_t, SHARE_MAX_WRITE);
+	time_t end = time(NULL) + N_SECONDS;
+	satomi_opts_t opts;
+	uint32_t seed = 1;
+
+	if (p == NULL)
+		_exit(1);
+	satomi_share_attach(p, &opts);
+	for (uint32_t k = 0; time(NULL) < end; k++) {
+		seed = seed * 1103515245u + 12345u;
+		if ((seed >> 16) % 4)
+			export(&opts, lits, k, 2 + (seed >> 16) % 13);
+		else
+			export(&opts, lits, k, SHARE_MAX_WRITE - 2 - (seed >> 16) % 1000);
+		/* Lets the reader in at varying distances, even on one processor */
+		if ((seed >> 20) % 3 == 0)
+			sched_yield();
+	}
+	_exit(0);
+}
+
+static int
+overrun(const char *name)
+{
+	satomi_share_t *p = satomi_share_open(name, 0);
+	satomi_opts_t opts;
+	pid_t pid;
+	int status;
+
+	if (p == NULL)
+		return 1;
+	satomi_share_attach(p, &opts);
+	pid = fork();
+	if (pid < 0) {
+		satomi_share_close(p);
+		return 1;
+	}
+	if (pid == 0)
+		writer(name);
+	while (waitpid(pid, &status, WNOHANG) == 0)
+		opts.sharing.import_clauses(opts.sharing.data, NULL);
+	opts.sharing.import_clauses(opts.sharing.data, NULL);
+	satomi_share_close(p);
+	return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+int
+main(void)
+{
+	char name[64];
+	int n_failed = 0;
+
+	snprintf(name, sizeof(name), "test-%d-stalled", (int) getpid());
+	n_failed += stalled_writer(name);
+	snprintf(name, sizeof(name), "test-%d-overrun", (int) getpid());
+	n_failed += overrun(name);
+	fprintf(stdout, "share: %llu clauses imported, %llu torn\n",
+	        (unsigned long long) n_imported, (unsigned long long) n_torn);
+	return n_failed || n_torn;
+}
@@ -0,0 +1,97 @@
+//===--- split.c ------------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+//
+// Splits DIMACS files in 2 to CNF_MAX_THREADS chunks, as the reader does for
+// big files on as many threads, and checks that the chunks give back the
+// clauses of the whole file, in order. The reader is included as it is, so
+// that the split does not depend on the size of the file or the number of
+// processors.
+//
+//===------------------------------------------------------------------------===
+#include "../src/cnf_reader.c"
+
+static const char *files[] = {
+	"tests/simple/comment_split.cnf",
+	"tests/simple/par8-1-c.cnf",
+	"tests/simple/zebra_v155_c1135.cnf",
+};
+#define N_FILES (sizeof(files) / sizeof(files[0]))
+
+/** Parses the chunks one after the other, appending their clauses to 'out'.
+ *  Returns SATOMI_ERR if a chunk has a format error. */
+static int
+parse_chunks(struct cnf_chunk *chunks, uint32_t n_chunks, vec_ui32_t *out)
+{
+	int ret = SATOMI_OK;
+
+	vec_clear(out);
+	for (uint32_t i = 0; i < n_chunks; i++) {
+		chunks[i].clauses = vec_ui32_alloc(0);
+		chunks[i].lits = vec_ui32_alloc(0);
+		chunks[i].n_clauses = 0;
+		chunks[i].error = 0;
+		cnf_chunk_parse(&chunks[i]);
+		if (chunks[i].error)
+			ret = SATOMI_ERR;
+		for (uint32_t j = 0; j < vec_size(chunks[i].clauses); j++)
+			vec_push_back(out, vec_at(chunks[i].clauses, j));
+		vec_free(chunks[i].clauses);
+		vec_free(chunks[i].lits);
+	}
+	return ret;
+}
+
+static int
+split_file(char *fname)
+{
+	struct cnf_chunk chunks[CNF_MAX_THREADS];
+	vec_ui32_t *whole = vec_ui32_alloc(0);
+	vec_ui32_t *split = vec_ui32_alloc(0);
+	size_t size;
+	char *token;
+	char *buffer = cnf_open(fname, &size, &token, NULL);
+	char *end;
+	int n_failed = 0;
+
+	if (buffer == NULL) {
+		fprintf(stdout, "FAILED %s: not read\n", fname);
+		return 1;
+	}
+	end = buffer + size;
+	if (!parse_chunks(chunks, cnf_split(token, end, chunks, 1), whole)) {
+		fprintf(stdout, "FAILED %s: format error\n", fname);
+		n_failed++;
+	}
+	for (uint32_t n = 2; n <= CNF_MAX_THREADS; n++) {
+		uint32_t n_chunks = cnf_split(token, end, chunks, n);
+		int ret = parse_chunks(chunks, n_chunks, split);
+
+		if (!ret || vec_size(split) != vec_size(whole)
+		    || memcmp(vec_data(split), vec_data(whole),
+		              sizeof(uint32_t) * vec_size(whole))) {
+			fprintf(stdout, "FAILED %s: %u chunks differ\n", fname, n_chunks);
+			n_failed++;
+		}
+	}
+	vec_free(whole);
+	vec_free(split);
+	STM_FREE(buffer);
+	return n_failed;
+}
+
+int
+main(void)
+{
+	int n_failed = 0;
+
+	for (uint32_t i = 0; i < N_FILES; i++)
+		n_failed += split_file((char *) files[i]);
+	fprintf(stdout, "split: %u files, %d failed\n", (uint32_t) N_FILES, n_failed);
+	return n_failed != 0;
+}
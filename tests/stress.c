@@ -0,0 +1,132 @@
+//===--- stress.c -----------------------------------------------------------===
+//
+//                     satomi: Satisfiability solver
+//
+// This file is distributed under the BSD 2-Clause License.
+// See LICENSE for details.
+//
+//===------------------------------------------------------------------------===
+//
+// Solves the instances of tests/simple on many threads at once, each job with
+// its own solver, some of them checking their answer on a second thread, and
+// reads a malformed file from all of them: the library must give the expected
+// answers, and return the format error instead of ending the process.
+//
+//===------------------------------------------------------------------------===
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "satomi.h"
+
+#define N_THREADS 16
+#define N_JOBS 480
+
+struct instance {
+	const char *name;
+	int status;
+};
+
+static const struct instance instances[] = {
+	{ "aim-100-1_6-no-1",  SATOMI_UNSAT },
+	{ "aim-50-1_6-yes1-4", SATOMI_SAT },
+	{ "comment_split",     SATOMI_SAT },
+	{ "dubois20",          SATOMI_UNSAT },
+	{ "dubois21",          SATOMI_UNSAT },
+	{ "dubois22",          SATOMI_UNSAT },
+	{ "ex_sat",            SATOMI_SAT },
+	{ "ex_unsat",          SATOMI_UNSAT },
+	{ "hole6",             SATOMI_UNSAT },
+	{ "par8-1-c",          SATOMI_SAT },
+	{ "quinn",             SATOMI_SAT },
+	{ "simple_v3_c2",      SATOMI_SAT },
+	{ "zebra_v155_c1135",  SATOMI_SAT },
+};
+#define N_INSTANCES (sizeof(instances) / sizeof(instances[0]))
+
+static char malformed[] = "/tmp/satomi-stress-XXXXXX";
+static atomic_int next_job;
+static atomic_int n_failed;
+
+static void
+fail(const char *name, const char *what, int status)
+{
+	fprintf(stdout, "FAILED %s: %s (%d)\n", name, what, status);
+	atomic_fetch_add(&n_failed, 1);
+}
+
+static void
+solve_job(int job)
+{
+	const struct instance *inst = instances + job % N_INSTANCES;
+	satomi_opts_t opts;
+	satomi_t *s;
+	char path[256];
+	int status;
+
+	satomi_default_opts(&opts);
+	opts.verbose = 0;
+	opts.check = (job % 3 == 0) ? SATOMI_CHECK_THREAD : SATOMI_CHECK_NONE;
+	snprintf(path, sizeof(path), "tests/simple/%s.cnf", inst->name);
+	if (satomi_parse_dimacs(path, &opts, &s) == SATOMI_OK)
+		status = satomi_solve(s);
+	else if (s != NULL) {
+		status = SATOMI_UNSAT;
+		if (opts.check && satomi_check(s, status) != SATOMI_OK)
+			status = SATOMI_UNDEC;
+	} else {
+		fail(inst->name, "not read", 0);
+		return;
+	}
+	if (status != inst->status)
+		fail(inst->name, "wrong answer", status);
+	satomi_destroy(s);
+}
+
+static void
+malformed_job(void)
+{
+	satomi_t *s = NULL;
+
+	if (satomi_parse_dimacs(malformed, NULL, &s) != SATOMI_ERR || s != NULL)
+		fail("malformed", "format error not returned", 0);
+}
+
+static void *
+worker(void *arg)
+{
+	int job;
+
+	(void) arg;
+	while ((job = atomic_fetch_add(&next_job, 1)) < N_JOBS) {
+		if (job % 40 == 39)
+			malformed_job();
+		else
+			solve_job(job);
+	}
+	return NULL;
+}
+
+int
+main(void)
+{
+	static const char text[] = "p cnf 2 1\n1 x 0\n";
+	pthread_t threads[N_THREADS];
+	int fd = mkstemp(malformed);
+
+	if (fd < 0 || write(fd, text, sizeof(text) - 1) != sizeof(text) - 1) {
+		fprintf(stdout, "Couldn't write %s\n", malformed);
+		return 1;
+	}
+	close(fd);
+	for (int i = 0; i < N_THREADS; i++)
+		pthread_create(&threads[i], NULL, worker, NULL);
+	for (int i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+	unlink(malformed);
+	fprintf(stdout, "stress: %d jobs on %d threads, %d failed\n", N_JOBS,
+	        N_THREADS, atomic_load(&n_failed));
+	return atomic_load(&n_failed) != 0;
+}